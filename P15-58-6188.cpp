@@ -3,13 +3,48 @@
 #include <string.h>
 #include <vector>
 #include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <queue>
+#include <atomic>
 #include <stdlib.h>
 #include <pthread.h>
+#include <time.h>
+#include <stddef.h>
 #define GL_SILENCE_DEPRECATION
+#ifdef __APPLE__
 #include <GLUT/glut.h>
 #include <OpenGL/gl.h>
 #include <OpenGL/glu.h>
+#include <OpenGL/glext.h>
+#include <OpenGL/OpenGL.h>
+#else
+// Linux/CI builds: g++ -o airport_rush P15-58-6188.cpp -lglut -lGLU -lGL -lpthread
+#define GL_GLEXT_PROTOTYPES
+#include <GL/glut.h>
+#include <GL/gl.h>
+#include <GL/glu.h>
+#include <GL/glx.h>
+#endif
 #include <unistd.h> 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#ifdef __APPLE__
+// Link with -framework AudioToolbox
+#include <AudioToolbox/AudioToolbox.h>
+#endif
+// ALSA output and mpg123 decoding are opt-in, so the default build links
+// without them: -DAIRPORT_RUSH_ALSA (link with -lasound) and
+// -DAIRPORT_RUSH_MPG123 (link with -lmpg123)
+#ifdef AIRPORT_RUSH_ALSA
+#define AUDIO_HAVE_ALSA 1
+#include <alsa/asoundlib.h>
+#endif
+#ifdef AIRPORT_RUSH_MPG123
+#define AUDIO_HAVE_MPG123 1
+#include <mpg123.h>
+#endif
 
 // ROMANIA FLAG COLORS
 #define ROMANIA_BLUE_R 0.0f
@@ -25,7 +60,13 @@
 #define ROMANIA_RED_B 0.149f
 
 // --- BMP Texture Loading ---
+// The file is mapped read-only and the texture is uploaded straight from the
+// mapping. Rows stay in file order: BMP stores them bottom-up and pads each
+// one to 4 bytes, which is GL's default unpack alignment. No pixels are
+// copied or flipped; the quad that draws the texture flips its v coordinate
+// instead (see BMPImage::topDown).
 
+#pragma pack(push, 1)
 struct BMPHeader
 {
   char signature[2];
@@ -44,6 +85,19 @@ struct BMPHeader
   int colorsUsed;
   int importantColors;
 };
+#pragma pack(pop)
+
+struct BMPImage
+{
+  const unsigned char *pixels; // first stored row, inside the mapping
+  int width, height;
+  int rowStride;               // bytes per stored row, padding included
+  bool topDown;                // negative height: the first stored row is the top one
+  void *mapping;
+  size_t mappingSize;
+};
+
+double nowSeconds();
 
 GLuint createColorTexture(float r, float g, float b)
 {
@@ -59,9 +113,28 @@ GLuint createColorTexture(float r, float g, float b)
   return textureID;
 }
 
-GLuint loadBMPTexture(const char *filename) {
-  FILE *file = fopen(filename, "rb");
-  if (!file) {
+// Checks every header field the loader relies on, against the real file size,
+// and returns the first problem found (NULL when the image is usable).
+const char *validateBMPHeader(const BMPHeader &h, size_t fileSize) {
+  if (fileSize < sizeof(BMPHeader)) return "file is shorter than a BMP header";
+  if (h.signature[0] != 'B' || h.signature[1] != 'M') return "invalid BMP file signature";
+  if (h.headerSize < 40) return "unsupported (pre-Windows 3) info header";
+  if (h.planes != 1) return "plane count is not 1";
+  if (h.bitsPerPixel != 24) return "only 24-bit BMP files are supported";
+  if (h.compression != 0) return "only uncompressed BMP files are supported";
+  if (h.width <= 0 || h.height == 0 || h.height == INT32_MIN) return "invalid image dimensions";
+  if (h.dataOffset < (int)sizeof(BMPHeader)) return "pixel data overlaps the header";
+  size_t rowStride = ((size_t)h.width * 3 + 3) & ~(size_t)3;
+  size_t rows = (size_t)(h.height < 0 ? -(long long)h.height : h.height);
+  if ((size_t)h.dataOffset > fileSize || rowStride * rows > fileSize - h.dataOffset)
+    return "pixel data runs past the end of the file";
+  return NULL;
+}
+
+bool mapBMPFile(const char *filename, BMPImage &image) {
+  memset(&image, 0, sizeof(image));
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0) {
     printf("ERROR: Could not open texture file: %s\n", filename);
     printf("Current working directory: ");
     char cwd[1024];
@@ -70,14 +143,106 @@ GLuint loadBMPTexture(const char *filename) {
     } else {
       printf("Unknown (getcwd failed)\n");
     }
-    return 0;
+    return false;
+  }
+
+  struct stat st;
+  void *mapping = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && st.st_size > 0)
+    mapping = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    printf("ERROR: Could not map texture file: %s\n", filename);
+    return false;
+  }
+  size_t fileSize = (size_t)st.st_size;
+
+  BMPHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(&header, mapping, std::min(fileSize, sizeof(header)));
+  const char *problem = validateBMPHeader(header, fileSize);
+  if (problem) {
+    printf("ERROR: %s: %s\n", problem, filename);
+    munmap(mapping, fileSize);
+    return false;
+  }
+  madvise(mapping, fileSize, MADV_SEQUENTIAL);
+
+  image.pixels = (const unsigned char *)mapping + header.dataOffset;
+  image.width = header.width;
+  image.topDown = header.height < 0;
+  image.height = image.topDown ? -header.height : header.height;
+  image.rowStride = (header.width * 3 + 3) & ~3;
+  image.mapping = mapping;
+  image.mappingSize = fileSize;
+  return true;
+}
+
+void unmapBMPFile(BMPImage &image) {
+  if (image.mapping)
+    munmap(image.mapping, image.mappingSize);
+  memset(&image, 0, sizeof(image));
+}
+
+// Reads one byte per page so the whole pixel array is resident before the
+// upload, instead of faulting it in during glTexImage2D.
+void prefaultBMPImage(const BMPImage &image) {
+  long pageSize = sysconf(_SC_PAGESIZE);
+  size_t pixelBytes = (size_t)image.rowStride * image.height;
+  volatile unsigned char sink = 0;
+  for (size_t offset = 0; offset < pixelBytes; offset += pageSize)
+    sink += image.pixels[offset];
+}
+
+// Row 0 of the texture is the first row stored in the file, which is the
+// bottom of the picture unless image.topDown is set. GL thread only.
+GLuint uploadBMPTexture(const BMPImage &image) {
+  printf("DEBUG: Width: %d, Height: %d, Row stride: %d, %s\n",
+         image.width, image.height, image.rowStride, image.topDown ? "top-down" : "bottom-up");
+
+  GLuint textureID;
+  glGenTextures(1, &textureID);
+  glBindTexture(GL_TEXTURE_2D, textureID);
+  glPushClientAttrib(GL_CLIENT_PIXEL_STORE_BIT);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, image.width, image.height, 0, GL_BGR, GL_UNSIGNED_BYTE, image.pixels);
+  glPopClientAttrib();
+
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+  GLenum err = glGetError();
+  if (err != GL_NO_ERROR) {
+    printf("OpenGL Error after texture setup: %d\n", err);
   }
+  return textureID;
+}
+
+GLuint loadBMPTexture(const char *filename, bool *topDown = NULL) {
+  BMPImage image;
+  if (!mapBMPFile(filename, image))
+    return 0;
+  GLuint textureID = uploadBMPTexture(image);
+  if (topDown)
+    *topDown = image.topDown;
+  printf("SUCCESS: Loaded Texture ID %d: %s (Width: %d, Height: %d)\n",
+         textureID, filename, image.width, image.height);
+  unmapBMPFile(image);
+  return textureID;
+}
 
+// The loader this one replaced: one fread per header field, a heap copy of
+// the whole image, a byte-at-a-time vertical flip, and no row padding.
+// Kept only as the baseline for --bmp-bench.
+static unsigned char *readBMPWithStdio(const char *filename, int &width, int &height) {
+  FILE *file = fopen(filename, "rb");
+  if (!file)
+    return NULL;
   char signature[2];
-  int fileSize, reserved, dataOffset, headerSize, width, height;
+  int fileSize, reserved, dataOffset, headerSize;
   short planes, bitsPerPixel;
   int compression, imageSize, xPixelsPerMeter, yPixelsPerMeter, colorsUsed, importantColors;
-
   fread(signature, sizeof(char), 2, file);
   fread(&fileSize, sizeof(int), 1, file);
   fread(&reserved, sizeof(int), 1, file);
@@ -93,36 +258,14 @@ GLuint loadBMPTexture(const char *filename) {
   fread(&yPixelsPerMeter, sizeof(int), 1, file);
   fread(&colorsUsed, sizeof(int), 1, file);
   fread(&importantColors, sizeof(int), 1, file);
-
-  printf("DEBUG: Signature: %c%c, Width: %d, Height: %d, BitsPerPixel: %d, Compression: %d\n",
-         signature[0], signature[1], width, height, bitsPerPixel, compression);
-
-  if (signature[0] != 'B' || signature[1] != 'M') {
-    printf("ERROR: Invalid BMP file signature: %s\n", filename);
-    fclose(file);
-    return 0;
-  }
-
-  if (bitsPerPixel != 24) {
-    printf("ERROR: Only 24-bit BMP files supported. This file has %d bits per pixel.\n", bitsPerPixel);
+  if (signature[0] != 'B' || signature[1] != 'M' || bitsPerPixel != 24 || compression != 0 ||
+      width <= 0 || height <= 0) {
     fclose(file);
-    return 0;
-  }
-
-  if (compression != 0) {
-    printf("ERROR: Only uncompressed BMP files supported. This file has compression type %d.\n", compression);
-    fclose(file);
-    return 0;
+    return NULL;
   }
 
   int dataSize = width * height * 3;
   unsigned char *imageData = (unsigned char *)malloc(dataSize);
-  if (!imageData) {
-    printf("ERROR: Could not allocate memory for image data.\n");
-    fclose(file);
-    return 0;
-  }
-
   fseek(file, dataOffset, SEEK_SET);
   fread(imageData, 1, dataSize, file);
   fclose(file);
@@ -134,24 +277,64 @@ GLuint loadBMPTexture(const char *filename) {
       imageData[(height - 1 - i) * width * 3 + j] = temp;
     }
   }
+  return imageData;
+}
 
-  GLuint textureID;
-  glGenTextures(1, &textureID);
-  glBindTexture(GL_TEXTURE_2D, textureID);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_BGR, GL_UNSIGNED_BYTE, imageData);
-
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+// Evicts the file from the page cache so the next read goes to the disk.
+static void dropFileCache(const char *filename) {
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0)
+    return;
+#ifdef POSIX_FADV_DONTNEED
+  posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+#else
+  fcntl(fd, F_NOCACHE, 1);
+#endif
+  close(fd);
+}
 
-  GLenum err = glGetError();
-  if (err != GL_NO_ERROR) {
-    printf("OpenGL Error after texture setup: %d\n", err);
+// Times both loaders up to the point where the pixels are ready for
+// glTexImage2D. The driver's copy during the upload is the same for both, so
+// the mapped path reads one byte per page to pay for the page-ins it would
+// otherwise defer to the driver. Runs without a GL context.
+int runBMPBenchmark(const char *filename, int iterations) {
+  if (iterations < 1)
+    iterations = 1;
+  printf("BMP load benchmark: %s, %d iterations (median ms)\n", filename, iterations);
+
+  for (int cold = 0; cold < 2; cold++) {
+    std::vector<double> stdioTimes, mappedTimes;
+    for (int i = 0; i < iterations; i++) {
+      if (cold)
+        dropFileCache(filename);
+      double start = nowSeconds();
+      int width = 0, height = 0;
+      unsigned char *pixels = readBMPWithStdio(filename, width, height);
+      stdioTimes.push_back(nowSeconds() - start);
+      if (!pixels) {
+        printf("ERROR: stdio loader could not read %s\n", filename);
+        return 1;
+      }
+      free(pixels);
+
+      if (cold)
+        dropFileCache(filename);
+      start = nowSeconds();
+      BMPImage image;
+      if (!mapBMPFile(filename, image))
+        return 1;
+      prefaultBMPImage(image);
+      mappedTimes.push_back(nowSeconds() - start);
+      unmapBMPFile(image);
+    }
+    std::sort(stdioTimes.begin(), stdioTimes.end());
+    std::sort(mappedTimes.begin(), mappedTimes.end());
+    double stdioMs = stdioTimes[iterations / 2] * 1000.0;
+    double mappedMs = mappedTimes[iterations / 2] * 1000.0;
+    printf("  %s cache: fread+flip %.3f ms, mmap %.3f ms (%.1fx)\n",
+           cold ? "cold" : "warm", stdioMs, mappedMs, mappedMs > 0 ? stdioMs / mappedMs : 0.0);
   }
-
-  free(imageData);
-  printf("SUCCESS: Loaded Texture ID %d: %s (Width: %d, Height: %d)\n",
-         textureID, filename, width, height);
-  return textureID;
+  return 0;
 }
 
 // --- Data Structures ---
@@ -165,12 +348,49 @@ struct GameObject
   float rotation;
 };
 
-struct PowerUp
+// --- Entity Store ---
+// Placed guards, boarding passes and power-ups live in structure-of-arrays
+// columns, so collision and draw loops stream only the fields they read.
+// Removal swaps the last entity into the hole (O(1), no shifting). Handles go
+// through a slot table with a generation counter, so a handle to a removed
+// entity is detected instead of silently pointing at whatever moved in.
+
+struct EntityHandle
 {
-  float x, y;
-  bool active;
-  float animScale;
-  int type;
+  int slot;
+  int generation;
+};
+
+struct EntityStore
+{
+  // Dense columns, index i is the i-th live entity
+  std::vector<float> x, y;
+  std::vector<float> w, h;
+  std::vector<int> type;
+  std::vector<float> rotation;  // boarding passes
+  std::vector<float> animScale; // power-ups
+  std::vector<unsigned long long> activeBits;
+  std::vector<int> denseToSlot;
+
+  // Slot table behind the handles
+  std::vector<int> slotToDense; // -1 while the slot is free
+  std::vector<int> slotGeneration;
+  std::vector<int> freeSlots;
+
+  int size() const { return (int)x.size(); }
+  bool isActive(int index) const { return (activeBits[index >> 6] >> (index & 63)) & 1; }
+  void setActive(int index, bool active);
+  int activeCount() const;
+
+  EntityHandle add(float px, float py, float width, float height, int entityType);
+  bool remove(EntityHandle handle);
+  void removeAt(int index);
+  int indexOf(EntityHandle handle) const; // -1 for stale handles
+  int indexOfSlot(int slot) const { return slotToDense[slot]; }
+  EntityHandle handleAt(int index) const;
+  void clear();
+  void assign(int count, const float *px, const float *py, const float *width, const float *height,
+              const int *entityType, const float *angle);
 };
 
 // --- Global Variables ---
@@ -182,9 +402,6 @@ const int BOTTOM_PANEL_HEIGHT = 100;
 const int GAME_AREA_TOP = WINDOW_HEIGHT - TOP_PANEL_HEIGHT;
 const int GAME_AREA_BOTTOM = BOTTOM_PANEL_HEIGHT;
 
-float cameraOffsetX = 0;
-float cameraOffsetY = 0;
-
 enum GameState
 {
   SETUP,
@@ -192,32 +409,9 @@ enum GameState
   WIN,
   LOSE
 };
-GameState gameState = SETUP;
 
-float playerX = 500, playerY = 50;
-float playerAngle = 0;
 const float PLAYER_SIZE = 20;
 const float PLAYER_SPEED = 3.0f;
-float currentSpeed = PLAYER_SPEED;
-
-float planeX = 500, planeY = 450;
-float bezierT = 0.0f;
-float bezierSpeed = 0.01f;
-int bezierP0[2] = {400, 450};
-int bezierP1[2] = {500, 450};
-int bezierP2[2] = {600, 450};
-int bezierP3[2] = {500, 450};
-
-std::vector<GameObject> obstacles;
-std::vector<GameObject> collectibles;
-std::vector<PowerUp> powerups;
-GameObject friendObj = {487, 400, 30, 35, true, 0, 0};
-bool friendCollected = false;
-
-int score = 0;
-int lives = 5;
-int gameTime = 60;
-float gameTimer = 0;
 
 enum DrawingMode
 {
@@ -229,1113 +423,6434 @@ enum DrawingMode
 };
 DrawingMode drawingMode = NONE;
 
-bool invincible = false;
-float invincibleTimer = 0;
-bool speedBoost = false;
-float speedBoostTimer = 0;
-
-float collectibleRotation = 0;
-float conveyorOffset = 0;
+// --- AABB Batch Kernel ---
+// Tests one box against a run of boxes stored as minX/minY/maxX/maxY columns
+// and writes the indices that overlap. Same strict comparisons as
+// checkCollision(). SSE2 is the x86-64 baseline, AVX2 is picked at runtime
+// when the CPU has it, NEON is used on arm64, and the scalar loop covers
+// everything else plus the tails.
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+#define AABB_KERNEL_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__) || defined(__ARM_NEON)
+#define AABB_KERNEL_NEON 1
+#include <arm_neon.h>
+#endif
+
+typedef int (*AabbBatchFn)(const float *minX, const float *minY, const float *maxX, const float *maxY,
+                           int count, float x0, float y0, float x1, float y1, int *hits);
+
+int aabbBatchScalar(const float *minX, const float *minY, const float *maxX, const float *maxY,
+                    int count, float x0, float y0, float x1, float y1, int *hits);
+AabbBatchFn selectAabbKernel(const char **name);
+bool verifyAabbKernels(unsigned int seed, int boxCount);
+
+const char *aabbKernelName = "scalar";
+AabbBatchFn aabbBatch = selectAabbKernel(&aabbKernelName);
+
+// --- Flight Paths ---
+// A path is a chain of cubic segments, given either as bezier control points
+// (3n+1 points, consecutive segments share an end point) or as Catmull-Rom
+// points the curve passes through. Each segment is kept in power form and
+// sampled by forward differencing into a cumulative arc-length table. From
+// that the path is resampled at equal arc-length spacing, so moving at a
+// constant speed is one lerp between two table entries however the control
+// points are spread. Followers (the plane, or a fleet of taxiing aircraft)
+// are distance/speed columns advanced together by a batch kernel picked like
+// the AABB one.
+
+const int PATH_ARC_STEPS = 128;         // forward-differencing steps per segment for the arc-length table
+const float PATH_SAMPLE_SPACING = 0.5f; // world units between entries of the constant-speed table
+
+enum SplineKind
+{
+  SPLINE_BEZIER,
+  SPLINE_CATMULL_ROM
+};
 
-// --- AUDIO SYSTEM ---
-bool backgroundMusicPlaying = false;
-bool winMusicPlaying = false;
-bool loseMusicPlaying = false;
-bool takeoffSoundPlaying = false;
-pthread_t backgroundMusicThread;
-pthread_t winMusicThread;
-pthread_t loseMusicThread;
-pthread_t takeoffSoundThread;
-bool shouldStopBackgroundMusic = false;
-bool shouldStopWinMusic = false;
-bool shouldStopLoseMusic = false;
-bool shouldStopTakeoffSound = false;
-
-// Audio fallback flags
-bool audioAssetsAvailable = true;
-bool backgroundMusicAvailable = true;
-bool winMusicAvailable = true;
-bool loseMusicAvailable = true;
-bool takeoffSoundAvailable = true;
+// p(u) = ((a u + b) u + c) u + d for u in [0, 1]
+struct PathSegment
+{
+  float ax, bx, cx, dx;
+  float ay, by, cy, dy;
+};
 
-GLuint mapTexture;
-GLuint playerTexture, planeTexture, guardTexture, boardingPassTexture;
-GLuint friendTexture, badgeTexture, fastTrackTexture, luggageTexture, panelTexture;
+struct FlightPath
+{
+  std::vector<PathSegment> segments;
+  std::vector<float> arcLength; // at global parameter k / PATH_ARC_STEPS, from 0
+  std::vector<float> sampleX;   // positions every sampleSpacing along the path, plus a repeat of the end
+  std::vector<float> sampleY;
+  int sampleCount = 0;          // index of the end sample
+  float sampleSpacing = 0;
+  float invSpacing = 0;
+  float length = 0;
+
+  void build(SplineKind kind, const float *points, int pointCount, bool closed);
+  bool empty() const { return segments.empty(); }
+  void evaluate(float param, float &x, float &y) const; // param in [0, segments.size()]
+  float paramAtDistance(float distance) const;
+  void positionAt(float distance, float &x, float &y) const; // from the constant-speed table
+  void addBezier(const float *p0, const float *p1, const float *p2, const float *p3);
+  void buildTables();
+};
 
-bool checkCollision(float x1, float y1, float w1, float h1,
-                    float x2, float y2, float w2, float h2);
-bool wouldCollideWithObstacle(float newX, float newY);
+// Advances count followers by speed * dt along one path and writes where
+// they are. With wrap a follower that passes the end starts over, otherwise
+// it stops there; either way a single step should be shorter than the path.
+typedef void (*PathAdvanceFn)(const FlightPath &path, float *distance, const float *speed, int count, float dt,
+                              bool wrap, float *x, float *y);
 
-// --- AUDIO FUNCTIONS ---
-void* playBackgroundMusic(void* arg);
-void* playWinMusic(void* arg);
-void* playLoseMusic(void* arg);
-void* playTakeoffSound(void* arg);
-void startBackgroundMusic();
-void startWinMusic();
-void startLoseMusic();
-void startTakeoffSound();
-void stopBackgroundMusic();
-void stopWinMusic();
-void stopLoseMusic();
-void stopTakeoffSound();
-void cleanupAudio();
-bool checkAudioAssets();
+void advancePathScalar(const FlightPath &path, float *distance, const float *speed, int count, float dt,
+                       bool wrap, float *x, float *y);
+PathAdvanceFn selectPathKernel(const char **name);
+bool verifyPathKernels(unsigned int seed, int followers);
 
-void print(int x, int y, char *string)
-{
-  int len, i;
-  glRasterPos2f(x, y);
-  len = (int)strlen(string);
-  for (i = 0; i < len; i++)
-  {
-    glutBitmapCharacter(GLUT_BITMAP_TIMES_ROMAN_24, string[i]);
-  }
-}
+const char *pathKernelName = "scalar";
+PathAdvanceFn advancePath = selectPathKernel(&pathKernelName);
 
-int* bezier(float t, int* p0, int* p1, int* p2, int* p3)
-{
-  static int res[2];
-  res[0] = pow((1-t),3)*p0[0]+3*t*pow((1-t),2)*p1[0]+3*pow(t,2)*(1-t)*p2[0]+pow(t,3)*p3[0];
-  res[1] = pow((1-t),3)*p0[1]+3*t*pow((1-t),2)*p1[1]+3*pow(t,2)*(1-t)*p2[1]+pow(t,3)*p3[1];
-  return res;
-}
+// --- Spatial Hash Grid ---
+// Broadphase for player-vs-world queries. Each entry is filed under the cell
+// holding its center and keeps its own AABB, so a query only walks the buckets
+// of nearby cells and never touches the entity vectors. Cells are hashed into a
+// fixed bucket table, so placements anywhere on the map need no bounds.
 
-// --- DRAWING FUNCTIONS ---
+const float GRID_CELL_SIZE = 32.0f;
+const int GRID_BUCKET_COUNT = 4096; // power of two
+const int GRID_QUERY_BATCH = 64;    // boxes per aabbBatch() call
 
-void drawPlayer(float x, float y, float angle)
+struct GridBucket
 {
-  glPushMatrix();
-  glTranslatef(x, y, 0);
-  glRotatef(angle, 0, 0, 1);
-
-  glColor3f(0.95f, 0.87f, 0.73f);
-  glBegin(GL_POLYGON);
-  for (int i = 0; i < 20; i++)
-  {
-    float theta = 2.0f * 3.1415926f * float(i) / 20.0f;
-    glVertex2f(5 * cosf(theta), 8 + 5 * sinf(theta));
-  }
-  glEnd();
+  std::vector<int> ids;
+  std::vector<float> minX, minY, maxX, maxY;
+};
 
-  glColor3f(0.1f, 0.1f, 0.15f);
-  glBegin(GL_POLYGON);
-  for (int i = 0; i < 20; i++)
-  {
-    float theta = 2.0f * 3.1415926f * float(i) / 20.0f;
-    glVertex2f(6 * cosf(theta), 9 + 6 * sinf(theta));
-  }
-  glEnd();
+struct SpatialGrid
+{
+  std::vector<GridBucket> buckets;
+  float maxHalfExtent = 0; // largest half width/height inserted, widens queries
+  int count = 0;
+
+  void clear();
+  void insert(int id, float x, float y, float width, float height);
+  void insertAll(int count, const float *x, const float *y, const float *width, const float *height);
+  void remove(int id, float x, float y);
+  int query(float x, float y, float width, float height, std::vector<int> &hits) const;
+  int queryRegion(float x, float y, float width, float height, std::vector<int> &hits) const;
+  bool overlapsAny(float x, float y, float width, float height) const;
+  int bucketFor(float x, float y) const;
+  int collectBuckets(float x, float y, float width, float height, int *out, int maxOut) const;
+  int collectHits(const int *bucketList, int n, float x, float y, float width, float height,
+                  std::vector<int> &hits) const;
+
+  // queryRegion() scratch, kept between calls so the per-frame cull does not
+  // allocate; seen is all zero between queries
+  mutable std::vector<unsigned char> seen;
+  mutable std::vector<int> bucketList;
+};
 
-  glColor3f(0.4f, 0.4f, 0.5f);
-  glBegin(GL_POLYGON);
-  glVertex2f(-8, 3);
-  glVertex2f(8, 3);
-  glVertex2f(10, -8);
-  glVertex2f(-10, -8);
-  glEnd();
+// --- Frame Profiler ---
+// A ProfileScope times one phase of the frame. Scopes nest and record
+// exclusive time (their own time minus the scopes inside them), so a frame's
+// phases add up. commitFrame() publishes the frame's totals into a fixed
+// ring; the overlay graph and the CSV dump read it through an atomic commit
+// index, without locks.
 
-  glColor3f(ROMANIA_BLUE_R, ROMANIA_BLUE_G, ROMANIA_BLUE_B);
-  glLineWidth(2);
-  glBegin(GL_LINES);
-  glVertex2f(0, 3);
-  glVertex2f(0, -5);
-  glEnd();
+enum ProfilePhase
+{
+  PHASE_SIMULATION,
+  PHASE_COLLISIONS,
+  PHASE_MAP,
+  PHASE_ENTITIES,
+  PHASE_CROWD,
+  PHASE_ACTORS,
+  PHASE_PANELS,
+  PHASE_BANNERS,
+  PHASE_OVERLAY,
+  PHASE_PRESENT,
+  PHASE_COUNT
+};
 
-  glColor3f(0.2f, 0.2f, 0.25f);
-  glBegin(GL_QUADS);
-  glVertex2f(-10, -8);
-  glVertex2f(10, -8);
-  glVertex2f(8, -15);
-  glVertex2f(-8, -15);
-  glEnd();
+const int PROFILE_RING_FRAMES = 4096; // power of two
+const int PROFILE_GRAPH_FRAMES = 240;
 
-  glColor3f(0.7f, 0.5f, 0.3f);
-  glBegin(GL_QUADS);
-  glVertex2f(10, 0);
-  glVertex2f(16, 0);
-  glVertex2f(16, -10);
-  glVertex2f(10, -10);
-  glEnd();
+struct ProfileFrame
+{
+  float ms[PHASE_COUNT];
+  int drawnEntities, culledEntities; // placed entities and actors, see drawPlacedEntities()
+};
 
-  glColor3f(ROMANIA_RED_R, ROMANIA_RED_G, ROMANIA_RED_B);
-  glBegin(GL_QUADS);
-  glVertex2f(13, -8);
-  glVertex2f(15, -8);
-  glVertex2f(15, -6);
-  glVertex2f(13, -6);
-  glEnd();
+struct ProfileScope
+{
+  ProfilePhase phase;
+  double start;
+  double childSeconds;
+  ProfileScope *parent;
 
-  glColor3f(ROMANIA_YELLOW_R, ROMANIA_YELLOW_G, ROMANIA_YELLOW_B);
-  glLineWidth(3);
-  glBegin(GL_LINE_STRIP);
-  glVertex2f(13, 0);
-  glVertex2f(13, 3);
-  glEnd();
+  ProfileScope(ProfilePhase phase);
+  ~ProfileScope();
+};
 
-  glColor3f(0.95f, 0.87f, 0.73f);
-  glBegin(GL_TRIANGLES);
-  glVertex2f(-8, 2);
-  glVertex2f(-12, 0);
-  glVertex2f(-8, -2);
-  glEnd();
+struct FrameProfiler
+{
+  bool enabled = false; // only the windowed game profiles; headless runs stay untimed
+  bool overlayVisible = false;
+  double current[PHASE_COUNT] = {}; // seconds for the frame in progress
+  int drawnEntities = 0, culledEntities = 0; // for the frame in progress
+  ProfileScope *innermost = nullptr;
+
+  ProfileFrame ring[PROFILE_RING_FRAMES];
+  std::atomic<unsigned int> committed{0}; // frames published so far
+
+  void countEntities(int drawn, int culled);
+  void commitFrame();
+  int latest(int count, ProfileFrame *out) const;
+  bool writeCsv(const char *path) const;
+};
 
-  glColor3f(0.0f, 0.0f, 0.0f);
-  glPointSize(3);
-  glBegin(GL_POINTS);
-  glVertex2f(-2, 9);
-  glVertex2f(2, 9);
-  glEnd();
+FrameProfiler profiler;
+
+// --- Crowd ---
+// NPC travellers walking from the entrance along the bottom of the terminal
+// to one of CROWD_GATE_COUNT gates along the top. Each gate boards along a
+// wide stretch of the top edge; narrow gates can't take 10k agents as fast
+// as they arrive and the crowd would just jam in front of them. The game
+// area is split into CROWD_CELL squares; per gate, a Dijkstra pass from the
+// column under the gate over the cells not covered by guards gives a flow
+// field, a unit direction per cell, so steering an agent is one lookup.
+// Fields are rebuilt only when guards
+// change. Each tick the agents are binned into the same cells by a counting
+// sort, which is the neighbour index for separation, and then updated in
+// chunks on a worker pool. An agent only reads the previous positions and
+// writes its own slot of the next ones, so the result is the same for any
+// number of threads. The player slows down in a crowd and pushes agents aside.
+
+const float CROWD_LEFT = 50, CROWD_RIGHT = 950; // the player's walkable area
+const float CROWD_BOTTOM = 30, CROWD_TOP = 480;
+const float CROWD_CELL = 10.0f;           // flow field and neighbour bin size
+const float CROWD_RADIUS = 1.5f;          // agents keep 2 * radius apart
+const int CROWD_MAX_NEIGHBOURS = 16;      // separation stops after this many, bounding the cost inside a jam
+const float CROWD_PLAYER_RADIUS = 16.0f;  // agents closer than this are pushed away
+const float CROWD_GATE_HALF_WIDTH = 100;  // an agent this far either side of its gate...
+const float CROWD_GATE_DEPTH = 10;        // ...and this close to the gate line boards and respawns
+const float CROWD_STEERING = 8.0f;        // per second, how fast velocity turns to the desired one
+const int CROWD_CHUNK = 256;              // agents per work item
+const int CROWD_MAX_WORKERS = 16;
+const int CROWD_DEFAULT_SIZE = 2000;      // --crowd N
+const int CROWD_GATE_COUNT = 4;
+const float crowdGates[CROWD_GATE_COUNT][2] = {{150, 470}, {380, 470}, {620, 470}, {850, 470}};
+
+unsigned int nextRandom(unsigned int &state);
+
+// Persistent threads for fork/join loops: run() hands out chunks of
+// [0, count) to the workers and the calling thread, and returns when all
+// chunks are done
+struct CrowdWorkers
+{
+  pthread_t threads[CROWD_MAX_WORKERS];
+  int threadCount = 0;
+  pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+  pthread_cond_t wake = PTHREAD_COND_INITIALIZER;
+  pthread_cond_t done = PTHREAD_COND_INITIALIZER;
+  unsigned int generation = 0;
+  int busy = 0;
+  bool stopping = false;
+
+  void (*job)(void *context, int begin, int end) = NULL;
+  void *context = NULL;
+  int jobCount = 0;
+  std::atomic<int> nextChunk{0};
+
+  void start(int threads);
+  void stop();
+  void run(void (*fn)(void *, int, int), void *fnContext, int count);
+  void workChunks();
+};
 
-  glPopMatrix();
-}
+CrowdWorkers crowdWorkers;
 
-void drawPlane(float x, float y)
+struct Crowd
 {
-  glPushMatrix();
-  glTranslatef(x, y, 0);
+  int count = 0;
+  std::vector<float> x, y, vx, vy;
+  std::vector<float> prevX, prevY, prevVx, prevVy; // last tick; update() writes the next tick here, then swaps
+  std::vector<float> speed;                        // walking speed, units per second
+  std::vector<unsigned char> gate;
+  std::vector<unsigned int> rng;                   // per agent, so respawns don't depend on update order
+
+  int cellsX = 0, cellsY = 0;
+  std::vector<unsigned char> blocked;             // cell touches a guard
+  std::vector<float> flowX[CROWD_GATE_COUNT];     // unit direction toward the gate, per cell
+  std::vector<float> flowY[CROWD_GATE_COUNT];
+  bool fieldsDirty = true;
+  std::vector<int> binStart;                      // cellsX * cellsY + 1 offsets into binAgents
+  std::vector<int> binAgents;
+
+  // Inputs of the update in progress, for the worker chunks
+  float stepDt = 0;
+  float stepPlayerX = 0, stepPlayerY = 0;
+
+  void spawn(int agents, unsigned int seed);
+  int cellOf(float px, float py) const;
+  void buildFlowFields(const EntityStore &obstacles);
+  void buildBins();
+  void update(float dt, const EntityStore &obstacles, float playerX, float playerY, CrowdWorkers *workers);
+  void updateRange(int begin, int end);
+  void respawn(int i, float &px, float &py);
+  float slowdownAt(float px, float py) const;
+};
 
-  glColor3f(0.95f, 0.95f, 0.98f);
-  glBegin(GL_POLYGON);
-  glVertex2f(-30, -6);
-  glVertex2f(25, -6);
-  glVertex2f(30, -3);
-  glVertex2f(30, 3);
-  glVertex2f(25, 6);
-  glVertex2f(-30, 6);
-  glVertex2f(-35, 3);
-  glVertex2f(-35, -3);
-  glEnd();
+// --- Simulation ---
+// Every piece of gameplay state lives in a Simulation and only changes inside
+// step(). The GLUT callbacks just collect SimInputs and react to the events a
+// step reports (audio), so the game logic runs the same with or without a window.
 
-  glColor3f(0.85f, 0.85f, 0.88f);
-  glBegin(GL_TRIANGLES);
-  glVertex2f(-20, 0);
-  glVertex2f(-35, -18);
-  glVertex2f(-10, -18);
-  glVertex2f(20, 0);
-  glVertex2f(35, -18);
-  glVertex2f(10, -18);
-  glEnd();
+enum MoveKey
+{
+  MOVE_UP,
+  MOVE_DOWN,
+  MOVE_LEFT,
+  MOVE_RIGHT,
+  MOVE_KEY_COUNT
+};
 
-  float tailWidth = 10;
-  float tailHeight = 12;
+inline unsigned int moveBit(int moveKey) { return 1u << moveKey; }
 
-  glColor3f(ROMANIA_BLUE_R, ROMANIA_BLUE_G, ROMANIA_BLUE_B);
-  glBegin(GL_QUADS);
-  glVertex2f(-30, 0);
-  glVertex2f(-30 - tailWidth / 3, 0);
-  glVertex2f(-30 - tailWidth / 3, tailHeight);
-  glVertex2f(-30, tailHeight);
-  glEnd();
+// Per-tick animation speeds (bezierSpeed, rotation, conveyor) were tuned for
+// the old 60 Hz timer; tick() scales them by dt so any tick rate matches.
+const float BASE_TICK_RATE = 60.0f;
 
-  glColor3f(ROMANIA_YELLOW_R, ROMANIA_YELLOW_G, ROMANIA_YELLOW_B);
-  glBegin(GL_QUADS);
-  glVertex2f(-30 - tailWidth / 3, 0);
-  glVertex2f(-30 - 2 * tailWidth / 3, 0);
-  glVertex2f(-30 - 2 * tailWidth / 3, tailHeight);
-  glVertex2f(-30 - tailWidth / 3, tailHeight);
-  glEnd();
+struct Placement
+{
+  DrawingMode mode;
+  float x, y; // map coordinates
+};
 
-  glColor3f(ROMANIA_RED_R, ROMANIA_RED_G, ROMANIA_RED_B);
-  glBegin(GL_QUADS);
-  glVertex2f(-30 - 2 * tailWidth / 3, 0);
-  glVertex2f(-30 - tailWidth, 0);
-  glVertex2f(-30 - tailWidth, tailHeight);
-  glVertex2f(-30 - 2 * tailWidth / 3, tailHeight);
-  glEnd();
+struct SimInputs
+{
+  bool restartPressed = false;      // R: start in SETUP, reset after WIN/LOSE
+  unsigned int moves = 0;           // moveBit() of every direction held this tick
+  std::vector<Placement> placements;
+  const char *levelToLoad = NULL;   // F9 / --level: replace the layout (SETUP only)
 
-  glColor3f(0.4f, 0.6f, 0.8f);
-  glPointSize(4);
-  glBegin(GL_POINTS);
-  for (int i = -20; i < 20; i += 8)
+  void clear()
   {
-    glVertex2f(i, 2);
+    restartPressed = false;
+    moves = 0;
+    placements.clear();
+    levelToLoad = NULL;
   }
-  glEnd();
+};
 
-  glColor3f(ROMANIA_RED_R, ROMANIA_RED_G, ROMANIA_RED_B);
-  glRasterPos2f(-15, -2);
-  char gateText[] = "A01";
-  for (int i = 0; i < 3; i++)
-  {
-    glutBitmapCharacter(GLUT_BITMAP_HELVETICA_12, gateText[i]);
-  }
+// Reported through Simulation::events after each step()
+enum SimEvent
+{
+  SIM_EVENT_STARTED = 1 << 0,
+  SIM_EVENT_WON = 1 << 1,
+  SIM_EVENT_LOST = 1 << 2,
+  SIM_EVENT_RESET = 1 << 3
+};
 
-  glPopMatrix();
-}
+struct Simulation
+{
+  GameState gameState = SETUP;
+
+  float playerX = 500, playerY = 50;
+  float playerAngle = 0;
+  float currentSpeed = PLAYER_SPEED;
+
+  bool blockedByGuard = false; // last move ran into a guard; damage is taken on contact, not per tick
+
+  float cameraOffsetX = 0;
+  float cameraOffsetY = 250;
+
+  float planeX = 500, planeY = 450;
+
+  // Positions before the last step(), for interpolated rendering
+  float prevCameraOffsetX = 0, prevCameraOffsetY = 250;
+  float prevPlaneX = 500, prevPlaneY = 450;
+  Crowd crowd;
+  int crowdSize = 0;            // agents spawned by reset(); the window sets it from --crowd
+  CrowdWorkers *workers = NULL; // pool for the crowd update, NULL updates it on the calling thread
+
+  float planeDistance = 0;   // along planePath
+  float bezierSpeed = 0.01f; // laps per 60 Hz tick
+  FlightPath planePath;      // built from the control points below
+  int bezierP0[2] = {400, 450};
+  int bezierP1[2] = {500, 450};
+  int bezierP2[2] = {600, 450};
+  int bezierP3[2] = {500, 450};
+
+  EntityStore obstacles;    // guards
+  EntityStore collectibles; // boarding passes
+  EntityStore powerups;     // type 1 = VIP badge, 2 = fast track
+  GameObject friendObj = {487, 400, 30, 35, true, 0, 0};
+  bool friendCollected = false;
+
+  // Broadphase over the stores above; grid ids are store slots
+  SpatialGrid obstacleGrid;
+  SpatialGrid collectibleGrid;
+  SpatialGrid powerupGrid;
+  std::vector<int> gridHits; // scratch for handleCollisions()
+
+  int score = 0;
+  int lives = 5;
+  int gameTime = 60;
+  float gameTimer = 0;
+
+  bool invincible = false;
+  float invincibleTimer = 0;
+  bool speedBoost = false;
+  float speedBoostTimer = 0;
+
+  float collectibleRotation = 0;
+  float conveyorOffset = 0;
+
+  // Simulated clock (ms) driving the power-up pulse, so runs are reproducible
+  float elapsedMs = 0;
+  unsigned int tickCount = 0;
+
+  unsigned int events = 0; // SimEvent bits raised by the last step()
+  bool verbose = true;     // DEBUG printf output
+  int debugCounter = 0;
+
+  void reset();
+  void step(const SimInputs &inputs, float dt);
+  void place(const Placement &placement);
+  void movePlayer(unsigned int moves, float dt);
+  void buildPlanePath();
+  void tick(float dt);
+  bool wouldCollideWithObstacle(float newX, float newY) const;
+  void handleCollisions();
+  unsigned int checksum() const;
+};
 
-void drawGuard(float x, float y)
+Simulation sim;
+
+// --- Level Files ---
+// A layout (guards, boarding passes, power-ups, the friend and the plane's
+// bezier control points) saved as one versioned binary file. The header is
+// fixed-size and every entity field is a column of 4-byte values at an
+// offset the header gives, so a mapped file is read in place: loading
+// validates the header once and copies the columns straight into the
+// EntityStores. --level-export writes the same content as text for diffing.
+
+const char LEVEL_MAGIC[8] = {'A', 'R', 'L', 'E', 'V', 'E', 'L', 0};
+const uint32_t LEVEL_FORMAT_VERSION = 1;
+const uint32_t LEVEL_BYTE_ORDER = 0x01020304; // reads back swapped on a foreign-endian machine
+const int LEVEL_MAX_ENTITIES = 1 << 26;       // per store
+// |x|, |y| in world units: the largest map the mip pyramid covers is 32768 px
+// (MAP_TILE_SIZE << (MAP_MAX_LEVELS - 1)), under 32768 units either way
+const float LEVEL_COORD_LIMIT = 32768;
+// Control polygon length of the plane path; its arc-length table has a sample
+// every 0.5 units, so this bounds it to about 131k entries
+const float LEVEL_PLANE_PATH_LIMIT = 2 * LEVEL_COORD_LIMIT;
+const float LEVEL_SIZE_LIMIT = 4096;          // entity width and height
+
+enum LevelColumn
 {
-  glPushMatrix();
-  glTranslatef(x, y, 0);
+  LEVEL_COLUMN_X,
+  LEVEL_COLUMN_Y,
+  LEVEL_COLUMN_WIDTH,
+  LEVEL_COLUMN_HEIGHT,
+  LEVEL_COLUMN_TYPE, // int32
+  LEVEL_COLUMN_ROTATION,
+  LEVEL_COLUMN_COUNT
+};
 
-  glColor3f(0.95f, 0.87f, 0.73f);
-  glBegin(GL_POLYGON);
-  for (int i = 0; i < 20; i++)
-  {
-    float theta = 2.0f * 3.1415926f * float(i) / 20.0f;
-    glVertex2f(4 * cosf(theta), 10 + 4 * sinf(theta));
-  }
-  glEnd();
+enum LevelStore
+{
+  LEVEL_OBSTACLES,
+  LEVEL_COLLECTIBLES,
+  LEVEL_POWERUPS,
+  LEVEL_STORE_COUNT
+};
 
-  glColor3f(ROMANIA_BLUE_R, ROMANIA_BLUE_G, ROMANIA_BLUE_B);
-  glBegin(GL_POLYGON);
-  for (int i = 10; i < 30; i++)
-  {
-    float theta = 2.0f * 3.1415926f * float(i) / 20.0f;
-    glVertex2f(5 * cosf(theta), 11 + 4.5f * sinf(theta));
-  }
-  glEnd();
+struct LevelStoreSection
+{
+  uint32_t count;
+  uint32_t reserved;
+  uint64_t columnOffset[LEVEL_COLUMN_COUNT]; // from the start of the file
+};
 
-  glColor3f(0.1f, 0.1f, 0.2f);
-  glBegin(GL_QUADS);
-  glVertex2f(-6, 10);
-  glVertex2f(6, 10);
-  glVertex2f(7, 8);
-  glVertex2f(-7, 8);
-  glEnd();
+struct LevelFileHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t byteOrder;
+  uint32_t headerSize; // sizeof(LevelFileHeader) when written
+  uint32_t reserved;
+  uint64_t fileSize;
+  float friendX, friendY, friendWidth, friendHeight;
+  int32_t friendActive;
+  int32_t bezier[4][2]; // P0..P3
+  int32_t reserved2;
+  LevelStoreSection stores[LEVEL_STORE_COUNT];
+};
 
-  glColor3f(0.1f, 0.1f, 0.3f);
-  glBegin(GL_QUADS);
-  glVertex2f(-7, 7);
-  glVertex2f(7, 7);
-  glVertex2f(7, -12);
-  glVertex2f(-7, -12);
-  glEnd();
+// A validated level, read in place from its mapping
+struct LevelFile
+{
+  const LevelFileHeader *header;
+  void *mapping;
+  size_t mappingSize;
 
-  glColor3f(ROMANIA_RED_R, ROMANIA_RED_G, ROMANIA_RED_B);
-  glBegin(GL_TRIANGLES);
-  glVertex2f(-1, 5);
-  glVertex2f(1, 5);
-  glVertex2f(0, 0);
-  glEnd();
+  const float *column(int store, int column) const;
+};
 
-  glColor3f(ROMANIA_YELLOW_R, ROMANIA_YELLOW_G, ROMANIA_YELLOW_B);
-  glBegin(GL_POLYGON);
-  for (int i = 0; i < 6; i++)
-  {
-    float theta = 2.0f * 3.1415926f * float(i) / 6.0f;
-    glVertex2f(-4 + 2 * cosf(theta), 2 + 2 * sinf(theta));
-  }
-  glEnd();
+bool mapLevelFile(const char *path, LevelFile &level);
+void unmapLevelFile(LevelFile &level);
+bool saveLevelFile(const Simulation &s, const char *path);
+bool loadLevelFile(Simulation &s, const char *path);
+bool exportLevelText(const char *path, const char *textPath);
 
-  glColor3f(0.95f, 0.87f, 0.73f);
-  glBegin(GL_QUADS);
-  glVertex2f(-7, 5);
-  glVertex2f(-10, 3);
-  glVertex2f(-10, -3);
-  glVertex2f(-7, -1);
-  glEnd();
+const char *levelPath = "airport_rush.level"; // F5 saves, F9 loads; --level sets it and loads it at startup
 
-  glColor3f(0.2f, 0.2f, 0.2f);
-  glBegin(GL_QUADS);
-  glVertex2f(7, 0);
-  glVertex2f(12, -2);
-  glVertex2f(12, -4);
-  glVertex2f(7, -2);
-  glEnd();
+// --- Held Keys ---
+// Key-down and key-up callbacks keep this table current (key repeat is
+// ignored) and every simulation tick samples it, so movement follows the
+// tick rate instead of the desktop's repeat delay and rate. WASD and the
+// arrows are tracked separately so releasing one keeps the other held.
 
-  glPopMatrix();
-}
+enum KeySource
+{
+  KEY_SOURCE_LETTER,
+  KEY_SOURCE_ARROW,
+  KEY_SOURCE_COUNT
+};
 
-void drawBoardingPass(float x, float y, float rotation)
+struct HeldKeys
 {
-  glPushMatrix();
-  glTranslatef(x, y, 0);
-  glRotatef(rotation, 0, 0, 1);
+  bool down[MOVE_KEY_COUNT][KEY_SOURCE_COUNT] = {};
+  unsigned int tapped = 0; // pressed since the last sample, so a tap shorter than a tick still moves
 
-  glColor3f(1.0f, 0.98f, 0.95f);
-  glBegin(GL_QUADS);
-  glVertex2f(-10, -6);
-  glVertex2f(10, -6);
-  glVertex2f(10, 6);
-  glVertex2f(-10, 6);
-  glEnd();
+  void press(int moveKey, int source);
+  void release(int moveKey, int source);
+  unsigned int sample();
+};
 
-  glColor3f(0.7f, 0.7f, 0.7f);
-  glLineWidth(1);
-  glLineStipple(1, 0xAAAA);
-  glEnable(GL_LINE_STIPPLE);
-  glBegin(GL_LINES);
-  glVertex2f(2, -6);
-  glVertex2f(2, 6);
-  glEnd();
-  glDisable(GL_LINE_STIPPLE);
+HeldKeys heldKeys;
 
-  float stripeHeight = 2.0f;
-  glColor3f(ROMANIA_BLUE_R, ROMANIA_BLUE_G, ROMANIA_BLUE_B);
-  glBegin(GL_QUADS);
-  glVertex2f(-10, 6 - stripeHeight);
-  glVertex2f(2, 6 - stripeHeight);
-  glVertex2f(2, 6);
-  glVertex2f(-10, 6);
-  glEnd();
+// --- Input Queue ---
+// Callbacks never touch the simulation: each input becomes a command stamped
+// with the time it arrived. Before every tick the queue hands over the
+// commands up to that tick's end time, in arrival order, as one SimInputs
+// batch. Repeats inside a batch are coalesced: restart presses and level
+// loads count once, and a placement identical to one already in the batch
+// is dropped, so Simulation::step validates each distinct placement once.
 
-  glColor3f(ROMANIA_YELLOW_R, ROMANIA_YELLOW_G, ROMANIA_YELLOW_B);
-  glBegin(GL_QUADS);
-  glVertex2f(-10, 6 - 2 * stripeHeight);
-  glVertex2f(2, 6 - 2 * stripeHeight);
-  glVertex2f(2, 6 - stripeHeight);
-  glVertex2f(-10, 6 - stripeHeight);
-  glEnd();
+enum InputCommandType
+{
+  INPUT_MOVE_PRESS,
+  INPUT_MOVE_RELEASE,
+  INPUT_RESTART,
+  INPUT_PLACE,
+  INPUT_LOAD_LEVEL
+};
 
-  glColor3f(ROMANIA_RED_R, ROMANIA_RED_G, ROMANIA_RED_B);
+struct InputCommand
+{
+  InputCommandType type;
+  double time; // nowSeconds() when it arrived
+  int moveKey; // MOVE_PRESS / MOVE_RELEASE
+  int source;
+  Placement placement;     // PLACE
+  const char *path;        // LOAD_LEVEL
+};
+
+struct InputQueue
+{
+  std::vector<InputCommand> commands; // arrival order, so also time order
+  long received = 0;
+  long coalesced = 0;
+
+  void push(const InputCommand &command);
+  void pushMove(InputCommandType type, int moveKey, int source, double time);
+  void pushRestart(double time);
+  void pushPlacement(const Placement &placement, double time);
+  void pushLevelLoad(const char *path, double time);
+  void drain(double tickEnd, HeldKeys &keys, SimInputs &out);
+};
+
+InputQueue inputQueue;
+
+// --- AUDIO SYSTEM ---
+// Sounds are decoded once to 16-bit stereo PCM and mixed in-process on a
+// dedicated real-time thread that feeds an output backend one period at a
+// time. The game thread controls it only through a lock-free command queue,
+// so it never forks, execs, sleeps or waits on a player process.
+
+const int AUDIO_SAMPLE_RATE = 44100;
+const int AUDIO_CHANNELS = 2;
+const int AUDIO_PERIOD_FRAMES = 128; // ~2.9 ms mixed per wakeup
+const int AUDIO_MAX_VOICES = 8;
+
+enum SoundId
+{
+  SOUND_BACKGROUND,
+  SOUND_WIN,
+  SOUND_LOSE,
+  SOUND_TAKEOFF,
+  SOUND_COUNT, // the game's sounds, see soundPaths
+  // Mixer slots of --audio-bench, so it never replaces a game sound
+  SOUND_BENCH_EFFECT = SOUND_COUNT,
+  SOUND_BENCH_STREAM,
+  AUDIO_SLOT_COUNT
+};
+
+struct AudioClip
+{
+  std::vector<short> samples; // interleaved stereo
+  int frames = 0;
+};
+
+// Lock-free single-producer/single-consumer PCM ring: the prefetch thread
+// writes, the mixer thread reads. Counters run freely and wrap by capacity.
+struct PcmRing
+{
+  std::vector<short> samples; // interleaved stereo
+  int capacity = 0;           // frames
+  std::atomic<unsigned int> written{0};
+  std::atomic<unsigned int> read{0};
+
+  void allocate(int frames);
+  void reset();
+  int available() const;
+  int space() const;
+  int write(const short *frames, int count);
+  int readInto(short *frames, int count);
+};
+
+// Long tracks are not decoded up front. A stream decodes from the
+// memory-mapped file into its ring a chunk at a time on the prefetch thread,
+// and wraps to the start of the file inside the same decode pass when it
+// loops, so there's no gap. Heap use is the ring plus decoder state.
+struct AudioStream
+{
+  const char *path = NULL;
+  std::atomic<bool> loop{false}; // set by the worker, read by the prefetch thread
+  bool synthesized = false; // sine tone source for the benchmark
+  const unsigned char *data = NULL; // mapped file
+  size_t size = 0;
+  size_t feedOffset = 0;
+  long toneFrame = 0;
+#if defined(__APPLE__)
+  AudioFileID fileID = NULL;
+  ExtAudioFileRef file = NULL;
+#elif defined(AUDIO_HAVE_MPG123)
+  mpg123_handle *handle = NULL;
+#endif
+
+  PcmRing ring;
+  // Set by the mixer when its voice ends; the mixer leaves the ring alone
+  // until the prefetch thread has rewound it to the start of the track
+  std::atomic<bool> rewindPending{false};
+  std::atomic<bool> ended{false}; // non-looping track fully decoded into the ring
+  std::atomic<long> underrunFrames{0};
+};
+
+struct AudioVoice
+{
+  SoundId sound;
+  int position; // frame
+  bool loop;
+  bool active;
+  float gain;
+  float fadeStep;      // gain change per frame while fadeFrames > 0
+  int fadeFrames;
+  bool stopAfterFade;  // fade out, then stop
+  double requestTime;  // nowSeconds() of the play command until it is first heard
+};
+
+// Commands from the game thread to the audio worker
+enum AudioCommandType
+{
+  AUDIO_CMD_PLAY,
+  AUDIO_CMD_STOP,
+  AUDIO_CMD_LOOP,
+  AUDIO_CMD_FADE
+};
+
+struct AudioCommand
+{
+  AudioCommandType type;
+  SoundId sound;
+  bool loop;       // PLAY, LOOP
+  float gain;      // FADE target
+  float seconds;   // FADE duration
+  double requestTime;
+};
+
+// Lock-free single-producer/single-consumer queue: the game thread pushes,
+// the audio worker pops. Full means the worker is stalled; the command is
+// dropped and counted rather than blocking the frame.
+const int AUDIO_COMMAND_CAPACITY = 64; // power of two
+
+struct AudioCommandQueue
+{
+  AudioCommand commands[AUDIO_COMMAND_CAPACITY];
+  std::atomic<unsigned int> head{0}; // next push
+  std::atomic<unsigned int> tail{0}; // next pop
+  std::atomic<long> dropped{0};
+
+  bool push(const AudioCommand &command);
+  bool pop(AudioCommand &command);
+  bool empty() const;
+};
+
+// An output device, or a stand-in for one. write() blocks until the device
+// has room, which is what paces the mixer thread.
+struct AudioBackend
+{
+  const char *name;
+  bool (*open)(const char *target);
+  bool (*write)(const short *frames, int count);
+  void (*close)();
+};
+
+const int AUDIO_LATENCY_SAMPLES = 8192;
+
+struct AudioLatency
+{
+  long count = 0;
+  double totalUs = 0, minUs = 0, maxUs = 0;
+  std::vector<float> samples; // first AUDIO_LATENCY_SAMPLES, for the p99
+
+  void add(double us);
+  float p99() const;
+  void print(const char *label) const;
+};
+
+const int STREAM_RING_FRAMES = AUDIO_SAMPLE_RATE; // 1 s of PCM per stream
+const int STREAM_DECODE_CHUNK = 4096;             // frames per decode call
+
+struct AudioMixer
+{
+  AudioClip clips[AUDIO_SLOT_COUNT];
+  AudioStream *streams[AUDIO_SLOT_COUNT] = {}; // sounds played from a stream instead of a clip
+  pthread_t prefetchThread;
+  bool prefetchStarted = false;
+  AudioVoice voices[AUDIO_MAX_VOICES] = {}; // owned by the worker thread
+  AudioBackend backend = {};
+  pthread_t thread;
+  std::atomic<bool> running{false};
+  std::atomic<long> periods{0};
+
+  // The worker sleeps on wake when no voice is playing; push() signals it
+  AudioCommandQueue queue;
+  pthread_mutex_t wakeLock = PTHREAD_MUTEX_INITIALIZER;
+  pthread_cond_t wake = PTHREAD_COND_INITIALIZER;
+  std::atomic<bool> sleeping{false};
+
+  // Command: request until the worker applies it. Effect: request until the
+  // first period that carries the change is handed to the backend.
+  AudioLatency commandLatency, effectLatency;
+  double appliedStops[AUDIO_COMMAND_CAPACITY]; // stop requests awaiting their period
+  int appliedStopCount = 0;
+
+  bool start(const AudioBackend &output, const char *target);
+  void shutdown();
+  void send(const AudioCommand &command);
+  void play(SoundId sound, bool loop);
+  void stop(SoundId sound);
+  void setLoop(SoundId sound, bool loop);
+  void fade(SoundId sound, float gain, float seconds);
+  void apply(const AudioCommand &command, double now);
+  bool anyActive() const;
+  void mix(short *out, int frames, double now);
+};
+
+AudioMixer audioMixer;
+
+// Audio fallback flags, written and read on the GL thread only
+bool audioAssetsAvailable = true;
+bool backgroundMusicAvailable = true;
+bool winMusicAvailable = true;
+bool loseMusicAvailable = true;
+bool takeoffSoundAvailable = true;
+
+// --- Map Tiles ---
+// The airport map stays memory-mapped and is drawn as MAP_TILE_SIZE tiles.
+// Only tiles that intersect the view are uploaded, into a fixed pool of tile
+// textures that is recycled least recently used first, so VRAM and upload
+// bandwidth per frame stay bounded however large the map file is. A
+// zoomed-out view draws tiles of a coarser mip level, the one whose texels
+// are closest to one per screen pixel, so it touches about as many tiles as
+// the default view does. A coarse tile is built when first drawn, as a 2x2
+// box filter of the four tiles under it one level finer, and kept in a
+// bounded CPU cache; only the part of the map that is actually viewed is
+// read from the mapping.
+
+const int MAP_TILE_SIZE = 256;
+const int MAP_TILE_CACHE_SLOTS = 64;       // 64 RGB tiles: 12 MB of VRAM
+const int MAP_TILE_UPLOADS_PER_FRAME = 16; // tiles past the budget draw the fallback until a later frame
+const int MAP_COARSE_TILE_LIMIT = 128;     // built coarse tiles kept on the CPU: 24 MB
+const int MAP_TILE_BUILDS_PER_FRAME = 8;   // coarse tiles built per frame, the finer ones they need included
+const int MAP_MAX_LEVELS = 8;
+// The shipped map fills the game area at the default camera; other maps keep
+// its world units per pixel, so a larger one extends past the window
+const int MAP_REFERENCE_WIDTH = 1920;
+const int MAP_REFERENCE_HEIGHT = 544;
+
+struct MapLevel
+{
+  int width, height;
+  int tilesX, tilesY;
+};
+
+struct MapTileSlot
+{
+  GLuint texture; // 0 until the slot is first used
+  int key;        // level, tileY * tilesX + tileX (see tileKey()); -1 when free
+  long lastUsed;  // frame the tile was last drawn
+  bool flipped;   // texture row 0 is the tile's top row (top-down level 0 tiles)
+};
+
+// A built tile of level 1 or up: MAP_TILE_SIZE rows of MAP_TILE_SIZE BGR
+// texels from the bottom up, edges past the level's size repeated
+struct MapCoarseTile
+{
+  std::vector<unsigned char> pixels;
+  long lastUsed;
+};
+
+struct TiledMap
+{
+  // Written by the asset worker before attach(); read-only afterwards
+  BMPImage image; // level 0, kept mapped for the whole run
+  bool topDown = false;
+  MapLevel levels[MAP_MAX_LEVELS] = {};
+  int levelCount = 0;
+
+  // GL thread only
+  bool attached = false;
+  MapTileSlot slots[MAP_TILE_CACHE_SLOTS] = {};
+  std::unordered_map<int, int> residentSlots; // tile key -> slot
+  std::unordered_map<int, MapCoarseTile> coarseTiles;
+  std::vector<unsigned char> staging; // level 0 edge tile with repeated edges
+  long frame = 0;
+  int uploadsThisFrame = 0;
+  int buildsThisFrame = 0;
+  int drawnLevel = 0;
+
+  void buildLevels(const BMPImage &source);
+  bool ready() const;
+  void attach();
+  int selectLevel(float zoom) const;
+  const unsigned char *baseRow(int row) const;
+  const unsigned char *coarseTile(int level, int tile);
+  int residentSlot(int level, int tile);
+  void draw(float viewLeft, float viewBottom, float viewRight, float viewTop, float zoom);
+};
+
+TiledMap mapTiles;
+
+// --- Camera Zoom ---
+// The view scales about the window centre, where the player is drawn. Below
+// LOW_DETAIL_ZOOM sprites draw as single flat-coloured quads and the world
+// labels are skipped.
+
+const float MIN_ZOOM = 0.25f;
+const float MAX_ZOOM = 2.0f;
+const float ZOOM_STEP = 1.25f; // per wheel notch or +/- press
+const float LOW_DETAIL_ZOOM = 0.5f;
+
+float viewZoom = 1.0f;
+bool lowDetailSprites = false; // set while the world is drawn below LOW_DETAIL_ZOOM
+
+// The visible part of the world, and how far past it an entity's position
+// may lie and still show: the largest entity sprite at its 1.2x power-up
+// pulse, and the boarding pass label, stay within this margin
+struct ViewRect
+{
+  float left, bottom, right, top;
+};
+
+const float ENTITY_CULL_MARGIN = 48.0f;
+
+void zoomBy(float factor);
+void applyViewZoom();
+void screenToWorld(float screenX, float screenY, float cameraX, float cameraY, float &worldX, float &worldY);
+ViewRect worldView(float cameraX, float cameraY);
+bool pointInView(const ViewRect &view, float x, float y, float margin);
+float lerp(float a, float b, float t);
+GLuint playerTexture, planeTexture, guardTexture, boardingPassTexture;
+GLuint friendTexture, badgeTexture, fastTrackTexture, luggageTexture, panelTexture;
+
+// --- Asset Loading ---
+// The map image and the sounds load on a small worker pool while the window
+// is already drawing. Workers only read files and fill CPU memory; anything
+// that needs GL is handed back and uploaded by the GL thread at the start of
+// the next frame (pumpUploads()).
+
+struct AssetJob
+{
+  const char *name;
+  bool (*load)(AssetJob &job);   // worker thread
+  void (*upload)(AssetJob &job); // GL thread, after a successful load; may be NULL
+  int sound;                     // SoundId of an audio job, -1 otherwise
+  const char *path;
+  BMPImage image;
+  bool loaded;
+  double loadSeconds;
+};
+
+const int ASSET_MAX_WORKERS = 4;
+
+struct AssetLoader
+{
+  std::vector<AssetJob> jobs;  // fixed once start() runs
+  std::atomic<int> nextJob{0}; // next job a worker claims
+  pthread_t workers[ASSET_MAX_WORKERS];
+  int workerCount = 0;
+  pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+  std::vector<int> loadedJobs; // loaded, waiting for the GL thread; guarded by lock
+  int remaining = 0;           // jobs the GL thread has not finished yet
+  int soundsRemaining = 0;     // the mixer starts once this reaches 0
+  double launchTime = 0, startTime = 0, firstFrameTime = 0;
+
+  void add(const AssetJob &job);
+  void start();
+  void pumpUploads();
+  void frameShown();
+};
+
+AssetLoader assetLoader;
+
+bool checkCollision(float x1, float y1, float w1, float h1,
+                    float x2, float y2, float w2, float h2);
+
+// --- AUDIO FUNCTIONS ---
+void startBackgroundMusic();
+void startWinMusic();
+void startLoseMusic();
+void startTakeoffSound();
+void stopBackgroundMusic();
+void stopWinMusic();
+void stopLoseMusic();
+void stopTakeoffSound();
+void cleanupAudio();
+bool loadSoundAsset(SoundId sound);
+void setSoundAvailable(SoundId sound, bool available);
+bool checkAudioAssets();
+bool startAudio();
+void shutdownAudio();
+
+double nowSeconds()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+bool extensionListHas(const char *extensions, const char *name)
+{
+  if (!extensions)
+    return false;
+  size_t len = strlen(name);
+  for (const char *p = strstr(extensions, name); p; p = strstr(p + len, name))
+  {
+    if ((p == extensions || p[-1] == ' ') && (p[len] == ' ' || p[len] == '\0'))
+      return true;
+  }
+  return false;
+}
+
+bool hasGLExtension(const char *name)
+{
+  return extensionListHas((const char *)glGetString(GL_EXTENSIONS), name);
+}
+
+// --- TEXT RENDERING ---
+// GLUT bitmap fonts are rasterized once into glyph atlas textures (through an
+// FBO, at startup). A string becomes one batch of textured quads, and the
+// batch is cached by (font, text), so HUD strings that did not change cost a
+// single glDrawArrays. Alpha test keeps the hard bitmap edges. Without FBO
+// support, print() falls back to glutBitmapCharacter.
+
+const int GLYPH_FIRST = 32;
+const int GLYPH_LAST = 255; // GLUT fonts carry Latin-1 glyphs above 127
+const int ATLAS_COLUMNS = 16;
+const int ATLAS_ROWS = (GLYPH_LAST - GLYPH_FIRST + 1 + ATLAS_COLUMNS - 1) / ATLAS_COLUMNS;
+
+struct GlyphAtlas
+{
+  void *font;
+  int cellWidth, cellHeight;
+  int baseline; // raster origin height inside a cell
+  int padX;     // raster origin x inside a cell, room for negative bearings
+  GLuint texture;
+  float advance[GLYPH_LAST + 1];
+};
+
+enum AtlasId
+{
+  ATLAS_TIMES_ROMAN_24,
+  ATLAS_HELVETICA_12,
+  ATLAS_HELVETICA_10,
+  ATLAS_COUNT
+};
+
+GlyphAtlas glyphAtlases[ATLAS_COUNT] = {
+    {GLUT_BITMAP_TIMES_ROMAN_24, 32, 32, 8, 4, 0, {0}},
+    {GLUT_BITMAP_HELVETICA_12, 16, 20, 5, 2, 0, {0}},
+    {GLUT_BITMAP_HELVETICA_10, 16, 16, 4, 2, 0, {0}},
+};
+bool glyphAtlasReady = false;
+
+// Quads for one string, relative to its raster position: x, y, u, v per vertex
+struct TextLayout
+{
+  std::vector<float> vertices;
+  float width;
+};
+
+const size_t TEXT_LAYOUT_CACHE_LIMIT = 512;
+std::unordered_map<std::string, TextLayout> textLayoutCache;
+unsigned long textLayoutHits = 0;
+unsigned long textLayoutMisses = 0;
+
+// Renders the font's glyphs into a new texture attached to fbo; false when
+// the framebuffer is incomplete
+bool buildGlyphAtlas(GlyphAtlas &atlas, GLuint fbo)
+{
+  int width = ATLAS_COLUMNS * atlas.cellWidth;
+  int height = ATLAS_ROWS * atlas.cellHeight;
+
+  glGenTextures(1, &atlas.texture);
+  glBindTexture(GL_TEXTURE_2D, atlas.texture);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+  glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, fbo);
+  glFramebufferTexture2DEXT(GL_FRAMEBUFFER_EXT, GL_COLOR_ATTACHMENT0_EXT, GL_TEXTURE_2D, atlas.texture, 0);
+  if (glCheckFramebufferStatusEXT(GL_FRAMEBUFFER_EXT) != GL_FRAMEBUFFER_COMPLETE_EXT)
+    return false;
+  glViewport(0, 0, width, height);
+  glMatrixMode(GL_PROJECTION);
+  glLoadIdentity();
+  gluOrtho2D(0, width, 0, height);
+  glMatrixMode(GL_MODELVIEW);
+  glLoadIdentity();
+
+  glClearColor(0, 0, 0, 0);
+  glClear(GL_COLOR_BUFFER_BIT);
+  glColor4f(1, 1, 1, 1);
+  for (int c = GLYPH_FIRST; c <= GLYPH_LAST; c++)
+  {
+    int cell = c - GLYPH_FIRST;
+    glRasterPos2i((cell % ATLAS_COLUMNS) * atlas.cellWidth + atlas.padX,
+                  (cell / ATLAS_COLUMNS) * atlas.cellHeight + atlas.baseline);
+    glutBitmapCharacter(atlas.font, c);
+    atlas.advance[c] = (float)glutBitmapWidth(atlas.font, c);
+  }
+  return true;
+}
+
+void initGlyphAtlases()
+{
+  glyphAtlasReady = false;
+  if (!hasGLExtension("GL_EXT_framebuffer_object"))
+  {
+    printf("INFO: No framebuffer objects - text uses glutBitmapCharacter\n");
+    return;
+  }
+
+  glPushAttrib(GL_ALL_ATTRIB_BITS);
+  glMatrixMode(GL_PROJECTION);
+  glPushMatrix();
+  glMatrixMode(GL_MODELVIEW);
+  glPushMatrix();
+  glDisable(GL_TEXTURE_2D);
+
+  GLuint fbo;
+  glGenFramebuffersEXT(1, &fbo);
+  bool ok = true;
+  for (auto &atlas : glyphAtlases)
+    ok = buildGlyphAtlas(atlas, fbo) && ok;
+  glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, 0);
+  glDeleteFramebuffersEXT(1, &fbo);
+
+  glMatrixMode(GL_PROJECTION);
+  glPopMatrix();
+  glMatrixMode(GL_MODELVIEW);
+  glPopMatrix();
+  glPopAttrib();
+
+  glyphAtlasReady = ok;
+  printf("DEBUG: Glyph atlases %s\n", ok ? "ready" : "incomplete - using glutBitmapCharacter");
+}
+
+const TextLayout &layoutText(AtlasId id, const char *string)
+{
+  std::string key(1, (char)id);
+  key += string;
+  auto it = textLayoutCache.find(key);
+  if (it != textLayoutCache.end())
+  {
+    textLayoutHits++;
+    return it->second;
+  }
+  textLayoutMisses++;
+
+  if (textLayoutCache.size() >= TEXT_LAYOUT_CACHE_LIMIT)
+    textLayoutCache.clear();
+
+  const GlyphAtlas &atlas = glyphAtlases[id];
+  float texW = (float)(ATLAS_COLUMNS * atlas.cellWidth);
+  float texH = (float)(ATLAS_ROWS * atlas.cellHeight);
+
+  TextLayout &layout = textLayoutCache[key];
+  float pen = 0;
+  for (const unsigned char *p = (const unsigned char *)string; *p; p++)
+  {
+    int c = *p;
+    if (c < GLYPH_FIRST)
+      continue;
+    int cell = c - GLYPH_FIRST;
+    float u0 = (cell % ATLAS_COLUMNS) * atlas.cellWidth / texW;
+    float v0 = (cell / ATLAS_COLUMNS) * atlas.cellHeight / texH;
+    float u1 = u0 + atlas.cellWidth / texW;
+    float v1 = v0 + atlas.cellHeight / texH;
+    float x0 = pen - atlas.padX;
+    float y0 = (float)-atlas.baseline;
+    float x1 = x0 + atlas.cellWidth;
+    float y1 = y0 + atlas.cellHeight;
+    float quad[16] = {x0, y0, u0, v0, x1, y0, u1, v0, x1, y1, u1, v1, x0, y1, u0, v1};
+    layout.vertices.insert(layout.vertices.end(), quad, quad + 16);
+    pen += atlas.advance[c];
+  }
+  layout.width = pen;
+  return layout;
+}
+
+// Draws string with its raster origin at (x, y) in the current modelview,
+// tinted by the current color, like glRasterPos2f + glutBitmapCharacter
+void drawText(AtlasId id, float x, float y, const char *string)
+{
+  if (!glyphAtlasReady)
+  {
+    glRasterPos2f(x, y);
+    for (const char *p = string; *p; p++)
+    {
+      glutBitmapCharacter(glyphAtlases[id].font, *p);
+    }
+    return;
+  }
+
+  const TextLayout &layout = layoutText(id, string);
+  if (layout.vertices.empty())
+    return;
+
+  glPushAttrib(GL_ENABLE_BIT | GL_TEXTURE_BIT | GL_COLOR_BUFFER_BIT);
+  glEnable(GL_TEXTURE_2D);
+  glBindTexture(GL_TEXTURE_2D, glyphAtlases[id].texture);
+  glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+  glEnable(GL_ALPHA_TEST);
+  glAlphaFunc(GL_GREATER, 0.5f);
+
+  glPushMatrix();
+  glTranslatef(x, y, 0);
+  glEnableClientState(GL_VERTEX_ARRAY);
+  glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+  glVertexPointer(2, GL_FLOAT, 4 * sizeof(float), &layout.vertices[0]);
+  glTexCoordPointer(2, GL_FLOAT, 4 * sizeof(float), &layout.vertices[2]);
+  glDrawArrays(GL_QUADS, 0, (GLsizei)(layout.vertices.size() / 4));
+  glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+  glDisableClientState(GL_VERTEX_ARRAY);
+  glPopMatrix();
+
+  glPopAttrib();
+}
+
+void print(int x, int y, char *string)
+{
+  drawText(ATLAS_TIMES_ROMAN_24, x, y, string);
+}
+
+// --- SPRITE GEOMETRY ---
+// Every procedural sprite is tessellated once at startup into one shared
+// vertex buffer of colored triangles. Polygons are fanned, lines become thin
+// quads and points become small squares, so drawing a sprite is one transform
+// plus one glDrawArrays over its range.
+
+struct SpriteVertex
+{
+  float x, y;
+  float r, g, b;
+};
+
+struct SpriteRange
+{
+  int first;
+  int count;
+};
+
+enum SpriteId
+{
+  SPRITE_PLAYER,
+  SPRITE_PLANE,
+  SPRITE_GUARD,
+  SPRITE_BOARDING_PASS,
+  SPRITE_FRIEND,
+  SPRITE_MANAGER_BADGE,
+  SPRITE_FAST_TRACK,
+  SPRITE_STRESS_FULL,
+  SPRITE_STRESS_EMPTY,
+  SPRITE_TRAVELER,
+  SPRITE_COUNT
+};
+
+std::vector<SpriteVertex> spriteVertices;
+SpriteRange spriteRanges[SPRITE_COUNT];
+SpriteRange lowDetailRanges[SPRITE_COUNT]; // one quad per sprite, drawn at low zoom
+GLuint spriteVBO = 0;
+float meshR = 1, meshG = 1, meshB = 1;
+
+void meshColor(float r, float g, float b)
+{
+  meshR = r;
+  meshG = g;
+  meshB = b;
+}
+
+void meshVertex(float x, float y)
+{
+  spriteVertices.push_back({x, y, meshR, meshG, meshB});
+}
+
+void meshTriangle(float x0, float y0, float x1, float y1, float x2, float y2)
+{
+  meshVertex(x0, y0);
+  meshVertex(x1, y1);
+  meshVertex(x2, y2);
+}
+
+// Convex polygon or quad given as x,y pairs, fanned from the first vertex
+void meshPolygon(const float *xy, int n)
+{
+  for (int i = 1; i + 1 < n; i++)
+  {
+    meshTriangle(xy[0], xy[1], xy[2 * i], xy[2 * i + 1], xy[2 * i + 2], xy[2 * i + 3]);
+  }
+}
+
+void meshQuad(float x0, float y0, float x1, float y1, float x2, float y2, float x3, float y3)
+{
+  float xy[8] = {x0, y0, x1, y1, x2, y2, x3, y3};
+  meshPolygon(xy, 4);
+}
+
+// Vertices firstStep..lastStep-1 of the ellipse sampled at `steps` per turn,
+// using the same angles the immediate-mode loops did
+void meshEllipse(float cx, float cy, float rx, float ry, int firstStep, int lastStep, int steps)
+{
+  std::vector<float> xy;
+  for (int i = firstStep; i < lastStep; i++)
+  {
+    float theta = 2.0f * 3.1415926f * float(i) / float(steps);
+    xy.push_back(cx + rx * cosf(theta));
+    xy.push_back(cy + ry * sinf(theta));
+  }
+  meshPolygon(xy.data(), (int)xy.size() / 2);
+}
+
+void meshLine(float x0, float y0, float x1, float y1, float width)
+{
+  float dx = x1 - x0, dy = y1 - y0;
+  float len = sqrtf(dx * dx + dy * dy);
+  if (len == 0)
+    return;
+  float nx = -dy / len * width / 2, ny = dx / len * width / 2;
+  meshQuad(x0 + nx, y0 + ny, x1 + nx, y1 + ny, x1 - nx, y1 - ny, x0 - nx, y0 - ny);
+}
+
+void meshPoint(float x, float y, float size)
+{
+  float h = size / 2;
+  meshQuad(x - h, y - h, x + h, y - h, x + h, y + h, x - h, y + h);
+}
+
+void buildPlayerSprite()
+{
+  meshColor(0.95f, 0.87f, 0.73f);
+  meshEllipse(0, 8, 5, 5, 0, 20, 20);
+
+  meshColor(0.1f, 0.1f, 0.15f);
+  meshEllipse(0, 9, 6, 6, 0, 20, 20);
+
+  meshColor(0.4f, 0.4f, 0.5f);
+  meshQuad(-8, 3, 8, 3, 10, -8, -10, -8);
+
+  meshColor(ROMANIA_BLUE_R, ROMANIA_BLUE_G, ROMANIA_BLUE_B);
+  meshLine(0, 3, 0, -5, 2);
+
+  meshColor(0.2f, 0.2f, 0.25f);
+  meshQuad(-10, -8, 10, -8, 8, -15, -8, -15);
+
+  meshColor(0.7f, 0.5f, 0.3f);
+  meshQuad(10, 0, 16, 0, 16, -10, 10, -10);
+
+  meshColor(ROMANIA_RED_R, ROMANIA_RED_G, ROMANIA_RED_B);
+  meshQuad(13, -8, 15, -8, 15, -6, 13, -6);
+
+  meshColor(ROMANIA_YELLOW_R, ROMANIA_YELLOW_G, ROMANIA_YELLOW_B);
+  meshLine(13, 0, 13, 3, 3);
+
+  meshColor(0.95f, 0.87f, 0.73f);
+  meshTriangle(-8, 2, -12, 0, -8, -2);
+
+  meshColor(0.0f, 0.0f, 0.0f);
+  meshPoint(-2, 9, 3);
+  meshPoint(2, 9, 3);
+}
+
+void buildPlaneSprite()
+{
+  meshColor(0.95f, 0.95f, 0.98f);
+  float body[16] = {-30, -6, 25, -6, 30, -3, 30, 3, 25, 6, -30, 6, -35, 3, -35, -3};
+  meshPolygon(body, 8);
+
+  meshColor(0.85f, 0.85f, 0.88f);
+  meshTriangle(-20, 0, -35, -18, -10, -18);
+  meshTriangle(20, 0, 35, -18, 10, -18);
+
+  float tailWidth = 10;
+  float tailHeight = 12;
+
+  meshColor(ROMANIA_BLUE_R, ROMANIA_BLUE_G, ROMANIA_BLUE_B);
+  meshQuad(-30, 0, -30 - tailWidth / 3, 0, -30 - tailWidth / 3, tailHeight, -30, tailHeight);
+
+  meshColor(ROMANIA_YELLOW_R, ROMANIA_YELLOW_G, ROMANIA_YELLOW_B);
+  meshQuad(-30 - tailWidth / 3, 0, -30 - 2 * tailWidth / 3, 0,
+           -30 - 2 * tailWidth / 3, tailHeight, -30 - tailWidth / 3, tailHeight);
+
+  meshColor(ROMANIA_RED_R, ROMANIA_RED_G, ROMANIA_RED_B);
+  meshQuad(-30 - 2 * tailWidth / 3, 0, -30 - tailWidth, 0,
+           -30 - tailWidth, tailHeight, -30 - 2 * tailWidth / 3, tailHeight);
+
+  meshColor(0.4f, 0.6f, 0.8f);
+  for (int i = -20; i < 20; i += 8)
+  {
+    meshPoint(i, 2, 4);
+  }
+}
+
+void buildGuardSprite()
+{
+  meshColor(0.95f, 0.87f, 0.73f);
+  meshEllipse(0, 10, 4, 4, 0, 20, 20);
+
+  meshColor(ROMANIA_BLUE_R, ROMANIA_BLUE_G, ROMANIA_BLUE_B);
+  meshEllipse(0, 11, 5, 4.5f, 10, 30, 20);
+
+  meshColor(0.1f, 0.1f, 0.2f);
+  meshQuad(-6, 10, 6, 10, 7, 8, -7, 8);
+
+  meshColor(0.1f, 0.1f, 0.3f);
+  meshQuad(-7, 7, 7, 7, 7, -12, -7, -12);
+
+  meshColor(ROMANIA_RED_R, ROMANIA_RED_G, ROMANIA_RED_B);
+  meshTriangle(-1, 5, 1, 5, 0, 0);
+
+  meshColor(ROMANIA_YELLOW_R, ROMANIA_YELLOW_G, ROMANIA_YELLOW_B);
+  meshEllipse(-4, 2, 2, 2, 0, 6, 6);
+
+  meshColor(0.95f, 0.87f, 0.73f);
+  meshQuad(-7, 5, -10, 3, -10, -3, -7, -1);
+
+  meshColor(0.2f, 0.2f, 0.2f);
+  meshQuad(7, 0, 12, -2, 12, -4, 7, -2);
+}
+
+void buildBoardingPassSprite()
+{
+  meshColor(1.0f, 0.98f, 0.95f);
+  meshQuad(-10, -6, 10, -6, 10, 6, -10, 6);
+
+  // Perforation: 0xAAAA stipple lights every other pixel of the tear line
+  meshColor(0.7f, 0.7f, 0.7f);
+  for (int y = -5; y < 6; y += 2)
+  {
+    meshLine(2, y, 2, y + 1, 1);
+  }
+
+  float stripeHeight = 2.0f;
+  meshColor(ROMANIA_BLUE_R, ROMANIA_BLUE_G, ROMANIA_BLUE_B);
+  meshQuad(-10, 6 - stripeHeight, 2, 6 - stripeHeight, 2, 6, -10, 6);
+
+  meshColor(ROMANIA_YELLOW_R, ROMANIA_YELLOW_G, ROMANIA_YELLOW_B);
+  meshQuad(-10, 6 - 2 * stripeHeight, 2, 6 - 2 * stripeHeight, 2, 6 - stripeHeight, -10, 6 - stripeHeight);
+
+  meshColor(ROMANIA_RED_R, ROMANIA_RED_G, ROMANIA_RED_B);
+  meshQuad(-10, 6 - 3 * stripeHeight, 2, 6 - 3 * stripeHeight, 2, 6 - 2 * stripeHeight, -10, 6 - 2 * stripeHeight);
+
+  // Barcode
+  meshColor(0.0f, 0.0f, 0.0f);
+  for (int i = -8; i < 0; i += 1)
+  {
+    meshLine(i, -5, i, (i % 2 == 0) ? -1 : -2, 1);
+  }
+}
+
+void buildFriendSprite()
+{
+  // Headscarf covering head and shoulders
+  meshColor(1.0f, 1.0f, 1.0f);
+  float scarf[12] = {-8, 12, 8, 12, 10, 2, 8, -2, -8, -2, -10, 2};
+  meshPolygon(scarf, 6);
+
+  meshColor(0.9f, 0.9f, 0.9f);
+  meshQuad(-8, -2, 8, -2, 6, -8, -6, -8);
+
+  // White circle outline for hijab opening
+  meshColor(1.0f, 1.0f, 1.0f);
+  meshEllipse(0, 8, 5, 5, 0, 20, 20);
+
+  // Skin-toned face inside the white circle
+  meshColor(0.92f, 0.84f, 0.70f);
+  meshEllipse(0, 8, 4, 4, 0, 20, 20);
+
+  // Body
+  meshColor(0.3f, 0.4f, 0.6f);
+  meshQuad(-8, 2, 8, 2, 9, -8, -9, -8);
+
+  meshColor(0.2f, 0.2f, 0.3f);
+  meshQuad(-9, -8, 9, -8, 8, -15, -8, -15);
+
+  meshColor(0.4f, 0.4f, 0.4f);
+  meshQuad(-12, 0, -8, 0, -8, -6, -12, -6);
+
+  meshColor(0.2f, 0.2f, 0.2f);
+  meshLine(-10, 0, -6, 2, 2);
+  meshLine(-10, -3, -6, -1, 2);
+
+  meshColor(0.92f, 0.84f, 0.70f);
+  meshTriangle(8, 1, 12, 4, 8, -2);
+
+  // Eyes
+  meshColor(0.0f, 0.0f, 0.0f);
+  meshPoint(-2, 9, 2);
+  meshPoint(2, 9, 2);
+}
+
+void buildManagerBadgeSprite()
+{
+  meshColor(ROMANIA_YELLOW_R, ROMANIA_YELLOW_G, ROMANIA_YELLOW_B);
+  meshEllipse(0, 0, 10, 10, 0, 6, 6);
+
+  meshColor(ROMANIA_BLUE_R, ROMANIA_BLUE_G, ROMANIA_BLUE_B);
+  meshEllipse(0, 0, 7, 7, 0, 20, 20);
+
+  // Hexagon border (the VIP label inside it is drawn after the mesh)
+  meshColor(0.0f, 0.0f, 0.0f);
+  for (int i = 0; i < 6; i++)
+  {
+    float theta0 = 2.0f * 3.1415926f * float(i) / 6.0f;
+    float theta1 = 2.0f * 3.1415926f * float((i + 1) % 6) / 6.0f;
+    meshLine(10 * cosf(theta0), 10 * sinf(theta0), 10 * cosf(theta1), 10 * sinf(theta1), 2);
+  }
+}
+
+void buildFastTrackSprite()
+{
+  float stripWidth = 6.6f;
+
+  meshColor(ROMANIA_RED_R, ROMANIA_RED_G, ROMANIA_RED_B);
+  meshQuad(-10, -6, -10 + stripWidth, -6, -10 + stripWidth, 6, -10, 6);
+
+  meshColor(ROMANIA_YELLOW_R, ROMANIA_YELLOW_G, ROMANIA_YELLOW_B);
+  meshQuad(-10 + stripWidth, -6, -10 + 2 * stripWidth, -6, -10 + 2 * stripWidth, 6, -10 + stripWidth, 6);
+
+  meshColor(ROMANIA_BLUE_R, ROMANIA_BLUE_G, ROMANIA_BLUE_B);
+  meshQuad(-10 + 2 * stripWidth, -6, 10, -6, 10, 6, -10 + 2 * stripWidth, 6);
+
+  meshColor(1.0f, 1.0f, 1.0f);
+  meshTriangle(-6, 0, -2, 3, -2, -3);
+  meshTriangle(0, 0, 4, 3, 4, -3);
+  meshTriangle(6, 0, 10, 3, 10, -3);
+}
+
+void buildStressIndicatorSprite(bool filled)
+{
+  meshColor(0.4f, 0.3f, 0.2f);
+  meshQuad(-10, -7, 10, -7, 10, 7, -10, 7);
+
+  if (filled)
+  {
+    meshColor(ROMANIA_RED_R, ROMANIA_RED_G, ROMANIA_RED_B);
+  }
+  else
+  {
+    meshColor(0.3f, 0.3f, 0.3f);
+  }
+  meshQuad(-8, -5, 8, -5, 8, 5, -8, 5);
+
+  meshColor(0.2f, 0.2f, 0.2f);
+  meshLine(-5, 7, -5, 10, 3);
+  meshLine(-5, 10, 5, 10, 3);
+  meshLine(5, 10, 5, 7, 3);
+}
+
+// A passenger seen from above, facing +x, about CROWD_RADIUS across
+void buildTravelerSprite()
+{
+  meshColor(0.35f, 0.45f, 0.6f);
+  meshEllipse(0, 0, 1.2f, 1.8f, 0, 8, 8);
+
+  meshColor(0.3f, 0.2f, 0.15f);
+  meshEllipse(0.3f, 0, 0.8f, 0.8f, 0, 6, 6);
+
+  meshColor(0.2f, 0.2f, 0.2f);
+  meshQuad(-2.4f, 0.8f, -1.2f, 0.8f, -1.2f, 1.8f, -2.4f, 1.8f);
+}
+
+void buildSprite(SpriteId id, void (*build)())
+{
+  spriteRanges[id].first = (int)spriteVertices.size();
+  build();
+  spriteRanges[id].count = (int)spriteVertices.size() - spriteRanges[id].first;
+}
+
+// The sprite's bounding box as one quad in its area-weighted average colour
+void buildLowDetailSprite(SpriteId id)
+{
+  const SpriteRange &range = spriteRanges[id];
+  float minX = 1e9f, minY = 1e9f, maxX = -1e9f, maxY = -1e9f;
+  float area = 0, r = 0, g = 0, b = 0;
+  for (int i = range.first; i + 2 < range.first + range.count; i += 3)
+  {
+    const SpriteVertex *v = &spriteVertices[i];
+    float a = fabsf((v[1].x - v[0].x) * (v[2].y - v[0].y) - (v[2].x - v[0].x) * (v[1].y - v[0].y)) * 0.5f;
+    area += a;
+    r += a * v[0].r;
+    g += a * v[0].g;
+    b += a * v[0].b;
+    for (int k = 0; k < 3; k++)
+    {
+      minX = std::min(minX, v[k].x);
+      maxX = std::max(maxX, v[k].x);
+      minY = std::min(minY, v[k].y);
+      maxY = std::max(maxY, v[k].y);
+    }
+  }
+  lowDetailRanges[id].first = (int)spriteVertices.size();
+  if (area > 0)
+    meshColor(r / area, g / area, b / area);
+  meshTriangle(minX, minY, maxX, minY, maxX, maxY);
+  meshTriangle(minX, minY, maxX, maxY, minX, maxY);
+  lowDetailRanges[id].count = (int)spriteVertices.size() - lowDetailRanges[id].first;
+}
+
+// Range to draw for a sprite at the current level of detail
+const SpriteRange &spriteRange(SpriteId id)
+{
+  return lowDetailSprites ? lowDetailRanges[id] : spriteRanges[id];
+}
+
+void initSpriteGeometry()
+{
+  spriteVertices.clear();
+  buildSprite(SPRITE_PLAYER, buildPlayerSprite);
+  buildSprite(SPRITE_PLANE, buildPlaneSprite);
+  buildSprite(SPRITE_GUARD, buildGuardSprite);
+  buildSprite(SPRITE_BOARDING_PASS, buildBoardingPassSprite);
+  buildSprite(SPRITE_FRIEND, buildFriendSprite);
+  buildSprite(SPRITE_MANAGER_BADGE, buildManagerBadgeSprite);
+  buildSprite(SPRITE_FAST_TRACK, buildFastTrackSprite);
+  buildSprite(SPRITE_STRESS_FULL, []() { buildStressIndicatorSprite(true); });
+  buildSprite(SPRITE_STRESS_EMPTY, []() { buildStressIndicatorSprite(false); });
+  buildSprite(SPRITE_TRAVELER, buildTravelerSprite);
+  for (int i = 0; i < SPRITE_COUNT; i++)
+    buildLowDetailSprite((SpriteId)i);
+
+  glGenBuffers(1, &spriteVBO);
+  glBindBuffer(GL_ARRAY_BUFFER, spriteVBO);
+  glBufferData(GL_ARRAY_BUFFER, spriteVertices.size() * sizeof(SpriteVertex),
+               spriteVertices.data(), GL_STATIC_DRAW);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  printf("DEBUG: Sprite geometry cached: %zu vertices in VBO %u\n", spriteVertices.size(), spriteVBO);
+}
+
+// Draws a cached sprite at the current modelview transform
+void drawSprite(SpriteId id)
+{
+  // Client-side arrays from the CPU copy if the buffer could not be created
+  const char *base = spriteVBO ? NULL : (const char *)spriteVertices.data();
+  glBindBuffer(GL_ARRAY_BUFFER, spriteVBO);
+  glEnableClientState(GL_VERTEX_ARRAY);
+  glEnableClientState(GL_COLOR_ARRAY);
+  glVertexPointer(2, GL_FLOAT, sizeof(SpriteVertex), base + offsetof(SpriteVertex, x));
+  glColorPointer(3, GL_FLOAT, sizeof(SpriteVertex), base + offsetof(SpriteVertex, r));
+  glDrawArrays(GL_TRIANGLES, spriteRange(id).first, spriteRange(id).count);
+  glDisableClientState(GL_COLOR_ARRAY);
+  glDisableClientState(GL_VERTEX_ARRAY);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+// --- DRAWING FUNCTIONS ---
+
+void drawPlayer(float x, float y, float angle)
+{
+  glPushMatrix();
+  glTranslatef(x, y, 0);
+  glRotatef(angle, 0, 0, 1);
+  drawSprite(SPRITE_PLAYER);
+  glPopMatrix();
+}
+
+void drawPlane(float x, float y)
+{
+  glPushMatrix();
+  glTranslatef(x, y, 0);
+  drawSprite(SPRITE_PLANE);
+
+  if (!lowDetailSprites)
+  {
+    glColor3f(ROMANIA_RED_R, ROMANIA_RED_G, ROMANIA_RED_B);
+    drawText(ATLAS_HELVETICA_12, -15, -2, "A01");
+  }
+
+  glPopMatrix();
+}
+
+void drawGuard(float x, float y)
+{
+  glPushMatrix();
+  glTranslatef(x, y, 0);
+  drawSprite(SPRITE_GUARD);
+  glPopMatrix();
+}
+
+// Only the label anchor turns with the pass, the glyphs stay upright
+void drawBoardingPassLabel(float x, float y, float rotation)
+{
+  float a = rotation * 3.1415926f / 180.0f;
+  glColor3f(0.0f, 0.0f, 0.0f);
+  drawText(ATLAS_HELVETICA_10, x - 8 * cosf(a) - 3 * sinf(a), y - 8 * sinf(a) + 3 * cosf(a), "CLJ-MUC");
+}
+
+void drawBoardingPass(float x, float y, float rotation)
+{
+  glPushMatrix();
+  glTranslatef(x, y, 0);
+  glRotatef(rotation, 0, 0, 1);
+  drawSprite(SPRITE_BOARDING_PASS);
+  glPopMatrix();
+
+  if (!lowDetailSprites)
+    drawBoardingPassLabel(x, y, rotation);
+}
+
+void drawFriend(float x, float y)
+{
+  glPushMatrix();
+  glTranslatef(x, y, 0);
+  drawSprite(SPRITE_FRIEND);
+  glPopMatrix();
+}
+
+void drawManagerBadgeLabel(float x, float y, float scale)
+{
+  glColor3f(1.0f, 1.0f, 1.0f);
+  drawText(ATLAS_HELVETICA_12, x - 6 * scale, y - 2 * scale, "VIP");
+}
+
+void drawManagerBadge(float x, float y, float scale)
+{
+  glPushMatrix();
+  glTranslatef(x, y, 0);
+  glScalef(scale, scale, 1);
+  drawSprite(SPRITE_MANAGER_BADGE);
+  glPopMatrix();
+
+  if (!lowDetailSprites)
+    drawManagerBadgeLabel(x, y, scale);
+}
+
+void drawFastTrackPass(float x, float y, float scale)
+{
+  glPushMatrix();
+  glTranslatef(x, y, 0);
+  glScalef(scale, scale, 1);
+  drawSprite(SPRITE_FAST_TRACK);
+  glPopMatrix();
+}
+
+void drawStressIndicator(float x, float y, bool filled)
+{
+  glPushMatrix();
+  glTranslatef(x, y, 0);
+  drawSprite(filled ? SPRITE_STRESS_FULL : SPRITE_STRESS_EMPTY);
+  glPopMatrix();
+}
+
+// --- AUDIO FUNCTION IMPLEMENTATIONS ---
+
+const char *soundPaths[SOUND_COUNT] = {
+    "assets/sounds/Show Me Love - WizTheMc.mp3",
+    "assets/sounds/The Stranglers - Golden Brown.mp3",
+    "assets/sounds/Brazilian Phonk Remix - SoundSorcerer.mp3",
+    "assets/sounds/IndiGo-TakeOff-AirBus-320.mp3"};
+// Music tracks stream; the short takeoff effect is decoded whole
+const bool soundStreamed[SOUND_COUNT] = {true, true, true, false};
+const bool soundLoops[SOUND_COUNT] = {false, true, true, false};
+
+// Runs on the worker; samples was reserved up front so this never allocates
+void AudioLatency::add(double us) {
+    if (count == 0 || us < minUs) minUs = us;
+    if (count == 0 || us > maxUs) maxUs = us;
+    totalUs += us;
+    count++;
+    if ((int)samples.size() < AUDIO_LATENCY_SAMPLES && samples.size() < samples.capacity())
+        samples.push_back((float)us);
+}
+
+float AudioLatency::p99() const {
+    if (samples.empty())
+        return 0;
+    std::vector<float> sorted(samples);
+    std::sort(sorted.begin(), sorted.end());
+    return sorted[(sorted.size() - 1) * 99 / 100];
+}
+
+void AudioLatency::print(const char *label) const {
+    if (count == 0) {
+        printf("AUDIO: %s latency: no samples\n", label);
+        return;
+    }
+    printf("AUDIO: %s latency over %ld requests: min %.0f us, avg %.0f us, p99 %.0f us, max %.0f us\n",
+           label, count, minUs, totalUs / count, p99(), maxUs);
+}
+
+bool AudioCommandQueue::push(const AudioCommand &command) {
+    unsigned int index = head.load(std::memory_order_relaxed);
+    if (index - tail.load(std::memory_order_acquire) >= AUDIO_COMMAND_CAPACITY) {
+        dropped++;
+        return false;
+    }
+    commands[index & (AUDIO_COMMAND_CAPACITY - 1)] = command;
+    head.store(index + 1, std::memory_order_seq_cst);
+    return true;
+}
+
+bool AudioCommandQueue::pop(AudioCommand &command) {
+    unsigned int index = tail.load(std::memory_order_relaxed);
+    if (index == head.load(std::memory_order_acquire))
+        return false;
+    command = commands[index & (AUDIO_COMMAND_CAPACITY - 1)];
+    tail.store(index + 1, std::memory_order_release);
+    return true;
+}
+
+bool AudioCommandQueue::empty() const {
+    return tail.load(std::memory_order_seq_cst) == head.load(std::memory_order_seq_cst);
+}
+
+// --- Decoding ---
+
+#ifdef AUDIO_HAVE_MPG123
+// Sounds are decoded on the asset workers, so the library is set up once
+pthread_once_t mpg123Once = PTHREAD_ONCE_INIT;
+
+static void initMpg123() {
+    mpg123_init();
+}
+#endif
+
+#ifdef __APPLE__
+AudioStreamBasicDescription pcmFormat() {
+    AudioStreamBasicDescription format = {};
+    format.mSampleRate = AUDIO_SAMPLE_RATE;
+    format.mFormatID = kAudioFormatLinearPCM;
+    format.mFormatFlags = kLinearPCMFormatFlagIsSignedInteger | kLinearPCMFormatFlagIsPacked;
+    format.mFramesPerPacket = 1;
+    format.mChannelsPerFrame = AUDIO_CHANNELS;
+    format.mBitsPerChannel = 16;
+    format.mBytesPerFrame = AUDIO_CHANNELS * sizeof(short);
+    format.mBytesPerPacket = format.mBytesPerFrame;
+    return format;
+}
+#endif
+
+// Decodes a whole file to interleaved 16-bit stereo at AUDIO_SAMPLE_RATE
+bool decodeAudioFile(const char *path, AudioClip &clip) {
+    clip.samples.clear();
+    clip.frames = 0;
+#if defined(__APPLE__)
+    CFURLRef url = CFURLCreateFromFileSystemRepresentation(NULL, (const UInt8 *)path, strlen(path), false);
+    ExtAudioFileRef file;
+    OSStatus status = ExtAudioFileOpenURL(url, &file);
+    CFRelease(url);
+    if (status != noErr)
+        return false;
+
+    // ExtAudioFile converts to this format, sample rate included
+    AudioStreamBasicDescription format = pcmFormat();
+    if (ExtAudioFileSetProperty(file, kExtAudioFileProperty_ClientDataFormat, sizeof(format), &format) != noErr) {
+        ExtAudioFileDispose(file);
+        return false;
+    }
+
+    short buffer[4096 * AUDIO_CHANNELS];
+    for (;;) {
+        AudioBufferList list;
+        list.mNumberBuffers = 1;
+        list.mBuffers[0].mNumberChannels = AUDIO_CHANNELS;
+        list.mBuffers[0].mDataByteSize = sizeof(buffer);
+        list.mBuffers[0].mData = buffer;
+        UInt32 frames = 4096;
+        if (ExtAudioFileRead(file, &frames, &list) != noErr || frames == 0)
+            break;
+        clip.samples.insert(clip.samples.end(), buffer, buffer + frames * AUDIO_CHANNELS);
+    }
+    ExtAudioFileDispose(file);
+#elif defined(AUDIO_HAVE_MPG123)
+    pthread_once(&mpg123Once, initMpg123);
+
+    int error = 0;
+    mpg123_handle *handle = mpg123_new(NULL, &error);
+    if (!handle)
+        return false;
+    mpg123_param(handle, MPG123_FLAGS, MPG123_FORCE_STEREO, 0);
+    mpg123_format_none(handle);
+    mpg123_format(handle, AUDIO_SAMPLE_RATE, MPG123_STEREO, MPG123_ENC_SIGNED_16);
+    if (mpg123_open(handle, path) != MPG123_OK) {
+        mpg123_delete(handle);
+        return false;
+    }
+
+    short buffer[4096 * AUDIO_CHANNELS];
+    size_t bytes = 0;
+    int result;
+    do {
+        result = mpg123_read(handle, (unsigned char *)buffer, sizeof(buffer), &bytes);
+        clip.samples.insert(clip.samples.end(), buffer, buffer + bytes / sizeof(short));
+    } while (result == MPG123_OK || result == MPG123_NEW_FORMAT);
+    mpg123_close(handle);
+    mpg123_delete(handle);
+#else
+    printf("DEBUG: No MP3 decoder in this build (%s)\n", path);
+    return false;
+#endif
+    clip.frames = (int)(clip.samples.size() / AUDIO_CHANNELS);
+    return clip.frames > 0;
+}
+
+// A short sine tone, for the audio benchmark when the MP3s can't be decoded
+void synthesizeTone(AudioClip &clip, float frequency, float seconds) {
+    clip.frames = (int)(seconds * AUDIO_SAMPLE_RATE);
+    clip.samples.resize(clip.frames * AUDIO_CHANNELS);
+    for (int i = 0; i < clip.frames; i++) {
+        short value = (short)(8000 * sin(2 * M_PI * frequency * i / AUDIO_SAMPLE_RATE));
+        clip.samples[i * 2] = value;
+        clip.samples[i * 2 + 1] = value;
+    }
+}
+
+// --- Streaming ---
+
+void PcmRing::allocate(int frames) {
+    capacity = frames;
+    samples.assign(frames * AUDIO_CHANNELS, 0);
+    reset();
+}
+
+// Only while the reader is known to be idle
+void PcmRing::reset() {
+    written.store(0, std::memory_order_relaxed);
+    read.store(0, std::memory_order_release);
+}
+
+int PcmRing::available() const {
+    return (int)(written.load(std::memory_order_acquire) - read.load(std::memory_order_acquire));
+}
+
+int PcmRing::space() const {
+    return capacity - available();
+}
+
+int PcmRing::write(const short *frames, int count) {
+    unsigned int head = written.load(std::memory_order_relaxed);
+    count = std::min(count, space());
+    for (int i = 0; i < count; i++) {
+        int slot = (int)((head + i) % capacity);
+        samples[slot * 2] = frames[i * 2];
+        samples[slot * 2 + 1] = frames[i * 2 + 1];
+    }
+    written.store(head + count, std::memory_order_release);
+    return count;
+}
+
+int PcmRing::readInto(short *frames, int count) {
+    unsigned int tail = read.load(std::memory_order_relaxed);
+    count = std::min(count, available());
+    for (int i = 0; i < count; i++) {
+        int slot = (int)((tail + i) % capacity);
+        frames[i * 2] = samples[slot * 2];
+        frames[i * 2 + 1] = samples[slot * 2 + 1];
+    }
+    read.store(tail + count, std::memory_order_release);
+    return count;
+}
+
+#ifdef __APPLE__
+OSStatus streamReadProc(void *clientData, SInt64 position, UInt32 requestCount, void *buffer, UInt32 *actualCount) {
+    AudioStream *stream = (AudioStream *)clientData;
+    UInt32 count = 0;
+    if (position < (SInt64)stream->size)
+        count = (UInt32)std::min<SInt64>(requestCount, stream->size - position);
+    memcpy(buffer, stream->data + position, count);
+    *actualCount = count;
+    return noErr;
+}
+
+SInt64 streamSizeProc(void *clientData) {
+    return ((AudioStream *)clientData)->size;
+}
+#endif
+
+bool openStreamDecoder(AudioStream &stream) {
+#if defined(__APPLE__)
+    if (AudioFileOpenWithCallbacks(&stream, streamReadProc, NULL, streamSizeProc, NULL, kAudioFileMP3Type, &stream.fileID) != noErr)
+        return false;
+    if (ExtAudioFileWrapAudioFileID(stream.fileID, false, &stream.file) != noErr) {
+        AudioFileClose(stream.fileID);
+        return false;
+    }
+    AudioStreamBasicDescription format = pcmFormat();
+    return ExtAudioFileSetProperty(stream.file, kExtAudioFileProperty_ClientDataFormat, sizeof(format), &format) == noErr;
+#elif defined(AUDIO_HAVE_MPG123)
+    pthread_once(&mpg123Once, initMpg123);
+    int error = 0;
+    stream.handle = mpg123_new(NULL, &error);
+    if (!stream.handle)
+        return false;
+    mpg123_param(stream.handle, MPG123_FLAGS, MPG123_FORCE_STEREO, 0);
+    mpg123_format_none(stream.handle);
+    mpg123_format(stream.handle, AUDIO_SAMPLE_RATE, MPG123_STEREO, MPG123_ENC_SIGNED_16);
+    stream.feedOffset = 0;
+    return mpg123_open_feed(stream.handle) == MPG123_OK;
+#else
+    return false;
+#endif
+}
+
+void rewindStreamDecoder(AudioStream &stream) {
+    stream.toneFrame = 0;
+    if (stream.synthesized)
+        return;
+#if defined(__APPLE__)
+    ExtAudioFileSeek(stream.file, 0);
+#elif defined(AUDIO_HAVE_MPG123)
+    mpg123_close(stream.handle);
+    mpg123_open_feed(stream.handle);
+    stream.feedOffset = 0;
+#endif
+}
+
+// Decodes up to maxFrames of PCM; 0 means the end of the track
+int decodeStreamFrames(AudioStream &stream, short *out, int maxFrames) {
+    if (stream.synthesized) {
+        const long toneFrames = 3 * AUDIO_SAMPLE_RATE; // 1320 whole cycles of 440 Hz, so loops are seamless
+        int frames = (int)std::min<long>(maxFrames, toneFrames - stream.toneFrame);
+        for (int i = 0; i < frames; i++) {
+            short value = (short)(8000 * sin(2 * M_PI * 440.0 * (stream.toneFrame + i) / AUDIO_SAMPLE_RATE));
+            out[i * 2] = value;
+            out[i * 2 + 1] = value;
+        }
+        stream.toneFrame += frames;
+        return frames;
+    }
+#if defined(__APPLE__)
+    AudioBufferList list;
+    list.mNumberBuffers = 1;
+    list.mBuffers[0].mNumberChannels = AUDIO_CHANNELS;
+    list.mBuffers[0].mDataByteSize = maxFrames * AUDIO_CHANNELS * sizeof(short);
+    list.mBuffers[0].mData = out;
+    UInt32 frames = maxFrames;
+    if (ExtAudioFileRead(stream.file, &frames, &list) != noErr)
+        return 0;
+    return (int)frames;
+#elif defined(AUDIO_HAVE_MPG123)
+    for (;;) {
+        size_t bytes = 0;
+        int result = mpg123_read(stream.handle, (unsigned char *)out, maxFrames * AUDIO_CHANNELS * sizeof(short), &bytes);
+        if (bytes > 0)
+            return (int)(bytes / (AUDIO_CHANNELS * sizeof(short)));
+        if (result == MPG123_NEW_FORMAT)
+            continue;
+        if (result != MPG123_NEED_MORE || stream.feedOffset >= stream.size)
+            return 0;
+        // Feed the decoder straight from the mapped file
+        size_t count = std::min<size_t>(16384, stream.size - stream.feedOffset);
+        mpg123_feed(stream.handle, stream.data + stream.feedOffset, count);
+        stream.feedOffset += count;
+    }
+#else
+    return 0;
+#endif
+}
+
+void closeAudioStream(AudioStream *stream) {
+#if defined(__APPLE__)
+    if (stream->file)
+        ExtAudioFileDispose(stream->file);
+    if (stream->fileID)
+        AudioFileClose(stream->fileID);
+#elif defined(AUDIO_HAVE_MPG123)
+    if (stream->handle) {
+        mpg123_close(stream->handle);
+        mpg123_delete(stream->handle);
+    }
+#endif
+    if (stream->data)
+        munmap((void *)stream->data, stream->size);
+    delete stream;
+}
+
+AudioStream *openAudioStream(const char *path, bool loop) {
+    AudioStream *stream = new AudioStream();
+    stream->path = path;
+    stream->loop = loop;
+
+    int fd = open(path, O_RDONLY);
+    struct stat info;
+    if (fd >= 0 && fstat(fd, &info) == 0 && info.st_size > 0) {
+        void *mapped = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped != MAP_FAILED) {
+            stream->data = (const unsigned char *)mapped;
+            stream->size = info.st_size;
+            madvise(mapped, info.st_size, MADV_SEQUENTIAL);
+        }
+    }
+    if (fd >= 0)
+        close(fd);
+
+    if (!stream->data || !openStreamDecoder(*stream)) {
+        closeAudioStream(stream);
+        return NULL;
+    }
+    stream->ring.allocate(STREAM_RING_FRAMES);
+    return stream;
+}
+
+AudioStream *openToneStream(bool loop) {
+    AudioStream *stream = new AudioStream();
+    stream->path = "440 Hz tone";
+    stream->loop = loop;
+    stream->synthesized = true;
+    stream->ring.allocate(STREAM_RING_FRAMES);
+    return stream;
+}
+
+// Rewinds a stream the mixer has let go of, then tops its ring up
+void fillStream(AudioStream &stream, short *chunk) {
+    if (stream.rewindPending.load(std::memory_order_acquire)) {
+        rewindStreamDecoder(stream);
+        stream.ring.reset();
+        stream.ended.store(false, std::memory_order_relaxed);
+        stream.rewindPending.store(false, std::memory_order_release);
+    }
+
+    while (!stream.ended.load(std::memory_order_relaxed) && stream.ring.space() >= STREAM_DECODE_CHUNK) {
+        int frames = decodeStreamFrames(stream, chunk, STREAM_DECODE_CHUNK);
+        if (frames == 0) {
+            if (!stream.loop) {
+                stream.ended.store(true, std::memory_order_release);
+                break;
+            }
+            // Wrap inside this pass: the next frames in the ring are the
+            // track's first, with no silence in between
+            rewindStreamDecoder(stream);
+            frames = decodeStreamFrames(stream, chunk, STREAM_DECODE_CHUNK);
+            if (frames == 0)
+                break;
+        }
+        stream.ring.write(chunk, frames);
+    }
+}
+
+void *audioPrefetchThread(void *arg) {
+    AudioMixer *mixer = (AudioMixer *)arg;
+    short chunk[STREAM_DECODE_CHUNK * AUDIO_CHANNELS];
+    while (mixer->running) {
+        for (AudioStream *stream : mixer->streams) {
+            if (stream)
+                fillStream(*stream, chunk);
+        }
+        // The rings hold a second of audio, so short naps keep them full
+        usleep(10000);
+    }
+    return NULL;
+}
+
+// --- Backends ---
+
+// Null and WAV backends stand in for a device: they accept one period per
+// period of real time, so the mixer runs (and is measured) as it would live.
+double clockBackendDeadline = 0;
+
+void waitForClockBackend(int count) {
+    // Catch up after oversleeping, but don't burst after a real stall
+    double now = nowSeconds();
+    if (clockBackendDeadline < now - 0.05)
+        clockBackendDeadline = now;
+    clockBackendDeadline += (double)count / AUDIO_SAMPLE_RATE;
+    double wait = clockBackendDeadline - nowSeconds();
+    if (wait > 0)
+        usleep((useconds_t)(wait * 1e6));
+}
+
+bool nullBackendOpen(const char *target) {
+    clockBackendDeadline = 0;
+    return true;
+}
+
+bool nullBackendWrite(const short *frames, int count) {
+    waitForClockBackend(count);
+    return true;
+}
+
+void nullBackendClose() {
+}
+
+FILE *wavBackendFile = NULL;
+unsigned int wavBackendBytes = 0;
+
+void writeWavHeader(FILE *file, unsigned int dataBytes) {
+    unsigned int byteRate = AUDIO_SAMPLE_RATE * AUDIO_CHANNELS * sizeof(short);
+    unsigned short blockAlign = AUDIO_CHANNELS * sizeof(short);
+    unsigned int riffSize = 36 + dataBytes, fmtSize = 16, sampleRate = AUDIO_SAMPLE_RATE;
+    unsigned short pcm = 1, channels = AUDIO_CHANNELS, bits = 16;
+
+    fseek(file, 0, SEEK_SET);
+    fwrite("RIFF", 1, 4, file);
+    fwrite(&riffSize, 4, 1, file);
+    fwrite("WAVEfmt ", 1, 8, file);
+    fwrite(&fmtSize, 4, 1, file);
+    fwrite(&pcm, 2, 1, file);
+    fwrite(&channels, 2, 1, file);
+    fwrite(&sampleRate, 4, 1, file);
+    fwrite(&byteRate, 4, 1, file);
+    fwrite(&blockAlign, 2, 1, file);
+    fwrite(&bits, 2, 1, file);
+    fwrite("data", 1, 4, file);
+    fwrite(&dataBytes, 4, 1, file);
+}
+
+bool wavBackendOpen(const char *target) {
+    wavBackendFile = fopen(target ? target : "airport_rush_audio.wav", "wb");
+    if (!wavBackendFile)
+        return false;
+    wavBackendBytes = 0;
+    writeWavHeader(wavBackendFile, 0);
+    clockBackendDeadline = 0;
+    return true;
+}
+
+bool wavBackendWrite(const short *frames, int count) {
+    size_t bytes = count * AUDIO_CHANNELS * sizeof(short);
+    if (fwrite(frames, 1, bytes, wavBackendFile) != bytes)
+        return false;
+    wavBackendBytes += (unsigned int)bytes;
+    waitForClockBackend(count);
+    return true;
+}
+
+void wavBackendClose() {
+    if (!wavBackendFile)
+        return;
+    writeWavHeader(wavBackendFile, wavBackendBytes);
+    fclose(wavBackendFile);
+    wavBackendFile = NULL;
+}
+
+#ifdef AUDIO_HAVE_ALSA
+snd_pcm_t *alsaDevice = NULL;
+
+bool alsaBackendOpen(const char *target) {
+    if (snd_pcm_open(&alsaDevice, target ? target : "default", SND_PCM_STREAM_PLAYBACK, 0) < 0)
+        return false;
+    // 20 ms of device buffering: a few mixer periods, small enough for snappy effects
+    if (snd_pcm_set_params(alsaDevice, SND_PCM_FORMAT_S16_LE, SND_PCM_ACCESS_RW_INTERLEAVED,
+                           AUDIO_CHANNELS, AUDIO_SAMPLE_RATE, 1, 20000) < 0) {
+        snd_pcm_close(alsaDevice);
+        alsaDevice = NULL;
+        return false;
+    }
+    return true;
+}
+
+bool alsaBackendWrite(const short *frames, int count) {
+    while (count > 0) {
+        snd_pcm_sframes_t written = snd_pcm_writei(alsaDevice, frames, count);
+        if (written < 0) {
+            // Underrun or suspend: recover and retry the period
+            if (snd_pcm_recover(alsaDevice, (int)written, 1) < 0)
+                return false;
+            continue;
+        }
+        frames += written * AUDIO_CHANNELS;
+        count -= (int)written;
+    }
+    return true;
+}
+
+void alsaBackendClose() {
+    if (!alsaDevice)
+        return;
+    snd_pcm_drop(alsaDevice);
+    snd_pcm_close(alsaDevice);
+    alsaDevice = NULL;
+}
+#endif
+
+#ifdef __APPLE__
+// AudioQueue pulls on its own thread; a few period-sized buffers cycle
+// between it and the mixer thread, which waits here for a free one.
+const int COREAUDIO_BUFFERS = 3;
+AudioQueueRef coreAudioQueue = NULL;
+std::vector<AudioQueueBufferRef> coreAudioFreeBuffers;
+pthread_mutex_t coreAudioLock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t coreAudioBufferFreed = PTHREAD_COND_INITIALIZER;
+
+void coreAudioCallback(void *userData, AudioQueueRef queue, AudioQueueBufferRef buffer) {
+    pthread_mutex_lock(&coreAudioLock);
+    coreAudioFreeBuffers.push_back(buffer);
+    pthread_cond_signal(&coreAudioBufferFreed);
+    pthread_mutex_unlock(&coreAudioLock);
+}
+
+bool coreAudioBackendOpen(const char *target) {
+    AudioStreamBasicDescription format = pcmFormat();
+    if (AudioQueueNewOutput(&format, coreAudioCallback, NULL, NULL, NULL, 0, &coreAudioQueue) != noErr)
+        return false;
+    coreAudioFreeBuffers.clear();
+    for (int i = 0; i < COREAUDIO_BUFFERS; i++) {
+        AudioQueueBufferRef buffer;
+        if (AudioQueueAllocateBuffer(coreAudioQueue, AUDIO_PERIOD_FRAMES * format.mBytesPerFrame, &buffer) == noErr)
+            coreAudioFreeBuffers.push_back(buffer);
+    }
+    return !coreAudioFreeBuffers.empty() && AudioQueueStart(coreAudioQueue, NULL) == noErr;
+}
+
+bool coreAudioBackendWrite(const short *frames, int count) {
+    pthread_mutex_lock(&coreAudioLock);
+    while (coreAudioFreeBuffers.empty())
+        pthread_cond_wait(&coreAudioBufferFreed, &coreAudioLock);
+    AudioQueueBufferRef buffer = coreAudioFreeBuffers.back();
+    coreAudioFreeBuffers.pop_back();
+    pthread_mutex_unlock(&coreAudioLock);
+
+    UInt32 bytes = count * AUDIO_CHANNELS * sizeof(short);
+    memcpy(buffer->mAudioData, frames, bytes);
+    buffer->mAudioDataByteSize = bytes;
+    return AudioQueueEnqueueBuffer(coreAudioQueue, buffer, 0, NULL) == noErr;
+}
+
+void coreAudioBackendClose() {
+    if (!coreAudioQueue)
+        return;
+    AudioQueueStop(coreAudioQueue, true);
+    AudioQueueDispose(coreAudioQueue, true);
+    coreAudioQueue = NULL;
+}
+#endif
+
+const AudioBackend audioBackends[] = {
+#ifdef __APPLE__
+    {"coreaudio", coreAudioBackendOpen, coreAudioBackendWrite, coreAudioBackendClose},
+#endif
+#ifdef AUDIO_HAVE_ALSA
+    {"alsa", alsaBackendOpen, alsaBackendWrite, alsaBackendClose},
+#endif
+    {"wav", wavBackendOpen, wavBackendWrite, wavBackendClose},
+    {"null", nullBackendOpen, nullBackendWrite, nullBackendClose},
+};
+
+const AudioBackend *findAudioBackend(const char *name) {
+    for (const auto &backend : audioBackends) {
+        if (strcmp(backend.name, name) == 0)
+            return &backend;
+    }
+    return NULL;
+}
+
+// --- Mixer ---
+
+// The single audio worker. It applies queued commands at every period
+// boundary, and when nothing is playing it sleeps on the condition variable
+// until the next command arrives instead of mixing silence.
+void *audioMixerThread(void *arg) {
+    AudioMixer *mixer = (AudioMixer *)arg;
+
+    // Ask for real-time scheduling; without the privilege it just stays normal
+    struct sched_param param;
+    param.sched_priority = sched_get_priority_max(SCHED_FIFO) / 2;
+    if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0)
+        printf("DEBUG: Audio mixer thread runs without real-time priority\n");
+
+    short out[AUDIO_PERIOD_FRAMES * AUDIO_CHANNELS];
+    while (mixer->running) {
+        AudioCommand command;
+        while (mixer->queue.pop(command))
+            mixer->apply(command, nowSeconds());
+
+        if (!mixer->anyActive() && mixer->appliedStopCount == 0) {
+            pthread_mutex_lock(&mixer->wakeLock);
+            mixer->sleeping.store(true);
+            while (mixer->running && mixer->queue.empty())
+                pthread_cond_wait(&mixer->wake, &mixer->wakeLock);
+            mixer->sleeping.store(false);
+            pthread_mutex_unlock(&mixer->wakeLock);
+            continue;
+        }
+
+        double now = nowSeconds();
+        mixer->mix(out, AUDIO_PERIOD_FRAMES, now);
+        for (int i = 0; i < mixer->appliedStopCount; i++)
+            mixer->effectLatency.add((now - mixer->appliedStops[i]) * 1e6);
+        mixer->appliedStopCount = 0;
+
+        if (!mixer->backend.write(out, AUDIO_PERIOD_FRAMES)) {
+            printf("WARNING: Audio backend %s failed - mixer stopped\n", mixer->backend.name);
+            break;
+        }
+        mixer->periods++;
+    }
+    return NULL;
+}
+
+bool AudioMixer::start(const AudioBackend &output, const char *target) {
+    if (!output.open(target)) {
+        printf("WARNING: Audio backend %s could not be opened\n", output.name);
+        return false;
+    }
+    backend = output;
+    commandLatency.samples.reserve(AUDIO_LATENCY_SAMPLES);
+    effectLatency.samples.reserve(AUDIO_LATENCY_SAMPLES);
+    running = true;
+    if (pthread_create(&thread, NULL, audioMixerThread, this) != 0) {
+        running = false;
+        backend.close();
+        return false;
+    }
+    // Without the prefetch thread streamed tracks stay silent, clips still play
+    prefetchStarted = pthread_create(&prefetchThread, NULL, audioPrefetchThread, this) == 0;
+    if (!prefetchStarted)
+        printf("WARNING: Audio prefetch thread could not be started - streamed music disabled\n");
+    printf("DEBUG: Audio mixer running on %s, %d frames per period (%.1f ms)\n",
+           backend.name, AUDIO_PERIOD_FRAMES, AUDIO_PERIOD_FRAMES * 1000.0 / AUDIO_SAMPLE_RATE);
+    return true;
+}
+
+void AudioMixer::shutdown() {
+    if (!running)
+        return;
+    running = false;
+    pthread_mutex_lock(&wakeLock);
+    pthread_cond_signal(&wake);
+    pthread_mutex_unlock(&wakeLock);
+    pthread_join(thread, NULL);
+    if (prefetchStarted)
+        pthread_join(prefetchThread, NULL);
+    prefetchStarted = false;
+    backend.close();
+}
+
+// Game thread only (the queue has a single producer)
+void AudioMixer::send(const AudioCommand &command) {
+    if (!running || !queue.push(command))
+        return;
+    // push() and the worker's sleeping flag are both sequentially consistent,
+    // so either we see it asleep here or it sees the command before waiting
+    if (sleeping.load()) {
+        pthread_mutex_lock(&wakeLock);
+        pthread_cond_signal(&wake);
+        pthread_mutex_unlock(&wakeLock);
+    }
+}
+
+void AudioMixer::play(SoundId sound, bool loop) {
+    // Clips and streams are filled by the asset workers before start()
+    if (!running || (clips[sound].frames == 0 && !streams[sound]))
+        return;
+    send({AUDIO_CMD_PLAY, sound, loop, 1.0f, 0.0f, nowSeconds()});
+}
+
+void AudioMixer::stop(SoundId sound) {
+    send({AUDIO_CMD_STOP, sound, false, 0.0f, 0.0f, nowSeconds()});
+}
+
+void AudioMixer::setLoop(SoundId sound, bool loop) {
+    send({AUDIO_CMD_LOOP, sound, loop, 0.0f, 0.0f, nowSeconds()});
+}
+
+// Ramps the sound's gain to the target; fading to 0 stops it at the end
+void AudioMixer::fade(SoundId sound, float gain, float seconds) {
+    send({AUDIO_CMD_FADE, sound, false, gain, seconds, nowSeconds()});
+}
+
+void stopVoice(AudioMixer &mixer, AudioVoice &voice) {
+    voice.active = false;
+    if (mixer.streams[voice.sound])
+        mixer.streams[voice.sound]->rewindPending.store(true, std::memory_order_release);
+}
+
+// Runs on the worker
+void AudioMixer::apply(const AudioCommand &command, double now) {
+    commandLatency.add((now - command.requestTime) * 1e6);
+
+    if (command.type == AUDIO_CMD_PLAY) {
+        // Like the old start functions: a sound that is already playing keeps playing
+        for (const auto &voice : voices) {
+            if (voice.active && voice.sound == command.sound)
+                return;
+        }
+        for (auto &voice : voices) {
+            if (!voice.active) {
+                voice = {command.sound, 0, command.loop, true, 1.0f, 0.0f, 0, false, command.requestTime};
+                if (streams[command.sound])
+                    streams[command.sound]->loop = command.loop;
+                return;
+            }
+        }
+        return;
+    }
+
+    bool matched = false;
+    for (auto &voice : voices) {
+        if (!voice.active || voice.sound != command.sound)
+            continue;
+        matched = true;
+        switch (command.type) {
+        case AUDIO_CMD_STOP:
+            stopVoice(*this, voice);
+            break;
+        case AUDIO_CMD_LOOP:
+            voice.loop = command.loop;
+            if (streams[voice.sound])
+                streams[voice.sound]->loop = command.loop;
+            break;
+        case AUDIO_CMD_FADE:
+            voice.fadeFrames = std::max(1, (int)(command.seconds * AUDIO_SAMPLE_RATE));
+            voice.fadeStep = (command.gain - voice.gain) / voice.fadeFrames;
+            voice.stopAfterFade = command.gain <= 0.0f;
+            break;
+        default:
+            break;
+        }
+    }
+    if (matched && command.type == AUDIO_CMD_STOP && appliedStopCount < AUDIO_COMMAND_CAPACITY)
+        appliedStops[appliedStopCount++] = command.requestTime;
+}
+
+bool AudioMixer::anyActive() const {
+    for (const auto &voice : voices) {
+        if (voice.active)
+            return true;
+    }
+    return false;
+}
+
+int readClipFrames(const AudioClip &clip, AudioVoice &voice, short *buffer, int frames) {
+    for (int i = 0; i < frames; i++) {
+        if (voice.position >= clip.frames) {
+            if (!voice.loop) {
+                voice.active = false;
+                return i;
+            }
+            voice.position = 0;
+        }
+        buffer[i * 2] = clip.samples[voice.position * 2];
+        buffer[i * 2 + 1] = clip.samples[voice.position * 2 + 1];
+        voice.position++;
+    }
+    return frames;
+}
+
+// Reads one period from a stream's ring. Running dry before a non-looping
+// track has ended is an underrun; running dry after it ends finishes the voice.
+int readStreamFrames(AudioStream &stream, AudioVoice &voice, short *buffer, int frames) {
+    bool ended = stream.ended.load(std::memory_order_acquire);
+    int count = stream.ring.readInto(buffer, frames);
+    if (count < frames) {
+        if (ended && stream.ring.available() == 0) {
+            voice.active = false;
+            stream.rewindPending.store(true, std::memory_order_release);
+        } else {
+            stream.underrunFrames += frames - count;
+        }
+    }
+    return count;
+}
+
+// Scales frames by the voice's gain, advancing any fade; returns how many
+// frames are left once a fade-out has reached silence
+int applyVoiceGain(AudioVoice &voice, short *buffer, int count) {
+    if (voice.fadeFrames == 0 && voice.gain == 1.0f)
+        return count;
+    for (int i = 0; i < count; i++) {
+        if (voice.fadeFrames > 0) {
+            voice.gain += voice.fadeStep;
+            if (--voice.fadeFrames == 0 && voice.stopAfterFade)
+                return i;
+        }
+        buffer[i * 2] = (short)(buffer[i * 2] * voice.gain);
+        buffer[i * 2 + 1] = (short)(buffer[i * 2 + 1] * voice.gain);
+    }
+    return count;
+}
+
+// Runs on the worker
+void AudioMixer::mix(short *out, int frames, double now) {
+    int sum[AUDIO_PERIOD_FRAMES * AUDIO_CHANNELS] = {};
+    short buffer[AUDIO_PERIOD_FRAMES * AUDIO_CHANNELS];
+
+    for (auto &voice : voices) {
+        if (!voice.active)
+            continue;
+        AudioStream *stream = streams[voice.sound];
+        // A stream still rewinding from its last play stays silent a little longer
+        if (stream && stream->rewindPending.load(std::memory_order_acquire))
+            continue;
+
+        int count = stream ? readStreamFrames(*stream, voice, buffer, frames)
+                           : readClipFrames(clips[voice.sound], voice, buffer, frames);
+        int kept = applyVoiceGain(voice, buffer, count);
+        if (kept < count)
+            stopVoice(*this, voice);
+
+        for (int i = 0; i < kept * AUDIO_CHANNELS; i++) {
+            sum[i] += buffer[i];
+        }
+        if (voice.requestTime > 0 && kept > 0) {
+            effectLatency.add((now - voice.requestTime) * 1e6);
+            voice.requestTime = 0;
+        }
+    }
+
+    for (int i = 0; i < frames * AUDIO_CHANNELS; i++) {
+        out[i] = (short)std::max(-32768, std::min(32767, sum[i]));
+    }
+}
+
+// --- Game Audio ---
+
+void startBackgroundMusic() {
+    // Show Me Love - WizTheMc (background music, no loop)
+    audioMixer.play(SOUND_BACKGROUND, false);
+}
+
+void startWinMusic() {
+    // The Stranglers - Golden Brown (win music, loops until stopped)
+    audioMixer.play(SOUND_WIN, true);
+}
+
+void startLoseMusic() {
+    // Brazilian Phonk Remix - SoundSorcerer (lose music, loops until stopped)
+    audioMixer.play(SOUND_LOSE, true);
+}
+
+void startTakeoffSound() {
+    // IndiGo-TakeOff-AirBus-320 (takeoff sound, plays once)
+    audioMixer.play(SOUND_TAKEOFF, false);
+}
+
+void stopBackgroundMusic() {
+    audioMixer.stop(SOUND_BACKGROUND);
+}
+
+void stopWinMusic() {
+    audioMixer.stop(SOUND_WIN);
+}
+
+void stopLoseMusic() {
+    audioMixer.stop(SOUND_LOSE);
+}
+
+void stopTakeoffSound() {
+    audioMixer.stop(SOUND_TAKEOFF);
+}
+
+void cleanupAudio() {
+    stopBackgroundMusic();
+    stopWinMusic();
+    stopLoseMusic();
+    stopTakeoffSound();
+}
+
+// Decodes or opens one sound; a missing or undecodable one stays silent.
+// Only that sound's slot is written, so the asset workers run these in
+// parallel. The availability flags are read every frame, so the GL thread
+// sets them from the result, see setSoundAvailable().
+bool loadSoundAsset(SoundId sound) {
+    const char *names[SOUND_COUNT] = {"Background music", "Win music", "Lose music", "Takeoff sound"};
+    double start = nowSeconds();
+    bool available;
+    if (soundStreamed[sound]) {
+        audioMixer.streams[sound] = openAudioStream(soundPaths[sound], soundLoops[sound]);
+        available = audioMixer.streams[sound] != NULL;
+    } else {
+        available = decodeAudioFile(soundPaths[sound], audioMixer.clips[sound]);
+    }
+    if (available && soundStreamed[sound]) {
+        printf("DEBUG: %s available (streamed from a %.1f MB mapping through a %.0f KB ring)\n", names[sound],
+               audioMixer.streams[sound]->size / 1048576.0, STREAM_RING_FRAMES * AUDIO_CHANNELS * sizeof(short) / 1024.0);
+    } else if (available) {
+        printf("DEBUG: %s available (%.1f s decoded in %.0f ms)\n", names[sound],
+               (double)audioMixer.clips[sound].frames / AUDIO_SAMPLE_RATE, (nowSeconds() - start) * 1000);
+    } else {
+        printf("WARNING: %s not available - will run silently\n", names[sound]);
+    }
+    return available;
+}
+
+// GL thread only, as each sound's asset job finishes
+void setSoundAvailable(SoundId sound, bool available) {
+    bool *flags[SOUND_COUNT] = {&backgroundMusicAvailable, &winMusicAvailable, &loseMusicAvailable, &takeoffSoundAvailable};
+    *flags[sound] = available;
+}
+
+// Sums up the sounds loadSoundAsset() found, once every one has been tried
+bool checkAudioAssets() {
+    audioAssetsAvailable = backgroundMusicAvailable || winMusicAvailable || loseMusicAvailable || takeoffSoundAvailable;
+
+    if (!audioAssetsAvailable) {
+        printf("INFO: No audio assets found - game will run in silent mode\n");
+    } else {
+        printf("INFO: Some audio assets available - partial audio mode\n");
+    }
+
+    return audioAssetsAvailable;
+}
+
+// Opens AIRPORT_RUSH_AUDIO (coreaudio, alsa, wav or null; default: the first
+// device backend) with AIRPORT_RUSH_AUDIO_TARGET as device name or WAV path.
+bool startAudio() {
+    const char *name = getenv("AIRPORT_RUSH_AUDIO");
+    const char *target = getenv("AIRPORT_RUSH_AUDIO_TARGET");
+    const AudioBackend *backend = name ? findAudioBackend(name) : &audioBackends[0];
+    if (!backend) {
+        printf("WARNING: Unknown audio backend %s - using null\n", name);
+        backend = findAudioBackend("null");
+    }
+    if (audioMixer.start(*backend, target))
+        return true;
+    return audioMixer.start(*findAudioBackend("null"), NULL);
+}
+
+void shutdownAudio() {
+    if (!audioMixer.running)
+        return;
+    audioMixer.shutdown();
+    audioMixer.commandLatency.print("command");
+    audioMixer.effectLatency.print("effect");
+    if (audioMixer.queue.dropped > 0)
+        printf("AUDIO: %ld commands dropped on a full queue\n", audioMixer.queue.dropped.load());
+}
+
+// Start/stop latency of the mixer against the backend of choice, plus the
+// cost of one fork+exec through system() that the old afplay/pkill calls paid.
+int runAudioBenchmark(const char *backendName, const char *target) {
+    const AudioBackend *backend = findAudioBackend(backendName);
+    if (!backend) {
+        printf("AUDIO: unknown backend %s\n", backendName);
+        return 1;
+    }
+    if (!decodeAudioFile(soundPaths[SOUND_TAKEOFF], audioMixer.clips[SOUND_BENCH_EFFECT])) {
+        printf("AUDIO: using a synthesized tone instead of %s\n", soundPaths[SOUND_TAKEOFF]);
+        synthesizeTone(audioMixer.clips[SOUND_BENCH_EFFECT], 440.0f, 1.0f);
+    }
+    AudioStream *stream = openAudioStream(soundPaths[SOUND_WIN], true);
+    if (!stream) {
+        printf("AUDIO: streaming a synthesized 3 s tone instead of %s\n", soundPaths[SOUND_WIN]);
+        stream = openToneStream(true);
+    }
+    audioMixer.streams[SOUND_BENCH_STREAM] = stream;
+    if (!audioMixer.start(*backend, target))
+        return 1;
+
+    // Play/stop pairs with the worker asleep (nothing else playing)...
+    const int requests = 100;
+    for (int i = 0; i < requests; i++) {
+        audioMixer.play(SOUND_BENCH_EFFECT, false);
+        usleep(7000 + (i % 5) * 1000);
+        audioMixer.stop(SOUND_BENCH_EFFECT);
+        usleep(7000 + (i % 3) * 1000);
+    }
+
+    // ...and with it busy mixing the streamed track. The stream plays long
+    // enough to wrap around the tone's end, then fades out, restarts from the
+    // beginning, switches looping off and is stopped.
+    double streamStart = nowSeconds();
+    audioMixer.play(SOUND_BENCH_STREAM, true);
+    for (int i = 0; i < requests; i++) {
+        audioMixer.play(SOUND_BENCH_EFFECT, false);
+        usleep(7000 + (i % 5) * 1000);
+        audioMixer.stop(SOUND_BENCH_EFFECT);
+        usleep(7000 + (i % 3) * 1000);
+    }
+    usleep((useconds_t)(std::max(0.0, 4.0 - (nowSeconds() - streamStart)) * 1e6));
+    audioMixer.fade(SOUND_BENCH_STREAM, 0.0f, 0.2f);
+    usleep(300000);
+    audioMixer.play(SOUND_BENCH_STREAM, true);
+    usleep(300000);
+    audioMixer.setLoop(SOUND_BENCH_STREAM, false);
+    usleep(200000);
+    audioMixer.stop(SOUND_BENCH_STREAM);
+    usleep(50000);
+
+    long periods = audioMixer.periods;
+    float effectP99 = audioMixer.effectLatency.p99();
+    shutdownAudio();
+    printf("AUDIO: p99 command-to-effect latency %.0f us %s the 5 ms target\n", effectP99,
+           effectP99 < 5000 ? "meets" : "misses");
+    printf("AUDIO: %s backend mixed %ld periods of %d frames\n", backend->name, periods, AUDIO_PERIOD_FRAMES);
+    printf("AUDIO: streamed %s through a %.0f KB ring, %ld underrun frames\n", stream->path,
+           stream->ring.samples.size() * sizeof(short) / 1024.0, stream->underrunFrames.load());
+
+    const int forks = 20;
+    double start = nowSeconds();
+    for (int i = 0; i < forks; i++)
+        system(":");
+    printf("AUDIO: system() fork+exec for comparison: %.0f us per call\n", (nowSeconds() - start) * 1e6 / forks);
+    return 0;
+}
+
+// --- MAP TILES ---
+
+int tileKey(int level, int tile)
+{
+  return level << 24 | tile;
+}
+
+// Asset worker: records level 0 and the size of each further level, halved
+// (odd sizes rounded up) down to a single tile. No pixels are read here.
+void TiledMap::buildLevels(const BMPImage &source)
+{
+  image = source;
+  topDown = source.topDown;
+  levels[0] = {source.width, source.height, 0, 0};
+  levelCount = 1;
+  while (levelCount < MAP_MAX_LEVELS)
+  {
+    const MapLevel &from = levels[levelCount - 1];
+    if (from.width <= MAP_TILE_SIZE && from.height <= MAP_TILE_SIZE)
+      break;
+    levels[levelCount] = {(from.width + 1) / 2, (from.height + 1) / 2, 0, 0};
+    levelCount++;
+  }
+  for (int i = 0; i < levelCount; i++)
+  {
+    levels[i].tilesX = (levels[i].width + MAP_TILE_SIZE - 1) / MAP_TILE_SIZE;
+    levels[i].tilesY = (levels[i].height + MAP_TILE_SIZE - 1) / MAP_TILE_SIZE;
+  }
+}
+
+bool TiledMap::ready() const
+{
+  return attached;
+}
+
+// GL thread, once buildLevels() has finished; tile textures are created as
+// slots are first used
+void TiledMap::attach()
+{
+  for (int i = 0; i < MAP_TILE_CACHE_SLOTS; i++)
+    slots[i].key = -1;
+  residentSlots.clear();
+  attached = true;
+  printf("DEBUG: Map %dx%d split into %dx%d tiles of %d px, %d levels, %d cached (%.1f MB)\n",
+         image.width, image.height, levels[0].tilesX, levels[0].tilesY, MAP_TILE_SIZE, levelCount,
+         MAP_TILE_CACHE_SLOTS, MAP_TILE_CACHE_SLOTS * MAP_TILE_SIZE * MAP_TILE_SIZE * 3 / 1048576.0);
+}
+
+// The coarsest level that still has at least one texel per screen pixel; the
+// tile's own GL mipmaps filter the remaining factor of up to two
+int TiledMap::selectLevel(float zoom) const
+{
+  float pixelsPerTexel = zoom * std::min((float)WINDOW_WIDTH / MAP_REFERENCE_WIDTH,
+                                         (float)(GAME_AREA_TOP - GAME_AREA_BOTTOM) / MAP_REFERENCE_HEIGHT);
+  int level = (int)floorf(log2f(1.0f / pixelsPerTexel));
+  return std::max(0, std::min(levelCount - 1, level));
+}
+
+// Row of level 0, counted from the bottom of the picture
+const unsigned char *TiledMap::baseRow(int row) const
+{
+  return image.pixels + (size_t)(topDown ? image.height - 1 - row : row) * image.rowStride;
+}
+
+// Repeats the last valid column and row of a packed MAP_TILE_SIZE tile over
+// the rest, so linear filtering and the tile's mipmaps never see undefined
+// texels past the map's edge
+void replicateTileEdges(unsigned char *pixels, int w, int h)
+{
+  const int stride = MAP_TILE_SIZE * 3;
+  for (int y = 0; y < h; y++)
+  {
+    unsigned char *row = pixels + (size_t)y * stride;
+    for (int x = w; x < MAP_TILE_SIZE; x++)
+      memcpy(row + x * 3, row + (w - 1) * 3, 3);
+  }
+  for (int y = h; y < MAP_TILE_SIZE; y++)
+    memcpy(pixels + (size_t)y * stride, pixels + (size_t)(h - 1) * stride, stride);
+}
+
+// Pixels of a tile of level 1 or up, built from the four tiles under it on a
+// cache miss. NULL once this frame's build budget is spent; the finer tiles
+// built so far stay cached, so the next frame carries on from there.
+const unsigned char *TiledMap::coarseTile(int level, int tile)
+{
+  int key = tileKey(level, tile);
+  std::unordered_map<int, MapCoarseTile>::iterator it = coarseTiles.find(key);
+  if (it != coarseTiles.end())
+  {
+    it->second.lastUsed = frame;
+    return it->second.pixels.data();
+  }
+  if (buildsThisFrame >= MAP_TILE_BUILDS_PER_FRAME)
+    return NULL;
+  buildsThisFrame++;
+
+  const MapLevel &to = levels[level];
+  const MapLevel &from = levels[level - 1];
+  const int stride = MAP_TILE_SIZE * 3, half = MAP_TILE_SIZE / 2;
+  int tx = tile % to.tilesX, ty = tile / to.tilesX;
+  std::vector<unsigned char> pixels((size_t)stride * MAP_TILE_SIZE);
+  for (int quadrant = 0; quadrant < 4; quadrant++)
+  {
+    int cx = 2 * tx + (quadrant & 1), cy = 2 * ty + (quadrant >> 1);
+    if (cx >= from.tilesX || cy >= from.tilesY)
+      continue;
+    int cw = std::min(MAP_TILE_SIZE, from.width - cx * MAP_TILE_SIZE);
+    int ch = std::min(MAP_TILE_SIZE, from.height - cy * MAP_TILE_SIZE);
+    const unsigned char *child = NULL;
+    if (level > 1 && !(child = coarseTile(level - 1, cy * from.tilesX + cx)))
+      return NULL;
+
+    // An odd edge repeats its last texel
+    for (int y = 0; y < (ch + 1) / 2; y++)
+    {
+      int y0 = 2 * y, y1 = std::min(2 * y + 1, ch - 1);
+      const unsigned char *row0 = child ? child + (size_t)y0 * stride : baseRow(cy * MAP_TILE_SIZE + y0) + cx * stride;
+      const unsigned char *row1 = child ? child + (size_t)y1 * stride : baseRow(cy * MAP_TILE_SIZE + y1) + cx * stride;
+      unsigned char *out = &pixels[(size_t)((quadrant >> 1) * half + y) * stride + (quadrant & 1) * half * 3];
+      for (int x = 0; x < (cw + 1) / 2; x++)
+      {
+        int x0 = 2 * x * 3, x1 = std::min(2 * x + 1, cw - 1) * 3;
+        for (int c = 0; c < 3; c++)
+          out[x * 3 + c] = (unsigned char)((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) / 4);
+      }
+    }
+  }
+  replicateTileEdges(pixels.data(), std::min(MAP_TILE_SIZE, to.width - tx * MAP_TILE_SIZE),
+                     std::min(MAP_TILE_SIZE, to.height - ty * MAP_TILE_SIZE));
+
+  if ((int)coarseTiles.size() >= MAP_COARSE_TILE_LIMIT)
+  {
+    std::unordered_map<int, MapCoarseTile>::iterator oldest = coarseTiles.begin();
+    for (it = coarseTiles.begin(); it != coarseTiles.end(); ++it)
+    {
+      if (it->second.lastUsed < oldest->second.lastUsed)
+        oldest = it;
+    }
+    coarseTiles.erase(oldest);
+  }
+  MapCoarseTile &built = coarseTiles[key];
+  built.pixels.swap(pixels);
+  built.lastUsed = frame;
+  return built.pixels.data();
+}
+
+// Slot holding the tile's texture, uploading it over the least recently used
+// tile on a miss. -1 when the upload or build budget is spent or every slot
+// is in use this frame.
+int TiledMap::residentSlot(int level, int tile)
+{
+  int key = tileKey(level, tile);
+  std::unordered_map<int, int>::iterator it = residentSlots.find(key);
+  if (it != residentSlots.end())
+  {
+    slots[it->second].lastUsed = frame;
+    return it->second;
+  }
+  if (uploadsThisFrame >= MAP_TILE_UPLOADS_PER_FRAME)
+    return -1;
+
+  int victim = -1;
+  for (int i = 0; i < MAP_TILE_CACHE_SLOTS; i++)
+  {
+    if (slots[i].key < 0)
+    {
+      victim = i;
+      break;
+    }
+    if (slots[i].lastUsed < frame && (victim < 0 || slots[i].lastUsed < slots[victim].lastUsed))
+      victim = i;
+  }
+  if (victim < 0)
+    return -1;
+
+  // Tile rows count up from the bottom of the picture. A whole level 0 tile
+  // uploads straight from the mapping in file order, so texture row 0 is its
+  // first row in the file; edge tiles and coarse tiles are packed bottom-up.
+  const MapLevel &source = levels[level];
+  int x = (tile % source.tilesX) * MAP_TILE_SIZE;
+  int row = (tile / source.tilesX) * MAP_TILE_SIZE;
+  int w = std::min(MAP_TILE_SIZE, source.width - x);
+  int h = std::min(MAP_TILE_SIZE, source.height - row);
+  const unsigned char *packed = NULL;
+  if (level > 0)
+  {
+    packed = coarseTile(level, tile);
+    if (!packed)
+      return -1;
+  }
+  else if (w < MAP_TILE_SIZE || h < MAP_TILE_SIZE)
+  {
+    staging.resize((size_t)MAP_TILE_SIZE * MAP_TILE_SIZE * 3);
+    for (int y = 0; y < h; y++)
+      memcpy(&staging[(size_t)y * MAP_TILE_SIZE * 3], baseRow(row + y) + x * 3, w * 3);
+    replicateTileEdges(staging.data(), w, h);
+    packed = staging.data();
+  }
+
+  MapTileSlot &slot = slots[victim];
+  if (slot.key >= 0)
+    residentSlots.erase(slot.key);
+  if (slot.texture == 0)
+  {
+    glGenTextures(1, &slot.texture);
+    glBindTexture(GL_TEXTURE_2D, slot.texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_GENERATE_MIPMAP, GL_TRUE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, MAP_TILE_SIZE, MAP_TILE_SIZE, 0, GL_BGR, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  }
+
+  // Every upload fills the whole texture, so GL_GENERATE_MIPMAP rebuilds the
+  // tile's mip chain from defined texels only. From the mapping, ROW_LENGTH
+  // at 4-byte alignment reproduces the padded BMP row stride.
+  glBindTexture(GL_TEXTURE_2D, slot.texture);
+  glPushClientAttrib(GL_CLIENT_PIXEL_STORE_BIT);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  if (packed)
+  {
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, MAP_TILE_SIZE, MAP_TILE_SIZE, GL_BGR, GL_UNSIGNED_BYTE, packed);
+  }
+  else
+  {
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, image.width);
+    glPixelStorei(GL_UNPACK_SKIP_PIXELS, x);
+    glPixelStorei(GL_UNPACK_SKIP_ROWS, topDown ? image.height - row - h : row);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w, h, GL_BGR, GL_UNSIGNED_BYTE, image.pixels);
+  }
+  glPopClientAttrib();
+
+  slot.key = key;
+  slot.flipped = !packed && topDown;
+  slot.lastUsed = frame;
+  residentSlots[key] = victim;
+  uploadsThisFrame++;
+  return victim;
+}
+
+// Draws the tiles that intersect the view rectangle (world coordinates) from
+// the level that suits the zoom
+void TiledMap::draw(float viewLeft, float viewBottom, float viewRight, float viewTop, float zoom)
+{
+  frame++;
+  uploadsThisFrame = 0;
+  buildsThisFrame = 0;
+  int level = selectLevel(zoom);
+  if (level != drawnLevel)
+  {
+    printf("DEBUG: Zoom %.2f draws map level %d (%dx%d)\n", zoom, level, levels[level].width, levels[level].height);
+    drawnLevel = level;
+  }
+
+  // World units per texel of this level; a level's odd edge pixel covers a
+  // little less than 2^level base texels, so derive it from the level size
+  const MapLevel &source = levels[level];
+  float scaleX = (float)WINDOW_WIDTH / MAP_REFERENCE_WIDTH * image.width / source.width;
+  float scaleY = (float)(GAME_AREA_TOP - GAME_AREA_BOTTOM) / MAP_REFERENCE_HEIGHT * image.height / source.height;
+  float tileW = MAP_TILE_SIZE * scaleX, tileH = MAP_TILE_SIZE * scaleY;
+  int firstX = std::max(0, (int)floorf(viewLeft / tileW));
+  int lastX = std::min(source.tilesX - 1, (int)floorf(viewRight / tileW));
+  int firstY = std::max(0, (int)floorf((viewBottom - GAME_AREA_BOTTOM) / tileH));
+  int lastY = std::min(source.tilesY - 1, (int)floorf((viewTop - GAME_AREA_BOTTOM) / tileH));
+
+  std::vector<int> missing;
+  glColor3f(1.0f, 1.0f, 1.0f);
+  glEnable(GL_TEXTURE_2D);
+  for (int ty = firstY; ty <= lastY; ty++)
+  {
+    for (int tx = firstX; tx <= lastX; tx++)
+    {
+      int tile = ty * source.tilesX + tx;
+      int slot = residentSlot(level, tile);
+      if (slot < 0)
+      {
+        missing.push_back(tile);
+        continue;
+      }
+      // Edge tiles fill only part of their texture
+      int w = std::min(MAP_TILE_SIZE, source.width - tx * MAP_TILE_SIZE);
+      int h = std::min(MAP_TILE_SIZE, source.height - ty * MAP_TILE_SIZE);
+      float u = w / (float)MAP_TILE_SIZE, v = h / (float)MAP_TILE_SIZE;
+      float vBottom = slots[slot].flipped ? v : 0.0f;
+      float vTop = slots[slot].flipped ? 0.0f : v;
+      float x0 = tx * tileW, x1 = x0 + w * scaleX;
+      float y0 = GAME_AREA_BOTTOM + ty * tileH, y1 = y0 + h * scaleY;
+      glBindTexture(GL_TEXTURE_2D, slots[slot].texture);
+      glBegin(GL_QUADS);
+      glTexCoord2f(0.0f, vBottom); glVertex2f(x0, y0);
+      glTexCoord2f(u, vBottom); glVertex2f(x1, y0);
+      glTexCoord2f(u, vTop); glVertex2f(x1, y1);
+      glTexCoord2f(0.0f, vTop); glVertex2f(x0, y1);
+      glEnd();
+    }
+  }
+  glDisable(GL_TEXTURE_2D);
+
+  // Tiles still waiting for an upload show the fallback colour
+  glColor3f(0.55f, 0.55f, 0.58f);
   glBegin(GL_QUADS);
-  glVertex2f(-10, 6 - 3 * stripeHeight);
-  glVertex2f(2, 6 - 3 * stripeHeight);
-  glVertex2f(2, 6 - 2 * stripeHeight);
-  glVertex2f(-10, 6 - 2 * stripeHeight);
+  for (int tile : missing)
+  {
+    int tx = tile % source.tilesX, ty = tile / source.tilesX;
+    float x0 = tx * tileW, x1 = x0 + std::min(MAP_TILE_SIZE, source.width - tx * MAP_TILE_SIZE) * scaleX;
+    float y0 = GAME_AREA_BOTTOM + ty * tileH, y1 = y0 + std::min(MAP_TILE_SIZE, source.height - ty * MAP_TILE_SIZE) * scaleY;
+    glVertex2f(x0, y0);
+    glVertex2f(x1, y0);
+    glVertex2f(x1, y1);
+    glVertex2f(x0, y1);
+  }
   glEnd();
+  glColor3f(1.0f, 1.0f, 1.0f);
+}
+
+// --- CAMERA ZOOM ---
+
+void zoomBy(float factor)
+{
+  float zoom = std::max(MIN_ZOOM, std::min(MAX_ZOOM, viewZoom * factor));
+  if (zoom == viewZoom)
+    return;
+  viewZoom = zoom;
+}
+
+// Scales the current matrix about the window centre
+void applyViewZoom()
+{
+  glTranslatef(WINDOW_WIDTH / 2.0f, WINDOW_HEIGHT / 2.0f, 0);
+  glScalef(viewZoom, viewZoom, 1);
+  glTranslatef(-WINDOW_WIDTH / 2.0f, -WINDOW_HEIGHT / 2.0f, 0);
+}
+
+// Inverse of applyViewZoom() followed by the camera translation
+void screenToWorld(float screenX, float screenY, float cameraX, float cameraY, float &worldX, float &worldY)
+{
+  worldX = (screenX - WINDOW_WIDTH / 2.0f) / viewZoom + WINDOW_WIDTH / 2.0f - cameraX;
+  worldY = (screenY - WINDOW_HEIGHT / 2.0f) / viewZoom + WINDOW_HEIGHT / 2.0f - cameraY;
+}
+
+ViewRect worldView(float cameraX, float cameraY)
+{
+  ViewRect view;
+  screenToWorld(0, 0, cameraX, cameraY, view.left, view.bottom);
+  screenToWorld(WINDOW_WIDTH, WINDOW_HEIGHT, cameraX, cameraY, view.right, view.top);
+  return view;
+}
+
+bool pointInView(const ViewRect &view, float x, float y, float margin)
+{
+  return x >= view.left - margin && x <= view.right + margin && y >= view.bottom - margin && y <= view.top + margin;
+}
+
+void drawMapBackground(const ViewRect &view) {
+  if (!mapTiles.ready()) {
+    if (assetLoader.remaining == 0)
+      printf("DEBUG: Map not loaded, using fallback background\n");
+    glColor3f(0.55f, 0.55f, 0.58f);
+    glDisable(GL_TEXTURE_2D);
+    glBegin(GL_QUADS);
+    glVertex2f(0, GAME_AREA_BOTTOM);
+    glVertex2f(WINDOW_WIDTH, GAME_AREA_BOTTOM);
+    glVertex2f(WINDOW_WIDTH, GAME_AREA_TOP);
+    glVertex2f(0, GAME_AREA_TOP);
+    glEnd();
+    return;
+  }
+
+  mapTiles.draw(view.left, view.bottom, view.right, view.top, viewZoom);
+}
+
+bool checkCollision(float x1, float y1, float w1, float h1,
+                    float x2, float y2, float w2, float h2)
+{
+  return (x1 < x2 + w2 && x1 + w1 > x2 && y1 < y2 + h2 && y1 + h1 > y2);
+}
+
+// --- AABB BATCH KERNEL ---
+
+int aabbBatchScalar(const float *minX, const float *minY, const float *maxX, const float *maxY,
+                    int count, float x0, float y0, float x1, float y1, int *hits)
+{
+  int n = 0;
+  for (int i = 0; i < count; i++)
+  {
+    if (x0 < maxX[i] && x1 > minX[i] && y0 < maxY[i] && y1 > minY[i])
+    {
+      hits[n++] = i;
+    }
+  }
+  return n;
+}
+
+#if AABB_KERNEL_X86
+int aabbBatchSSE2(const float *minX, const float *minY, const float *maxX, const float *maxY,
+                  int count, float x0, float y0, float x1, float y1, int *hits)
+{
+  __m128 bx0 = _mm_set1_ps(x0), by0 = _mm_set1_ps(y0);
+  __m128 bx1 = _mm_set1_ps(x1), by1 = _mm_set1_ps(y1);
+  int n = 0;
+  int i = 0;
+  for (; i + 4 <= count; i += 4)
+  {
+    __m128 overlap = _mm_and_ps(_mm_and_ps(_mm_cmplt_ps(bx0, _mm_loadu_ps(maxX + i)),
+                                           _mm_cmpgt_ps(bx1, _mm_loadu_ps(minX + i))),
+                                _mm_and_ps(_mm_cmplt_ps(by0, _mm_loadu_ps(maxY + i)),
+                                           _mm_cmpgt_ps(by1, _mm_loadu_ps(minY + i))));
+    int mask = _mm_movemask_ps(overlap);
+    while (mask)
+    {
+      hits[n++] = i + __builtin_ctz(mask);
+      mask &= mask - 1;
+    }
+  }
+  int tail = aabbBatchScalar(minX + i, minY + i, maxX + i, maxY + i, count - i, x0, y0, x1, y1, hits + n);
+  for (int k = 0; k < tail; k++)
+  {
+    hits[n + k] += i; // tail indices come back relative to i
+  }
+  return n + tail;
+}
+
+__attribute__((target("avx2")))
+int aabbBatchAVX2(const float *minX, const float *minY, const float *maxX, const float *maxY,
+                  int count, float x0, float y0, float x1, float y1, int *hits)
+{
+  __m256 bx0 = _mm256_set1_ps(x0), by0 = _mm256_set1_ps(y0);
+  __m256 bx1 = _mm256_set1_ps(x1), by1 = _mm256_set1_ps(y1);
+  int n = 0;
+  int i = 0;
+  for (; i + 8 <= count; i += 8)
+  {
+    __m256 overlap = _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(bx0, _mm256_loadu_ps(maxX + i), _CMP_LT_OQ),
+                                                 _mm256_cmp_ps(bx1, _mm256_loadu_ps(minX + i), _CMP_GT_OQ)),
+                                   _mm256_and_ps(_mm256_cmp_ps(by0, _mm256_loadu_ps(maxY + i), _CMP_LT_OQ),
+                                                 _mm256_cmp_ps(by1, _mm256_loadu_ps(minY + i), _CMP_GT_OQ)));
+    int mask = _mm256_movemask_ps(overlap);
+    while (mask)
+    {
+      hits[n++] = i + __builtin_ctz(mask);
+      mask &= mask - 1;
+    }
+  }
+  // Clear the upper YMM halves before falling back to SSE code, otherwise every
+  // later SSE instruction in the game pays the AVX transition penalty
+  _mm256_zeroupper();
+  int tail = aabbBatchSSE2(minX + i, minY + i, maxX + i, maxY + i, count - i, x0, y0, x1, y1, hits + n);
+  for (int k = 0; k < tail; k++)
+  {
+    hits[n + k] += i;
+  }
+  return n + tail;
+}
+#endif
+
+#if AABB_KERNEL_NEON
+int aabbBatchNEON(const float *minX, const float *minY, const float *maxX, const float *maxY,
+                  int count, float x0, float y0, float x1, float y1, int *hits)
+{
+  static const uint32_t laneBits[4] = {1, 2, 4, 8};
+  uint32x4_t bits = vld1q_u32(laneBits);
+  float32x4_t bx0 = vdupq_n_f32(x0), by0 = vdupq_n_f32(y0);
+  float32x4_t bx1 = vdupq_n_f32(x1), by1 = vdupq_n_f32(y1);
+  int n = 0;
+  int i = 0;
+  for (; i + 4 <= count; i += 4)
+  {
+    uint32x4_t overlap = vandq_u32(vandq_u32(vcltq_f32(bx0, vld1q_f32(maxX + i)),
+                                             vcgtq_f32(bx1, vld1q_f32(minX + i))),
+                                   vandq_u32(vcltq_f32(by0, vld1q_f32(maxY + i)),
+                                             vcgtq_f32(by1, vld1q_f32(minY + i))));
+    unsigned int mask = vaddvq_u32(vandq_u32(overlap, bits));
+    while (mask)
+    {
+      hits[n++] = i + __builtin_ctz(mask);
+      mask &= mask - 1;
+    }
+  }
+  int tail = aabbBatchScalar(minX + i, minY + i, maxX + i, maxY + i, count - i, x0, y0, x1, y1, hits + n);
+  for (int k = 0; k < tail; k++)
+  {
+    hits[n + k] += i;
+  }
+  return n + tail;
+}
+#endif
+
+AabbBatchFn selectAabbKernel(const char **name)
+{
+  if (getenv("AIRPORT_RUSH_SCALAR_AABB"))
+  {
+    *name = "scalar";
+    return aabbBatchScalar;
+  }
+#if AABB_KERNEL_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+  {
+    *name = "avx2";
+    return aabbBatchAVX2;
+  }
+  *name = "sse2";
+  return aabbBatchSSE2;
+#elif AABB_KERNEL_NEON
+  *name = "neon";
+  return aabbBatchNEON;
+#else
+  *name = "scalar";
+  return aabbBatchScalar;
+#endif
+}
+
+// --- FLIGHT PATHS ---
+
+void FlightPath::addBezier(const float *p0, const float *p1, const float *p2, const float *p3)
+{
+  PathSegment seg;
+  seg.ax = -p0[0] + 3 * p1[0] - 3 * p2[0] + p3[0];
+  seg.bx = 3 * p0[0] - 6 * p1[0] + 3 * p2[0];
+  seg.cx = -3 * p0[0] + 3 * p1[0];
+  seg.dx = p0[0];
+  seg.ay = -p0[1] + 3 * p1[1] - 3 * p2[1] + p3[1];
+  seg.by = 3 * p0[1] - 6 * p1[1] + 3 * p2[1];
+  seg.cy = -3 * p0[1] + 3 * p1[1];
+  seg.dy = p0[1];
+  segments.push_back(seg);
+}
+
+// points are x, y pairs. Bezier: 3n+1 points for n segments (closed reuses
+// the first point as the last). Catmull-Rom: the curve passes through every
+// point; open ends repeat the end points as their outer neighbours.
+void FlightPath::build(SplineKind kind, const float *points, int pointCount, bool closed)
+{
+  segments.clear();
+  if (kind == SPLINE_BEZIER)
+  {
+    for (int i = 0; i + 3 < pointCount; i += 3)
+    {
+      const float *end = (closed && i + 3 == pointCount - 1) ? points : points + 2 * (i + 3);
+      addBezier(points + 2 * i, points + 2 * (i + 1), points + 2 * (i + 2), end);
+    }
+  }
+  else
+  {
+    int count = closed ? pointCount : pointCount - 1;
+    for (int i = 0; i < count && pointCount >= 2; i++)
+    {
+      auto point = [&](int k) {
+        k = closed ? (k + pointCount) % pointCount : std::max(0, std::min(pointCount - 1, k));
+        return points + 2 * k;
+      };
+      const float *p0 = point(i - 1), *p1 = point(i), *p2 = point(i + 1), *p3 = point(i + 2);
+      float c1[2] = {p1[0] + (p2[0] - p0[0]) / 6, p1[1] + (p2[1] - p0[1]) / 6};
+      float c2[2] = {p2[0] - (p3[0] - p1[0]) / 6, p2[1] - (p3[1] - p1[1]) / 6};
+      addBezier(p1, c1, c2, p2);
+    }
+  }
+  buildTables();
+}
+
+void FlightPath::evaluate(float param, float &x, float &y) const
+{
+  int i = std::max(0, std::min((int)segments.size() - 1, (int)param));
+  float u = param - i;
+  const PathSegment &seg = segments[i];
+  x = ((seg.ax * u + seg.bx) * u + seg.cx) * u + seg.dx;
+  y = ((seg.ay * u + seg.by) * u + seg.cy) * u + seg.dy;
+}
+
+// Arc length is accumulated from chords between forward-differenced points
+// (three adds per axis per step instead of a full evaluation), then the path
+// is resampled at equal distances for the constant-speed table
+void FlightPath::buildTables()
+{
+  arcLength.assign(1, 0.0f);
+  length = 0;
+  const float h = 1.0f / PATH_ARC_STEPS;
+  for (const PathSegment &seg : segments)
+  {
+    float x = seg.dx, y = seg.dy;
+    float dx1 = ((seg.ax * h + seg.bx) * h + seg.cx) * h, dy1 = ((seg.ay * h + seg.by) * h + seg.cy) * h;
+    float dx2 = (6 * seg.ax * h + 2 * seg.bx) * h * h, dy2 = (6 * seg.ay * h + 2 * seg.by) * h * h;
+    float dx3 = 6 * seg.ax * h * h * h, dy3 = 6 * seg.ay * h * h * h;
+    for (int k = 0; k < PATH_ARC_STEPS; k++)
+    {
+      float nx = x + dx1, ny = y + dy1;
+      dx1 += dx2;
+      dy1 += dy2;
+      dx2 += dx3;
+      dy2 += dy3;
+      if (k == PATH_ARC_STEPS - 1)
+      {
+        // land exactly on the segment end so errors don't carry over
+        nx = seg.ax + seg.bx + seg.cx + seg.dx;
+        ny = seg.ay + seg.by + seg.cy + seg.dy;
+      }
+      length += sqrtf((nx - x) * (nx - x) + (ny - y) * (ny - y));
+      arcLength.push_back(length);
+      x = nx;
+      y = ny;
+    }
+  }
+
+  sampleCount = std::max(1, (int)ceilf(length / PATH_SAMPLE_SPACING));
+  sampleSpacing = length / sampleCount;
+  invSpacing = length > 0 ? 1.0f / sampleSpacing : 0.0f;
+  sampleX.resize(sampleCount + 2);
+  sampleY.resize(sampleCount + 2);
+  if (segments.empty())
+  {
+    std::fill(sampleX.begin(), sampleX.end(), 0.0f);
+    std::fill(sampleY.begin(), sampleY.end(), 0.0f);
+    return;
+  }
+
+  // Distances only increase, so the arc-length table is walked once
+  int k = 0;
+  int last = (int)arcLength.size() - 1;
+  for (int i = 0; i <= sampleCount; i++)
+  {
+    float target = std::min(i * sampleSpacing, length);
+    while (k < last - 1 && arcLength[k + 1] < target)
+      k++;
+    float span = arcLength[k + 1] - arcLength[k];
+    float t = span > 0 ? (target - arcLength[k]) / span : 0.0f;
+    evaluate((k + std::min(1.0f, t)) * h, sampleX[i], sampleY[i]);
+  }
+  sampleX[sampleCount + 1] = sampleX[sampleCount];
+  sampleY[sampleCount + 1] = sampleY[sampleCount];
+}
+
+float FlightPath::paramAtDistance(float distance) const
+{
+  if (arcLength.size() < 2)
+    return 0;
+  distance = std::max(0.0f, std::min(length, distance));
+  int k = (int)(std::upper_bound(arcLength.begin(), arcLength.end(), distance) - arcLength.begin()) - 1;
+  k = std::max(0, std::min((int)arcLength.size() - 2, k));
+  float span = arcLength[k + 1] - arcLength[k];
+  float t = span > 0 ? (distance - arcLength[k]) / span : 0.0f;
+  return (k + t) / PATH_ARC_STEPS;
+}
+
+void FlightPath::positionAt(float distance, float &x, float &y) const
+{
+  float f = std::max(0.0f, std::min((float)sampleCount, distance * invSpacing));
+  int i = (int)f;
+  float t = f - i;
+  x = sampleX[i] + (sampleX[i + 1] - sampleX[i]) * t;
+  y = sampleY[i] + (sampleY[i + 1] - sampleY[i]) * t;
+}
+
+void advancePathScalar(const FlightPath &path, float *distance, const float *speed, int count, float dt,
+                       bool wrap, float *x, float *y)
+{
+  for (int i = 0; i < count; i++)
+  {
+    float d = distance[i] + speed[i] * dt;
+    if (wrap)
+      d = d >= path.length ? d - path.length : d;
+    else
+      d = std::min(d, path.length);
+    distance[i] = d;
+    path.positionAt(d, x[i], y[i]);
+  }
+}
+
+#if AABB_KERNEL_X86
+// The distance update and table index are vectorised; SSE2 has no gather, so
+// the four table reads per lane go through a small index array
+void advancePathSSE2(const FlightPath &path, float *distance, const float *speed, int count, float dt,
+                     bool wrap, float *x, float *y)
+{
+  const float *sx = path.sampleX.data(), *sy = path.sampleY.data();
+  __m128 vdt = _mm_set1_ps(dt), len = _mm_set1_ps(path.length), inv = _mm_set1_ps(path.invSpacing);
+  __m128 maxF = _mm_set1_ps((float)path.sampleCount), zero = _mm_setzero_ps();
+  int i = 0;
+  for (; i + 4 <= count; i += 4)
+  {
+    __m128 d = _mm_add_ps(_mm_loadu_ps(distance + i), _mm_mul_ps(_mm_loadu_ps(speed + i), vdt));
+    if (wrap)
+      d = _mm_sub_ps(d, _mm_and_ps(_mm_cmpge_ps(d, len), len));
+    else
+      d = _mm_min_ps(d, len);
+    _mm_storeu_ps(distance + i, d);
+
+    __m128 f = _mm_max_ps(zero, _mm_min_ps(maxF, _mm_mul_ps(d, inv)));
+    __m128i index = _mm_cvttps_epi32(f);
+    __m128 t = _mm_sub_ps(f, _mm_cvtepi32_ps(index));
+    alignas(16) int k[4];
+    _mm_store_si128((__m128i *)k, index);
+    __m128 x0 = _mm_setr_ps(sx[k[0]], sx[k[1]], sx[k[2]], sx[k[3]]);
+    __m128 x1 = _mm_setr_ps(sx[k[0] + 1], sx[k[1] + 1], sx[k[2] + 1], sx[k[3] + 1]);
+    __m128 y0 = _mm_setr_ps(sy[k[0]], sy[k[1]], sy[k[2]], sy[k[3]]);
+    __m128 y1 = _mm_setr_ps(sy[k[0] + 1], sy[k[1] + 1], sy[k[2] + 1], sy[k[3] + 1]);
+    _mm_storeu_ps(x + i, _mm_add_ps(x0, _mm_mul_ps(_mm_sub_ps(x1, x0), t)));
+    _mm_storeu_ps(y + i, _mm_add_ps(y0, _mm_mul_ps(_mm_sub_ps(y1, y0), t)));
+  }
+  advancePathScalar(path, distance + i, speed + i, count - i, dt, wrap, x + i, y + i);
+}
+
+__attribute__((target("avx2")))
+void advancePathAVX2(const FlightPath &path, float *distance, const float *speed, int count, float dt,
+                     bool wrap, float *x, float *y)
+{
+  const float *sx = path.sampleX.data(), *sy = path.sampleY.data();
+  __m256 vdt = _mm256_set1_ps(dt), len = _mm256_set1_ps(path.length), inv = _mm256_set1_ps(path.invSpacing);
+  __m256 maxF = _mm256_set1_ps((float)path.sampleCount), zero = _mm256_setzero_ps();
+  int i = 0;
+  for (; i + 8 <= count; i += 8)
+  {
+    __m256 d = _mm256_add_ps(_mm256_loadu_ps(distance + i), _mm256_mul_ps(_mm256_loadu_ps(speed + i), vdt));
+    if (wrap)
+      d = _mm256_sub_ps(d, _mm256_and_ps(_mm256_cmp_ps(d, len, _CMP_GE_OQ), len));
+    else
+      d = _mm256_min_ps(d, len);
+    _mm256_storeu_ps(distance + i, d);
+
+    __m256 f = _mm256_max_ps(zero, _mm256_min_ps(maxF, _mm256_mul_ps(d, inv)));
+    __m256i index = _mm256_cvttps_epi32(f);
+    __m256i next = _mm256_add_epi32(index, _mm256_set1_epi32(1));
+    __m256 t = _mm256_sub_ps(f, _mm256_cvtepi32_ps(index));
+    __m256 x0 = _mm256_i32gather_ps(sx, index, 4), x1 = _mm256_i32gather_ps(sx, next, 4);
+    __m256 y0 = _mm256_i32gather_ps(sy, index, 4), y1 = _mm256_i32gather_ps(sy, next, 4);
+    _mm256_storeu_ps(x + i, _mm256_add_ps(x0, _mm256_mul_ps(_mm256_sub_ps(x1, x0), t)));
+    _mm256_storeu_ps(y + i, _mm256_add_ps(y0, _mm256_mul_ps(_mm256_sub_ps(y1, y0), t)));
+  }
+  _mm256_zeroupper();
+  advancePathSSE2(path, distance + i, speed + i, count - i, dt, wrap, x + i, y + i);
+}
+#endif
+
+#if AABB_KERNEL_NEON
+void advancePathNEON(const FlightPath &path, float *distance, const float *speed, int count, float dt,
+                     bool wrap, float *x, float *y)
+{
+  const float *sx = path.sampleX.data(), *sy = path.sampleY.data();
+  float32x4_t vdt = vdupq_n_f32(dt), len = vdupq_n_f32(path.length), inv = vdupq_n_f32(path.invSpacing);
+  float32x4_t maxF = vdupq_n_f32((float)path.sampleCount), zero = vdupq_n_f32(0);
+  int i = 0;
+  for (; i + 4 <= count; i += 4)
+  {
+    float32x4_t d = vaddq_f32(vld1q_f32(distance + i), vmulq_f32(vld1q_f32(speed + i), vdt));
+    if (wrap)
+      d = vsubq_f32(d, vreinterpretq_f32_u32(vandq_u32(vcgeq_f32(d, len), vreinterpretq_u32_f32(len))));
+    else
+      d = vminq_f32(d, len);
+    vst1q_f32(distance + i, d);
+
+    float32x4_t f = vmaxq_f32(zero, vminq_f32(maxF, vmulq_f32(d, inv)));
+    int32x4_t index = vcvtq_s32_f32(f);
+    float32x4_t t = vsubq_f32(f, vcvtq_f32_s32(index));
+    int k[4];
+    vst1q_s32(k, index);
+    float x0v[4] = {sx[k[0]], sx[k[1]], sx[k[2]], sx[k[3]]};
+    float x1v[4] = {sx[k[0] + 1], sx[k[1] + 1], sx[k[2] + 1], sx[k[3] + 1]};
+    float y0v[4] = {sy[k[0]], sy[k[1]], sy[k[2]], sy[k[3]]};
+    float y1v[4] = {sy[k[0] + 1], sy[k[1] + 1], sy[k[2] + 1], sy[k[3] + 1]};
+    float32x4_t x0 = vld1q_f32(x0v), y0 = vld1q_f32(y0v);
+    vst1q_f32(x + i, vaddq_f32(x0, vmulq_f32(vsubq_f32(vld1q_f32(x1v), x0), t)));
+    vst1q_f32(y + i, vaddq_f32(y0, vmulq_f32(vsubq_f32(vld1q_f32(y1v), y0), t)));
+  }
+  advancePathScalar(path, distance + i, speed + i, count - i, dt, wrap, x + i, y + i);
+}
+#endif
+
+PathAdvanceFn selectPathKernel(const char **name)
+{
+  if (getenv("AIRPORT_RUSH_SCALAR_AABB"))
+  {
+    *name = "scalar";
+    return advancePathScalar;
+  }
+#if AABB_KERNEL_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+  {
+    *name = "avx2";
+    return advancePathAVX2;
+  }
+  *name = "sse2";
+  return advancePathSSE2;
+#elif AABB_KERNEL_NEON
+  *name = "neon";
+  return advancePathNEON;
+#else
+  *name = "scalar";
+  return advancePathScalar;
+#endif
+}
+
+// --- ENTITY STORE ---
+
+void EntityStore::setActive(int index, bool active)
+{
+  unsigned long long bit = 1ULL << (index & 63);
+  if (active)
+    activeBits[index >> 6] |= bit;
+  else
+    activeBits[index >> 6] &= ~bit;
+}
+
+// Bits past size() are always clear
+int EntityStore::activeCount() const
+{
+  int active = 0;
+  for (unsigned long long bits : activeBits)
+    active += __builtin_popcountll(bits);
+  return active;
+}
+
+EntityHandle EntityStore::add(float px, float py, float width, float height, int entityType)
+{
+  int slot;
+  if (!freeSlots.empty())
+  {
+    slot = freeSlots.back();
+    freeSlots.pop_back();
+  }
+  else
+  {
+    slot = (int)slotToDense.size();
+    slotToDense.push_back(-1);
+    slotGeneration.push_back(0);
+  }
+
+  int index = size();
+  x.push_back(px);
+  y.push_back(py);
+  w.push_back(width);
+  h.push_back(height);
+  type.push_back(entityType);
+  rotation.push_back(0);
+  animScale.push_back(1.0f);
+  denseToSlot.push_back(slot);
+  if ((size_t)(index >> 6) >= activeBits.size())
+    activeBits.push_back(0);
+  setActive(index, true);
+
+  slotToDense[slot] = index;
+  return {slot, slotGeneration[slot]};
+}
+
+void EntityStore::removeAt(int index)
+{
+  int last = size() - 1;
+  int slot = denseToSlot[index];
+
+  if (index != last)
+  {
+    x[index] = x[last];
+    y[index] = y[last];
+    w[index] = w[last];
+    h[index] = h[last];
+    type[index] = type[last];
+    rotation[index] = rotation[last];
+    animScale[index] = animScale[last];
+    setActive(index, isActive(last));
+    denseToSlot[index] = denseToSlot[last];
+    slotToDense[denseToSlot[index]] = index;
+  }
+
+  x.pop_back();
+  y.pop_back();
+  w.pop_back();
+  h.pop_back();
+  type.pop_back();
+  rotation.pop_back();
+  animScale.pop_back();
+  denseToSlot.pop_back();
+  setActive(last, false);
+
+  slotToDense[slot] = -1;
+  slotGeneration[slot]++;
+  freeSlots.push_back(slot);
+}
+
+bool EntityStore::remove(EntityHandle handle)
+{
+  int index = indexOf(handle);
+  if (index < 0)
+    return false;
+  removeAt(index);
+  return true;
+}
+
+int EntityStore::indexOf(EntityHandle handle) const
+{
+  if (handle.slot < 0 || handle.slot >= (int)slotToDense.size() ||
+      slotGeneration[handle.slot] != handle.generation)
+    return -1;
+  return slotToDense[handle.slot];
+}
+
+EntityHandle EntityStore::handleAt(int index) const
+{
+  int slot = denseToSlot[index];
+  return {slot, slotGeneration[slot]};
+}
+
+void EntityStore::clear()
+{
+  x.clear();
+  y.clear();
+  w.clear();
+  h.clear();
+  type.clear();
+  rotation.clear();
+  animScale.clear();
+  activeBits.clear();
+  denseToSlot.clear();
+  slotToDense.clear();
+  slotGeneration.clear();
+  freeSlots.clear();
+}
+
+// Replaces the whole store with count entities taken from the given columns,
+// in slots 0..count-1
+void EntityStore::assign(int count, const float *px, const float *py, const float *width, const float *height,
+                         const int *entityType, const float *angle)
+{
+  x.assign(px, px + count);
+  y.assign(py, py + count);
+  w.assign(width, width + count);
+  h.assign(height, height + count);
+  type.assign(entityType, entityType + count);
+  rotation.assign(angle, angle + count);
+  animScale.assign(count, 1.0f);
+  activeBits.assign((count + 63) / 64, ~0ull);
+  if (count & 63)
+    activeBits.back() = (1ull << (count & 63)) - 1;
+  denseToSlot.resize(count);
+  slotToDense.resize(count);
+  for (int i = 0; i < count; i++)
+  {
+    denseToSlot[i] = i;
+    slotToDense[i] = i;
+  }
+  slotGeneration.assign(count, 0);
+  freeSlots.clear();
+}
+
+// --- SPATIAL HASH GRID ---
+
+int gridHashCell(int cellX, int cellY)
+{
+  unsigned int h = ((unsigned int)cellX * 73856093u) ^ ((unsigned int)cellY * 19349663u);
+  return (int)(h & (GRID_BUCKET_COUNT - 1));
+}
+
+void SpatialGrid::clear()
+{
+  // Keep bucket capacity around, layouts are rebuilt on every reset
+  buckets.resize(GRID_BUCKET_COUNT);
+  for (auto &bucket : buckets)
+  {
+    bucket.ids.clear();
+    bucket.minX.clear();
+    bucket.minY.clear();
+    bucket.maxX.clear();
+    bucket.maxY.clear();
+  }
+  maxHalfExtent = 0;
+  count = 0;
+}
+
+int SpatialGrid::bucketFor(float x, float y) const
+{
+  return gridHashCell((int)floorf(x / GRID_CELL_SIZE), (int)floorf(y / GRID_CELL_SIZE));
+}
+
+void SpatialGrid::insert(int id, float x, float y, float width, float height)
+{
+  if (buckets.empty())
+    clear();
+
+  // Same arithmetic as checkCollision() callers use, so results match bit for bit
+  float left = x - width / 2;
+  float bottom = y - height / 2;
+
+  GridBucket &bucket = buckets[bucketFor(x, y)];
+  bucket.ids.push_back(id);
+  bucket.minX.push_back(left);
+  bucket.minY.push_back(bottom);
+  bucket.maxX.push_back(left + width);
+  bucket.maxY.push_back(bottom + height);
+
+  maxHalfExtent = std::max(maxHalfExtent, std::max(width, height) / 2);
+  count++;
+}
+
+// insert() for ids 0..count-1 at once: one counting pass sizes every bucket,
+// so the fill never reallocates
+void SpatialGrid::insertAll(int count, const float *x, const float *y, const float *width, const float *height)
+{
+  if (buckets.empty())
+    clear();
+
+  std::vector<int> bucketOf(count);
+  std::vector<int> added(GRID_BUCKET_COUNT, 0);
+  for (int i = 0; i < count; i++)
+  {
+    bucketOf[i] = bucketFor(x[i], y[i]);
+    added[bucketOf[i]]++;
+  }
+  for (int b = 0; b < GRID_BUCKET_COUNT; b++)
+  {
+    if (added[b] == 0)
+      continue;
+    GridBucket &bucket = buckets[b];
+    size_t size = bucket.ids.size() + added[b];
+    bucket.ids.reserve(size);
+    bucket.minX.reserve(size);
+    bucket.minY.reserve(size);
+    bucket.maxX.reserve(size);
+    bucket.maxY.reserve(size);
+  }
+  for (int i = 0; i < count; i++)
+  {
+    float left = x[i] - width[i] / 2;
+    float bottom = y[i] - height[i] / 2;
+    GridBucket &bucket = buckets[bucketOf[i]];
+    bucket.ids.push_back(i);
+    bucket.minX.push_back(left);
+    bucket.minY.push_back(bottom);
+    bucket.maxX.push_back(left + width[i]);
+    bucket.maxY.push_back(bottom + height[i]);
+    maxHalfExtent = std::max(maxHalfExtent, std::max(width[i], height[i]) / 2);
+  }
+  this->count += count;
+}
+
+void SpatialGrid::remove(int id, float x, float y)
+{
+  if (buckets.empty())
+    return;
+
+  GridBucket &bucket = buckets[bucketFor(x, y)];
+  for (size_t i = 0; i < bucket.ids.size(); i++)
+  {
+    if (bucket.ids[i] == id)
+    {
+      size_t last = bucket.ids.size() - 1;
+      bucket.ids[i] = bucket.ids[last];
+      bucket.minX[i] = bucket.minX[last];
+      bucket.minY[i] = bucket.minY[last];
+      bucket.maxX[i] = bucket.maxX[last];
+      bucket.maxY[i] = bucket.maxY[last];
+      bucket.ids.pop_back();
+      bucket.minX.pop_back();
+      bucket.minY.pop_back();
+      bucket.maxX.pop_back();
+      bucket.maxY.pop_back();
+      count--;
+      return;
+    }
+  }
+}
+
+// Unique buckets whose cells can hold an entry overlapping the box, or -1 if
+// the box covers more cells than fit in out (caller then scans every bucket).
+int SpatialGrid::collectBuckets(float x, float y, float width, float height, int *out, int maxOut) const
+{
+  int cellX0 = (int)floorf((x - maxHalfExtent) / GRID_CELL_SIZE);
+  int cellX1 = (int)floorf((x + width + maxHalfExtent) / GRID_CELL_SIZE);
+  int cellY0 = (int)floorf((y - maxHalfExtent) / GRID_CELL_SIZE);
+  int cellY1 = (int)floorf((y + height + maxHalfExtent) / GRID_CELL_SIZE);
+
+  int n = 0;
+  for (int cellY = cellY0; cellY <= cellY1; cellY++)
+  {
+    for (int cellX = cellX0; cellX <= cellX1; cellX++)
+    {
+      // Two cells can hash to the same bucket; visiting it twice would double-count
+      int b = gridHashCell(cellX, cellY);
+      bool seen = false;
+      for (int k = 0; k < n && !seen; k++)
+      {
+        seen = out[k] == b;
+      }
+      if (!seen)
+      {
+        if (n == maxOut)
+          return -1;
+        out[n++] = b;
+      }
+    }
+  }
+  return n;
+}
+
+// Entries of the listed buckets (every bucket when bucketList is NULL) whose
+// AABB overlaps the box
+int SpatialGrid::collectHits(const int *bucketList, int n, float x, float y, float width, float height,
+                             std::vector<int> &hits) const
+{
+  int total = bucketList ? n : GRID_BUCKET_COUNT;
+  int found = 0;
+  int batchHits[GRID_QUERY_BATCH];
+  for (int k = 0; k < total; k++)
+  {
+    const GridBucket &bucket = buckets[bucketList ? bucketList[k] : k];
+    int size = (int)bucket.ids.size();
+    for (int start = 0; start < size; start += GRID_QUERY_BATCH)
+    {
+      int m = aabbBatch(&bucket.minX[start], &bucket.minY[start], &bucket.maxX[start], &bucket.maxY[start],
+                        std::min(GRID_QUERY_BATCH, size - start), x, y, x + width, y + height, batchHits);
+      for (int j = 0; j < m; j++)
+      {
+        hits.push_back(bucket.ids[start + batchHits[j]]);
+      }
+      found += m;
+    }
+  }
+  return found;
+}
+
+int SpatialGrid::query(float x, float y, float width, float height, std::vector<int> &hits) const
+{
+  if (count == 0)
+    return 0;
+
+  int bucketList[64];
+  int n = collectBuckets(x, y, width, height, bucketList, 64);
+  return collectHits(n < 0 ? NULL : bucketList, n, x, y, width, height, hits);
+}
+
+// query() for boxes many cells wide, such as the camera view: visits the
+// bucket of every covered cell once, without the 64-bucket limit, and only
+// falls back to the whole table when the box has more cells than it has
+// buckets.
+int SpatialGrid::queryRegion(float x, float y, float width, float height, std::vector<int> &hits) const
+{
+  if (count == 0)
+    return 0;
+
+  int cellX0 = (int)floorf((x - maxHalfExtent) / GRID_CELL_SIZE);
+  int cellX1 = (int)floorf((x + width + maxHalfExtent) / GRID_CELL_SIZE);
+  int cellY0 = (int)floorf((y - maxHalfExtent) / GRID_CELL_SIZE);
+  int cellY1 = (int)floorf((y + height + maxHalfExtent) / GRID_CELL_SIZE);
+  if ((long long)(cellX1 - cellX0 + 1) * (cellY1 - cellY0 + 1) > GRID_BUCKET_COUNT)
+    return collectHits(NULL, 0, x, y, width, height, hits);
+
+  seen.resize(GRID_BUCKET_COUNT, 0);
+  bucketList.clear();
+  for (int cellY = cellY0; cellY <= cellY1; cellY++)
+  {
+    for (int cellX = cellX0; cellX <= cellX1; cellX++)
+    {
+      int b = gridHashCell(cellX, cellY);
+      if (!seen[b] && !buckets[b].ids.empty())
+      {
+        seen[b] = 1;
+        bucketList.push_back(b);
+      }
+    }
+  }
+  for (int b : bucketList)
+    seen[b] = 0;
+  return collectHits(bucketList.data(), (int)bucketList.size(), x, y, width, height, hits);
+}
+
+bool SpatialGrid::overlapsAny(float x, float y, float width, float height) const
+{
+  if (count == 0)
+    return false;
+
+  int bucketList[64];
+  int n = collectBuckets(x, y, width, height, bucketList, 64);
+  int total = n < 0 ? GRID_BUCKET_COUNT : n;
+
+  int batchHits[GRID_QUERY_BATCH];
+  for (int k = 0; k < total; k++)
+  {
+    const GridBucket &bucket = buckets[n < 0 ? k : bucketList[k]];
+    int size = (int)bucket.ids.size();
+    for (int start = 0; start < size; start += GRID_QUERY_BATCH)
+    {
+      if (aabbBatch(&bucket.minX[start], &bucket.minY[start], &bucket.maxX[start], &bucket.maxY[start],
+                    std::min(GRID_QUERY_BATCH, size - start), x, y, x + width, y + height, batchHits) > 0)
+      {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+// --- CROWD ---
+
+void *crowdWorkerThread(void *arg)
+{
+  CrowdWorkers *pool = (CrowdWorkers *)arg;
+  unsigned int seen = 0;
+  pthread_mutex_lock(&pool->lock);
+  while (true)
+  {
+    while (!pool->stopping && pool->generation == seen)
+      pthread_cond_wait(&pool->wake, &pool->lock);
+    if (pool->stopping)
+      break;
+    seen = pool->generation;
+    pthread_mutex_unlock(&pool->lock);
+
+    pool->workChunks();
+
+    pthread_mutex_lock(&pool->lock);
+    if (--pool->busy == 0)
+      pthread_cond_signal(&pool->done);
+  }
+  pthread_mutex_unlock(&pool->lock);
+  return NULL;
+}
+
+void CrowdWorkers::start(int threads)
+{
+  threads = std::max(0, std::min(CROWD_MAX_WORKERS, threads));
+  for (threadCount = 0; threadCount < threads; threadCount++)
+  {
+    if (pthread_create(&this->threads[threadCount], NULL, crowdWorkerThread, this) != 0)
+      break;
+  }
+}
+
+void CrowdWorkers::stop()
+{
+  pthread_mutex_lock(&lock);
+  stopping = true;
+  pthread_cond_broadcast(&wake);
+  pthread_mutex_unlock(&lock);
+  for (int i = 0; i < threadCount; i++)
+    pthread_join(threads[i], NULL);
+  threadCount = 0;
+  stopping = false;
+}
+
+void CrowdWorkers::workChunks()
+{
+  int chunk;
+  while ((chunk = nextChunk.fetch_add(1)) * CROWD_CHUNK < jobCount)
+  {
+    job(context, chunk * CROWD_CHUNK, std::min(jobCount, (chunk + 1) * CROWD_CHUNK));
+  }
+}
+
+void CrowdWorkers::run(void (*fn)(void *, int, int), void *fnContext, int count)
+{
+  pthread_mutex_lock(&lock);
+  job = fn;
+  context = fnContext;
+  jobCount = count;
+  nextChunk = 0;
+  busy = threadCount;
+  generation++;
+  pthread_cond_broadcast(&wake);
+  pthread_mutex_unlock(&lock);
+
+  workChunks();
+
+  pthread_mutex_lock(&lock);
+  while (busy > 0)
+    pthread_cond_wait(&done, &lock);
+  pthread_mutex_unlock(&lock);
+}
+
+void stopCrowdWorkers()
+{
+  crowdWorkers.stop();
+}
+
+int Crowd::cellOf(float px, float py) const
+{
+  int cx = std::max(0, std::min(cellsX - 1, (int)((px - CROWD_LEFT) / CROWD_CELL)));
+  int cy = std::max(0, std::min(cellsY - 1, (int)((py - CROWD_BOTTOM) / CROWD_CELL)));
+  return cy * cellsX + cx;
+}
+
+// Agents start spread over the whole terminal, heading for random gates
+void Crowd::spawn(int agents, unsigned int seed)
+{
+  cellsX = (int)ceilf((CROWD_RIGHT - CROWD_LEFT) / CROWD_CELL);
+  cellsY = (int)ceilf((CROWD_TOP - CROWD_BOTTOM) / CROWD_CELL);
+  count = std::max(0, agents);
+  x.resize(count);
+  y.resize(count);
+  vx.assign(count, 0.0f);
+  vy.assign(count, 0.0f);
+  speed.resize(count);
+  gate.resize(count);
+  rng.resize(count);
+  for (int i = 0; i < count; i++)
+  {
+    rng[i] = seed * 2654435761u + i * 40503u + 1;
+    x[i] = CROWD_LEFT + nextRandom(rng[i]) % (int)(CROWD_RIGHT - CROWD_LEFT);
+    y[i] = CROWD_BOTTOM + nextRandom(rng[i]) % (int)(CROWD_TOP - CROWD_BOTTOM - 40);
+    speed[i] = 25.0f + nextRandom(rng[i]) % 25;
+    gate[i] = nextRandom(rng[i]) % CROWD_GATE_COUNT;
+  }
+  prevX = x;
+  prevY = y;
+  prevVx = vx;
+  prevVy = vy;
+  fieldsDirty = true;
+}
+
+// Dijkstra over the free cells from each gate (8 neighbours, no cutting
+// past a blocked corner); a cell's flow points at its cheapest neighbour.
+// Blocked cells point at their cheapest free neighbour, so an agent pushed
+// into a guard walks back out.
+void Crowd::buildFlowFields(const EntityStore &obstacles)
+{
+  int cells = cellsX * cellsY;
+  blocked.assign(cells, 0);
+  for (int i = 0; i < obstacles.size(); i++)
+  {
+    float left = obstacles.x[i] - obstacles.w[i] / 2 - CROWD_RADIUS;
+    float right = obstacles.x[i] + obstacles.w[i] / 2 + CROWD_RADIUS;
+    float bottom = obstacles.y[i] - obstacles.h[i] / 2 - CROWD_RADIUS;
+    float top = obstacles.y[i] + obstacles.h[i] / 2 + CROWD_RADIUS;
+    if (right < CROWD_LEFT || left > CROWD_RIGHT || top < CROWD_BOTTOM || bottom > CROWD_TOP)
+      continue;
+    int x0 = cellOf(left, bottom) % cellsX, y0 = cellOf(left, bottom) / cellsX;
+    int x1 = cellOf(right, top) % cellsX, y1 = cellOf(right, top) / cellsX;
+    for (int cy = y0; cy <= y1; cy++)
+    {
+      for (int cx = x0; cx <= x1; cx++)
+        blocked[cy * cellsX + cx] = 1;
+    }
+  }
+
+  const int dx[8] = {1, -1, 0, 0, 1, 1, -1, -1};
+  const int dy[8] = {0, 0, 1, -1, 1, -1, 1, -1};
+  const float cost[8] = {1, 1, 1, 1, 1.41421356f, 1.41421356f, 1.41421356f, 1.41421356f};
+  auto passable = [&](int cx, int cy, int k) {
+    int nx = cx + dx[k], ny = cy + dy[k];
+    if (nx < 0 || ny < 0 || nx >= cellsX || ny >= cellsY)
+      return false;
+    if (k >= 4 && (blocked[cy * cellsX + nx] || blocked[ny * cellsX + cx]))
+      return false;
+    return true;
+  };
+
+  std::vector<float> distance(cells);
+  typedef std::pair<float, int> QueueEntry;
+  for (int g = 0; g < CROWD_GATE_COUNT; g++)
+  {
+    std::fill(distance.begin(), distance.end(), 1e30f);
+    std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry> > open;
+    // Every free cell of the column under the gate starts at its distance
+    // straight up to the gate line. With only the gate line as the goal, every
+    // path from the side would end at the same corner cell and the crowd
+    // would queue there; this way agents enter the column anywhere along its
+    // side and spread out walking up it.
+    std::vector<unsigned char> goal(cells, 0);
+    float gateLine = crowdGates[g][1] - CROWD_GATE_DEPTH;
+    auto inColumn = [&](int cx) { return fabsf(CROWD_LEFT + (cx + 0.5f) * CROWD_CELL - crowdGates[g][0]) <= CROWD_GATE_HALF_WIDTH; };
+    for (int c = 0; c < cells; c++)
+    {
+      float centerY = CROWD_BOTTOM + (c / cellsX + 0.5f) * CROWD_CELL;
+      if (blocked[c] || !inColumn(c % cellsX))
+        continue;
+      goal[c] = centerY >= gateLine;
+      distance[c] = std::max(0.0f, (gateLine - centerY) / CROWD_CELL);
+      open.push(QueueEntry(distance[c], c));
+    }
+    while (!open.empty())
+    {
+      QueueEntry top = open.top();
+      open.pop();
+      int c = top.second;
+      if (top.first > distance[c])
+        continue;
+      int cx = c % cellsX, cy = c / cellsX;
+      for (int k = 0; k < 8; k++)
+      {
+        if (!passable(cx, cy, k))
+          continue;
+        int n = (cy + dy[k]) * cellsX + cx + dx[k];
+        if (blocked[n])
+          continue;
+        float d = top.first + cost[k];
+        if (d < distance[n])
+        {
+          distance[n] = d;
+          open.push(QueueEntry(d, n));
+        }
+      }
+    }
+
+    flowX[g].assign(cells, 0.0f);
+    flowY[g].assign(cells, 0.0f);
+    for (int c = 0; c < cells; c++)
+    {
+      int cx = c % cellsX, cy = c / cellsX;
+      float fx = 0, fy = 0;
+      if (goal[c])
+      {
+        fy = 1; // straight through the gate line
+      }
+      else
+      {
+        float best = blocked[c] ? 1e30f : distance[c];
+        for (int k = 0; k < 8; k++)
+        {
+          if (!blocked[c] && !passable(cx, cy, k))
+            continue;
+          int nx = cx + dx[k], ny = cy + dy[k];
+          if (nx < 0 || ny < 0 || nx >= cellsX || ny >= cellsY)
+            continue;
+          int n = ny * cellsX + nx;
+          if (!blocked[n] && distance[n] < best)
+          {
+            best = distance[n];
+            fx = (float)dx[k];
+            fy = (float)dy[k];
+          }
+        }
+      }
+      float len = sqrtf(fx * fx + fy * fy);
+      if (len > 0)
+      {
+        flowX[g][c] = fx / len;
+        flowY[g][c] = fy / len;
+      }
+    }
+  }
+  fieldsDirty = false;
+}
+
+// Counting sort of the agents by cell
+void Crowd::buildBins()
+{
+  int cells = cellsX * cellsY;
+  binStart.assign(cells + 1, 0);
+  binAgents.resize(count);
+  for (int i = 0; i < count; i++)
+    binStart[cellOf(x[i], y[i]) + 1]++;
+  for (int c = 0; c < cells; c++)
+    binStart[c + 1] += binStart[c];
+  std::vector<int> fill(binStart.begin(), binStart.end() - 1);
+  for (int i = 0; i < count; i++)
+    binAgents[fill[cellOf(x[i], y[i])]++] = i;
+}
+
+void crowdUpdateChunk(void *context, int begin, int end)
+{
+  ((Crowd *)context)->updateRange(begin, end);
+}
+
+void Crowd::update(float dt, const EntityStore &obstacles, float playerX, float playerY, CrowdWorkers *workers)
+{
+  if (count == 0)
+    return;
+  if (fieldsDirty)
+    buildFlowFields(obstacles);
+  buildBins();
+
+  stepDt = dt;
+  stepPlayerX = playerX;
+  stepPlayerY = playerY;
+  if (workers && workers->threadCount > 0 && count > CROWD_CHUNK)
+    workers->run(crowdUpdateChunk, this, count);
+  else
+    updateRange(0, count);
+
+  std::swap(x, prevX);
+  std::swap(y, prevY);
+  std::swap(vx, prevVx);
+  std::swap(vy, prevVy);
+}
+
+// Boarded: start again at the entrance along the bottom, for another gate
+void Crowd::respawn(int i, float &px, float &py)
+{
+  px = CROWD_LEFT + nextRandom(rng[i]) % (int)(CROWD_RIGHT - CROWD_LEFT);
+  py = CROWD_BOTTOM + 2 + nextRandom(rng[i]) % 12;
+  gate[i] = nextRandom(rng[i]) % CROWD_GATE_COUNT;
+}
+
+// Reads x/y/vx/vy, writes prevX/prevY/prevVx/prevVy (the next state) for
+// agents [begin, end) only
+void Crowd::updateRange(int begin, int end)
+{
+  const float spacing = 2 * CROWD_RADIUS;
+  float blend = std::min(1.0f, stepDt * CROWD_STEERING);
+  for (int i = begin; i < end; i++)
+  {
+    float px = x[i], py = y[i];
+    int cell = cellOf(px, py);
+    int cx = cell % cellsX, cy = cell / cellsX;
+    int g = gate[i];
+    float wantX = flowX[g][cell] * speed[i];
+    float wantY = flowY[g][cell] * speed[i];
+
+    // Separation from the agents in the 3x3 cells around
+    float pushX = 0, pushY = 0;
+    int neighbours = 0;
+    for (int ny = std::max(0, cy - 1); ny <= std::min(cellsY - 1, cy + 1); ny++)
+    {
+      for (int nx = std::max(0, cx - 1); nx <= std::min(cellsX - 1, cx + 1); nx++)
+      {
+        int c = ny * cellsX + nx;
+        for (int k = binStart[c]; k < binStart[c + 1] && neighbours < CROWD_MAX_NEIGHBOURS; k++)
+        {
+          int j = binAgents[k];
+          float ox = px - x[j], oy = py - y[j];
+          float d2 = ox * ox + oy * oy;
+          if (j == i || d2 >= spacing * spacing)
+            continue;
+          neighbours++;
+          if (d2 < 1e-6f)
+          {
+            // Same spot: split them by index so the result doesn't depend on order
+            pushX += j < i ? 1.0f : -1.0f;
+            continue;
+          }
+          float d = sqrtf(d2);
+          float weight = (spacing - d) / spacing;
+          pushX += ox / d * weight;
+          pushY += oy / d * weight;
+        }
+      }
+    }
+
+    // The player shoulders through
+    float ox = px - stepPlayerX, oy = py - stepPlayerY;
+    float d2 = ox * ox + oy * oy;
+    if (d2 < CROWD_PLAYER_RADIUS * CROWD_PLAYER_RADIUS && d2 > 1e-6f)
+    {
+      float d = sqrtf(d2);
+      float weight = 3 * (CROWD_PLAYER_RADIUS - d) / CROWD_PLAYER_RADIUS;
+      pushX += ox / d * weight;
+      pushY += oy / d * weight;
+    }
+
+    wantX += pushX * speed[i] * 1.5f;
+    wantY += pushY * speed[i] * 1.5f;
+    float nvx = vx[i] + (wantX - vx[i]) * blend;
+    float nvy = vy[i] + (wantY - vy[i]) * blend;
+    float maxSpeed = speed[i] * 2;
+    float v2 = nvx * nvx + nvy * nvy;
+    if (v2 > maxSpeed * maxSpeed)
+    {
+      float scale = maxSpeed / sqrtf(v2);
+      nvx *= scale;
+      nvy *= scale;
+    }
+
+    float nx = std::max(CROWD_LEFT, std::min(CROWD_RIGHT, px + nvx * stepDt));
+    float ny = std::max(CROWD_BOTTOM, std::min(CROWD_TOP, py + nvy * stepDt));
+    if (blocked[cellOf(nx, ny)] && !blocked[cell])
+    {
+      // Slide along a guard instead of walking into it
+      if (!blocked[cellOf(nx, py)])
+        ny = py;
+      else if (!blocked[cellOf(px, ny)])
+        nx = px;
+      else
+        nx = px, ny = py;
+    }
+
+    if (ny >= crowdGates[g][1] - CROWD_GATE_DEPTH && fabsf(nx - crowdGates[g][0]) <= CROWD_GATE_HALF_WIDTH)
+    {
+      respawn(i, nx, ny);
+      nvx = nvy = 0;
+    }
+
+    prevX[i] = nx;
+    prevY[i] = ny;
+    prevVx[i] = nvx;
+    prevVy[i] = nvy;
+  }
+}
+
+// Multiplier on the player's speed: every agent within reach slows them down
+float Crowd::slowdownAt(float px, float py) const
+{
+  if (count == 0 || binStart.empty())
+    return 1.0f;
+  int cell = cellOf(px, py);
+  int cx = cell % cellsX, cy = cell / cellsX;
+  int reach = (int)ceilf(CROWD_PLAYER_RADIUS / CROWD_CELL);
+  int near = 0;
+  for (int ny = std::max(0, cy - reach); ny <= std::min(cellsY - 1, cy + reach); ny++)
+  {
+    for (int nx = std::max(0, cx - reach); nx <= std::min(cellsX - 1, cx + reach); nx++)
+    {
+      int c = ny * cellsX + nx;
+      for (int k = binStart[c]; k < binStart[c + 1]; k++)
+      {
+        int j = binAgents[k];
+        float ox = x[j] - px, oy = y[j] - py;
+        if (ox * ox + oy * oy < CROWD_PLAYER_RADIUS * CROWD_PLAYER_RADIUS)
+          near++;
+      }
+    }
+  }
+  return std::max(0.3f, 1.0f / (1.0f + 0.15f * near));
+}
+
+// --- SIMULATION ---
+
+void Simulation::reset()
+{
+  gameState = SETUP;
+  score = 0;
+  lives = 5;
+  gameTime = 60;
+  gameTimer = 0;
+  friendCollected = false;
+
+  // Reset player position
+  playerX = 500;
+  playerY = 50;
+  playerAngle = 0;
+  currentSpeed = PLAYER_SPEED;
+  blockedByGuard = false;
+
+  // Reset camera
+  cameraOffsetX = 0;
+  cameraOffsetY = 250;
+
+  // Reset plane position
+  planeX = 500;
+  planeY = 450;
+  planeDistance = 0;
+
+  // Reset friend object
+  friendObj = {487, 400, 30, 35, true, 0, 0};
+
+  // Clear all game objects
+  obstacles.clear();
+  collectibles.clear();
+  powerups.clear();
+  obstacleGrid.clear();
+  collectibleGrid.clear();
+  powerupGrid.clear();
+  crowd.spawn(crowdSize, 1);
+
+  // Reset power-up states
+  invincible = false;
+  invincibleTimer = 0;
+  speedBoost = false;
+  speedBoostTimer = 0;
+
+  // Don't interpolate across the reset
+  prevCameraOffsetX = cameraOffsetX;
+  prevCameraOffsetY = cameraOffsetY;
+  prevPlaneX = planeX;
+  prevPlaneY = planeY;
+}
+
+// Applies one batch of inputs, then advances the game by one tick of dt seconds.
+// Timers and animation both advance by dt, so the tick rate is free to change.
+void Simulation::step(const SimInputs &inputs, float dt)
+{
+  events = 0;
+  prevCameraOffsetX = cameraOffsetX;
+  prevCameraOffsetY = cameraOffsetY;
+  prevPlaneX = planeX;
+  prevPlaneY = planeY;
+
+  if (inputs.restartPressed)
+  {
+    if (gameState == SETUP)
+    {
+      gameState = RUNNING;
+      events |= SIM_EVENT_STARTED;
+    }
+    else if (gameState == WIN || gameState == LOSE)
+    {
+      reset();
+      events |= SIM_EVENT_RESET;
+      if (verbose)
+        printf("DEBUG: Game reset! Press R to start again.\n");
+    }
+  }
+
+  if (inputs.levelToLoad && gameState == SETUP)
+  {
+    loadLevelFile(*this, inputs.levelToLoad);
+  }
+
+  for (const auto &placement : inputs.placements)
+  {
+    place(placement);
+  }
+
+  if (gameState == RUNNING)
+  {
+    movePlayer(inputs.moves, dt);
+    tick(dt);
+  }
+  tickCount++;
+}
+
+void Simulation::place(const Placement &placement)
+{
+  float mapX = placement.x;
+  float mapY = placement.y;
+
+  if (obstacleGrid.overlapsAny(mapX - 10, mapY - 10, 20, 20))
+  {
+    return;
+  }
+
+  switch (placement.mode)
+  {
+  case OBSTACLE:
+    obstacleGrid.insert(obstacles.add(mapX, mapY, 16, 24, 0).slot, mapX, mapY, 16, 24);
+    crowd.fieldsDirty = true;
+    break;
+  case COLLECTIBLE:
+    collectibleGrid.insert(collectibles.add(mapX, mapY, 16, 10, 0).slot, mapX, mapY, 16, 10);
+    break;
+  case POWERUP1:
+    powerupGrid.insert(powerups.add(mapX, mapY, 20, 20, 1).slot, mapX, mapY, 20, 20);
+    break;
+  case POWERUP2:
+    powerupGrid.insert(powerups.add(mapX, mapY, 20, 20, 2).slot, mapX, mapY, 20, 20);
+    break;
+  case NONE:
+    break;
+  }
+}
+
+// Moves the player for one tick while the given directions are held.
+// currentSpeed is per 60 Hz tick like the other animation speeds, and a
+// diagonal covers the same distance per tick as a straight move.
+void Simulation::movePlayer(unsigned int moves, float dt)
+{
+  float dirX = 0, dirY = 0;
+  if (moves & moveBit(MOVE_UP))
+    dirY += 1;
+  if (moves & moveBit(MOVE_DOWN))
+    dirY -= 1;
+  if (moves & moveBit(MOVE_LEFT))
+    dirX -= 1;
+  if (moves & moveBit(MOVE_RIGHT))
+    dirX += 1;
+  if (dirX == 0 && dirY == 0)
+  {
+    blockedByGuard = false;
+    return;
+  }
+
+  playerAngle = atan2f(dirY, dirX) * 180.0f / 3.14159265f;
+  if (playerAngle < 0)
+    playerAngle += 360;
+
+  float distance = currentSpeed * dt * BASE_TICK_RATE * crowd.slowdownAt(playerX, playerY);
+  if (dirX != 0 && dirY != 0)
+    distance *= 0.70710678f;
+  float moveX = dirX * distance;
+  float moveY = dirY * distance;
+
+  // Only move if there's no collision with obstacles; a blocked diagonal
+  // still slides along whichever axis is free
+  bool blocked = wouldCollideWithObstacle(playerX + moveX, playerY + moveY);
+  if (blocked)
+  {
+    if (moveX != 0 && !wouldCollideWithObstacle(playerX + moveX, playerY))
+      moveY = 0;
+    else if (moveY != 0 && !wouldCollideWithObstacle(playerX, playerY + moveY))
+      moveX = 0;
+    else
+      moveX = moveY = 0;
+  }
+  cameraOffsetX -= moveX;
+  cameraOffsetY -= moveY;
+  playerX += moveX;
+  playerY += moveY;
+
+  // Apply damage when running into a guard (only if not invincible)
+  if (blocked && !blockedByGuard && !invincible)
+  {
+    lives--;
+    if (verbose)
+      printf("DEBUG: Hit guard! Lives: %d\n", lives);
+  }
+  blockedByGuard = blocked;
+
+  float mapLeft = 50.0f;
+  float mapRight = 950.0f;
+  float mapTop = 480.0f;
+  float mapBottom = 30.0f;
+
+  if (playerX < mapLeft) {
+    cameraOffsetX -= mapLeft - playerX;
+    playerX = mapLeft;
+  }
+  if (playerX > mapRight) {
+    cameraOffsetX += playerX - mapRight;
+    playerX = mapRight;
+  }
+  if (playerY < mapBottom) {
+    cameraOffsetY -= mapBottom - playerY;
+    playerY = mapBottom;
+  }
+  if (playerY > mapTop) {
+    cameraOffsetY += playerY - mapTop;
+    playerY = mapTop;
+  }
+}
+
+void Simulation::buildPlanePath()
+{
+  const int *control[4] = {bezierP0, bezierP1, bezierP2, bezierP3};
+  float points[8];
+  for (int i = 0; i < 4; i++)
+  {
+    points[2 * i] = (float)control[i][0];
+    points[2 * i + 1] = (float)control[i][1];
+  }
+  planePath.build(SPLINE_BEZIER, points, 4, false);
+  planeDistance = std::min(planeDistance, planePath.length);
+}
+
+void Simulation::tick(float dt)
+{
+  elapsedMs += dt * 1000.0f;
+
+  gameTimer += dt;
+  if (gameTimer >= 1.0f)
+  {
+    gameTimer -= 1.0f;
+    gameTime--;
+    if (gameTime <= 0)
+    {
+      gameState = LOSE;
+      events |= SIM_EVENT_LOST;
+    }
+  }
+
+  if (invincible)
+  {
+    invincibleTimer -= dt;
+    if (invincibleTimer <= 0)
+    {
+      invincible = false;
+    }
+  }
+
+  if (speedBoost)
+  {
+    speedBoostTimer -= dt;
+    if (speedBoostTimer <= 0)
+    {
+      speedBoost = false;
+      currentSpeed = PLAYER_SPEED;
+    }
+  }
+
+  float baseTicks = dt * BASE_TICK_RATE;
+
+  // Same lap time as stepping the bezier parameter by bezierSpeed, but at a
+  // constant speed along the curve
+  if (planePath.empty())
+    buildPlanePath();
+  float planeSpeed = planePath.length * bezierSpeed * BASE_TICK_RATE;
+  float lapDistance = planeDistance;
+  advancePath(planePath, &planeDistance, &planeSpeed, 1, dt, true, &planeX, &planeY);
+  // Wrapping to the start of the path is a jump, not a move: don't
+  // interpolate across it
+  if (planeDistance < lapDistance)
+  {
+    prevPlaneX = planeX;
+    prevPlaneY = planeY;
+  }
+
+  crowd.update(dt, obstacles, playerX, playerY, workers);
+
+  collectibleRotation += 2.0f * baseTicks;
+  if (collectibleRotation >= 360.0f)
+    collectibleRotation -= 360.0f;
+
+  conveyorOffset += baseTicks;
+  if (conveyorOffset >= WINDOW_WIDTH + 50)
+    conveyorOffset -= WINDOW_WIDTH + 50;
+
+  std::fill(collectibles.rotation.begin(), collectibles.rotation.end(), collectibleRotation);
+
+  float animScale = 0.8f + 0.4f * sin(elapsedMs * 0.01f);
+  std::fill(powerups.animScale.begin(), powerups.animScale.end(), animScale);
+
+  handleCollisions();
+
+  if (lives <= 0)
+  {
+    gameState = LOSE;
+    events |= SIM_EVENT_LOST;
+  }
+}
+
+bool Simulation::wouldCollideWithObstacle(float newX, float newY) const
+{
+  // If invincible (VIP badge), can pass through guards
+  if (invincible) {
+    return false;
+  }
+  
+  // Check if the new position would collide with any active obstacle
+  return obstacleGrid.overlapsAny(newX - PLAYER_SIZE / 2, newY - PLAYER_SIZE / 2,
+                                  PLAYER_SIZE, PLAYER_SIZE);
+}
+
+void Simulation::handleCollisions()
+{
+  ProfileScope scope(PHASE_COLLISIONS);
+  if (verbose && debugCounter % 60 == 0) {
+    printf("DEBUG: Player at (%.1f, %.1f), Friend at (%.1f, %.1f), Collectibles: %d, Lives: %d, Score: %d\n", 
+           playerX, playerY, friendObj.x, friendObj.y, collectibles.size(), lives, score);
+  }
+  debugCounter++;
+
+  float playerLeft = playerX - PLAYER_SIZE / 2;
+  float playerBottom = playerY - PLAYER_SIZE / 2;
+
+  gridHits.clear();
+  int guardHits = obstacleGrid.query(playerLeft, playerBottom, PLAYER_SIZE, PLAYER_SIZE, gridHits);
+  for (int i = 0; i < guardHits; i++)
+  {
+    if (!invincible)
+    {
+      lives--;
+      if (verbose)
+        printf("DEBUG: Hit guard! Lives: %d\n", lives);
+      // No need to push back since movement is now prevented
+    }
+  }
+
+  gridHits.clear();
+  collectibleGrid.query(playerLeft, playerBottom, PLAYER_SIZE, PLAYER_SIZE, gridHits);
+  for (int slot : gridHits)
+  {
+    int i = collectibles.indexOfSlot(slot);
+    if (verbose)
+      printf("DEBUG: Collected item at (%.1f, %.1f)\n", collectibles.x[i], collectibles.y[i]);
+    score += 5;
+    collectibleGrid.remove(slot, collectibles.x[i], collectibles.y[i]);
+    collectibles.removeAt(i);
+  }
+
+  if (friendObj.active && !friendCollected &&
+      checkCollision(playerX - PLAYER_SIZE / 2, playerY - PLAYER_SIZE / 2,
+                     PLAYER_SIZE, PLAYER_SIZE,
+                     friendObj.x - friendObj.width / 2, friendObj.y - friendObj.height / 2,
+                     friendObj.width, friendObj.height))
+  {
+    if (verbose)
+      printf("DEBUG: Collected friend at (%.1f, %.1f)\n", friendObj.x, friendObj.y);
+    friendCollected = true;
+    friendObj.active = false;
+    score += 20;
+  }
+
+  gridHits.clear();
+  powerupGrid.query(playerLeft, playerBottom, PLAYER_SIZE, PLAYER_SIZE, gridHits);
+  for (int slot : gridHits)
+  {
+    int i = powerups.indexOfSlot(slot);
+    if (verbose)
+      printf("DEBUG: Collected powerup at (%.1f, %.1f)\n", powerups.x[i], powerups.y[i]);
+    if (powerups.type[i] == 1)
+    {
+      invincible = true;
+      invincibleTimer = 5.0f;
+      if (verbose)
+        printf("DEBUG: Got VIP badge - invincible for 5 seconds!\n");
+    }
+    else if (powerups.type[i] == 2)
+    {
+      speedBoost = true;
+      speedBoostTimer = 5.0f;
+      currentSpeed = PLAYER_SPEED * 2.0f;
+      if (verbose)
+        printf("DEBUG: Got fast track - speed boost for 5 seconds!\n");
+    }
+    powerupGrid.remove(slot, powerups.x[i], powerups.y[i]);
+    powerups.removeAt(i);
+  }
 
-  glColor3f(0.0f, 0.0f, 0.0f);
-  glRasterPos2f(-8, 3);
-  char airportCode[] = "CLJ-MUC";
-  for (int i = 0; i < 7; i++)
+  if (friendCollected && checkCollision(playerX - PLAYER_SIZE / 2, playerY - PLAYER_SIZE / 2,
+                                        PLAYER_SIZE, PLAYER_SIZE,
+                                        planeX - 30, planeY - 6, 60, 12))
   {
-    glutBitmapCharacter(GLUT_BITMAP_HELVETICA_10, airportCode[i]);
+    if (verbose)
+      printf("DEBUG: Reached plane at (%.1f, %.1f)\n", planeX, planeY);
+    gameState = WIN;
+    events |= SIM_EVENT_WON;
   }
+}
 
-  glColor3f(0.0f, 0.0f, 0.0f);
-  glLineWidth(1);
-  glBegin(GL_LINES);
-  for (int i = -8; i < 0; i += 1)
+// FNV-1a over the observable game state, used to compare headless runs
+unsigned int Simulation::checksum() const
+{
+  unsigned int hash = 2166136261u;
+  auto mix = [&hash](const void *data, size_t size) {
+    const unsigned char *bytes = (const unsigned char *)data;
+    for (size_t i = 0; i < size; i++)
+    {
+      hash = (hash ^ bytes[i]) * 16777619u;
+    }
+  };
+
+  mix(&gameState, sizeof(gameState));
+  mix(&playerX, sizeof(playerX));
+  mix(&playerY, sizeof(playerY));
+  mix(&planeX, sizeof(planeX));
+  mix(&planeY, sizeof(planeY));
+  mix(&score, sizeof(score));
+  mix(&lives, sizeof(lives));
+  mix(&gameTime, sizeof(gameTime));
+  mix(&friendCollected, sizeof(friendCollected));
+  mix(&invincible, sizeof(invincible));
+  mix(&speedBoost, sizeof(speedBoost));
+  int counts[3] = {obstacles.size(), collectibles.size(), powerups.size()};
+  mix(counts, sizeof(counts));
+  if (crowd.count > 0)
+  {
+    mix(crowd.x.data(), crowd.count * sizeof(float));
+    mix(crowd.y.data(), crowd.count * sizeof(float));
+  }
+  return hash;
+}
+
+// --- LEVEL FILES ---
+
+const char *levelStoreNames[LEVEL_STORE_COUNT] = {"obstacles", "collectibles", "powerups"};
+
+const float *LevelFile::column(int store, int column) const
+{
+  return (const float *)((const char *)mapping + header->stores[store].columnOffset[column]);
+}
+
+// Checks the header against the real file size; NULL when the level is usable
+const char *validateLevelHeader(const LevelFileHeader &h, size_t fileSize)
+{
+  if (fileSize < sizeof(LevelFileHeader))
+    return "file is shorter than a level header";
+  if (memcmp(h.magic, LEVEL_MAGIC, sizeof(LEVEL_MAGIC)) != 0)
+    return "not an Airport Rush level file";
+  if (h.byteOrder != LEVEL_BYTE_ORDER)
+    return "level was written on a machine with the other byte order";
+  if (h.version != LEVEL_FORMAT_VERSION)
+    return "unsupported level format version";
+  if (h.headerSize != sizeof(LevelFileHeader) || h.fileSize != fileSize)
+    return "header size or file size does not match";
+  for (int st = 0; st < LEVEL_STORE_COUNT; st++)
   {
-    if (i % 2 == 0)
+    const LevelStoreSection &section = h.stores[st];
+    if (section.count > (uint32_t)LEVEL_MAX_ENTITIES)
+      return "too many entities";
+    for (int c = 0; c < LEVEL_COLUMN_COUNT; c++)
     {
-      glVertex2f(i, -5);
-      glVertex2f(i, -1);
+      uint64_t offset = section.columnOffset[c];
+      if (offset % 4 != 0 || offset < sizeof(LevelFileHeader) || offset > fileSize ||
+          (uint64_t)section.count * 4 > fileSize - offset)
+        return "entity column lies outside the file";
     }
-    else
+  }
+  return NULL;
+}
+
+// Rejects NaN, infinite and out-of-range positions and sizes, which the
+// spatial grids would turn into out-of-range cell indices. Runs over the
+// mapped columns once the header is known to be sound.
+const char *validateLevelValues(const LevelFile &level)
+{
+  const LevelFileHeader &h = *level.header;
+  // Written as !(in range) so NaN fails every test
+  if (!(fabsf(h.friendX) <= LEVEL_COORD_LIMIT && fabsf(h.friendY) <= LEVEL_COORD_LIMIT) ||
+      !(h.friendWidth >= 0 && h.friendWidth <= LEVEL_SIZE_LIMIT) ||
+      !(h.friendHeight >= 0 && h.friendHeight <= LEVEL_SIZE_LIMIT))
+    return "friend position or size out of range";
+  const int coordLimit = (int)LEVEL_COORD_LIMIT;
+  float polygonLength = 0;
+  for (int i = 0; i < 4; i++)
+  {
+    for (int c = 0; c < 2; c++)
     {
-      glVertex2f(i, -5);
-      glVertex2f(i, -2);
+      if (h.bezier[i][c] < -coordLimit || h.bezier[i][c] > coordLimit)
+        return "plane path point out of range";
     }
+    if (i > 0)
+      polygonLength += hypotf((float)(h.bezier[i][0] - h.bezier[i - 1][0]), (float)(h.bezier[i][1] - h.bezier[i - 1][1]));
   }
-  glEnd();
+  if (polygonLength > LEVEL_PLANE_PATH_LIMIT)
+    return "plane path too long";
+  for (int st = 0; st < LEVEL_STORE_COUNT; st++)
+  {
+    int count = (int)h.stores[st].count;
+    const float *x = level.column(st, LEVEL_COLUMN_X);
+    const float *y = level.column(st, LEVEL_COLUMN_Y);
+    const float *w = level.column(st, LEVEL_COLUMN_WIDTH);
+    const float *ht = level.column(st, LEVEL_COLUMN_HEIGHT);
+    const float *rotation = level.column(st, LEVEL_COLUMN_ROTATION);
+    for (int i = 0; i < count; i++)
+    {
+      if (!(fabsf(x[i]) <= LEVEL_COORD_LIMIT && fabsf(y[i]) <= LEVEL_COORD_LIMIT))
+        return "entity position out of range";
+      if (!(w[i] >= 0 && w[i] <= LEVEL_SIZE_LIMIT && ht[i] >= 0 && ht[i] <= LEVEL_SIZE_LIMIT))
+        return "entity size out of range";
+      if (!std::isfinite(rotation[i]))
+        return "entity rotation is not finite";
+    }
+  }
+  return NULL;
+}
 
-  glPopMatrix();
+bool mapLevelFile(const char *path, LevelFile &level)
+{
+  memset(&level, 0, sizeof(level));
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+  {
+    printf("ERROR: Could not open level file: %s\n", path);
+    return false;
+  }
+  struct stat st;
+  void *mapping = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && st.st_size > 0)
+    mapping = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED)
+  {
+    printf("ERROR: Could not map level file: %s\n", path);
+    return false;
+  }
+
+  const char *problem = validateLevelHeader(*(const LevelFileHeader *)mapping, (size_t)st.st_size);
+  if (problem)
+  {
+    printf("ERROR: %s: %s\n", problem, path);
+    munmap(mapping, (size_t)st.st_size);
+    return false;
+  }
+  level.header = (const LevelFileHeader *)mapping;
+  level.mapping = mapping;
+  level.mappingSize = (size_t)st.st_size;
+  problem = validateLevelValues(level);
+  if (problem)
+  {
+    printf("ERROR: %s: %s\n", problem, path);
+    unmapLevelFile(level);
+    return false;
+  }
+  return true;
 }
 
-void drawFriend(float x, float y)
+void unmapLevelFile(LevelFile &level)
 {
-  glPushMatrix();
-  glTranslatef(x, y, 0);
+  if (level.mapping)
+    munmap(level.mapping, level.mappingSize);
+  memset(&level, 0, sizeof(level));
+}
 
-  // Headscarf covering head and shoulders
-  glColor3f(1.0f, 1.0f, 1.0f);
-  glBegin(GL_POLYGON);
-  glVertex2f(-8, 12);
-  glVertex2f(8, 12);
-  glVertex2f(10, 2);
-  glVertex2f(8, -2);
-  glVertex2f(-8, -2);
-  glVertex2f(-10, 2);
-  glEnd();
+bool saveLevelFile(const Simulation &s, const char *path)
+{
+  const EntityStore *stores[LEVEL_STORE_COUNT] = {&s.obstacles, &s.collectibles, &s.powerups};
+  const SpatialGrid *grids[LEVEL_STORE_COUNT] = {&s.obstacleGrid, &s.collectibleGrid, &s.powerupGrid};
+
+  LevelFileHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, LEVEL_MAGIC, sizeof(LEVEL_MAGIC));
+  header.version = LEVEL_FORMAT_VERSION;
+  header.byteOrder = LEVEL_BYTE_ORDER;
+  header.headerSize = sizeof(LevelFileHeader);
+  header.friendX = s.friendObj.x;
+  header.friendY = s.friendObj.y;
+  header.friendWidth = s.friendObj.width;
+  header.friendHeight = s.friendObj.height;
+  header.friendActive = s.friendObj.active;
+  const int *bezier[4] = {s.bezierP0, s.bezierP1, s.bezierP2, s.bezierP3};
+  for (int i = 0; i < 4; i++)
+  {
+    header.bezier[i][0] = bezier[i][0];
+    header.bezier[i][1] = bezier[i][1];
+  }
 
-  glColor3f(0.9f, 0.9f, 0.9f);
-  glBegin(GL_POLYGON);
-  glVertex2f(-8, -2);
-  glVertex2f(8, -2);
-  glVertex2f(6, -8);
-  glVertex2f(-6, -8);
-  glEnd();
+  // Columns follow the header back to back; every value is 4 bytes
+  uint64_t offset = sizeof(LevelFileHeader);
+  for (int st = 0; st < LEVEL_STORE_COUNT; st++)
+  {
+    header.stores[st].count = (uint32_t)stores[st]->size();
+    for (int c = 0; c < LEVEL_COLUMN_COUNT; c++)
+    {
+      header.stores[st].columnOffset[c] = offset;
+      offset += (uint64_t)stores[st]->size() * 4;
+    }
+  }
+  header.fileSize = offset;
 
-  // FIXED: White circle outline for hijab opening
-  glColor3f(1.0f, 1.0f, 1.0f);
-  glBegin(GL_POLYGON);
-  for (int i = 0; i < 20; i++)
+  FILE *file = fopen(path, "wb");
+  if (!file)
   {
-    float theta = 2.0f * 3.1415926f * float(i) / 20.0f;
-    glVertex2f(5 * cosf(theta), 8 + 5 * sinf(theta));
+    printf("ERROR: Could not write level file: %s\n", path);
+    return false;
   }
-  glEnd();
+  bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+  for (int st = 0; st < LEVEL_STORE_COUNT && ok; st++)
+  {
+    // Entities go out grouped by grid bucket, so loading fills one bucket at
+    // a time instead of scattering over all of them
+    const EntityStore &store = *stores[st];
+    int n = store.size();
+    const SpatialGrid &grid = *grids[st];
+    std::vector<int> order(n);
+    std::vector<int> bucketOf(n);
+    for (int i = 0; i < n; i++)
+    {
+      order[i] = i;
+      bucketOf[i] = grid.bucketFor(store.x[i], store.y[i]);
+    }
+    std::stable_sort(order.begin(), order.end(), [&bucketOf](int a, int b) { return bucketOf[a] < bucketOf[b]; });
 
-  // FIXED: Skin-toned face inside the white circle
-  glColor3f(0.92f, 0.84f, 0.70f);
-  glBegin(GL_POLYGON);
-  for (int i = 0; i < 20; i++)
+    const std::vector<float> *floatColumns[5] = {&store.x, &store.y, &store.w, &store.h, NULL};
+    std::vector<float> column(n);
+    for (int c = 0; c < LEVEL_COLUMN_COUNT && ok; c++)
+    {
+      for (int i = 0; i < n; i++)
+      {
+        int from = order[i];
+        if (c == LEVEL_COLUMN_TYPE)
+          memcpy(&column[i], &store.type[from], 4);
+        else if (c == LEVEL_COLUMN_ROTATION)
+          column[i] = store.rotation[from];
+        else
+          column[i] = (*floatColumns[c])[from];
+      }
+      ok = fwrite(column.data(), 4, n, file) == (size_t)n;
+    }
+  }
+  ok = fclose(file) == 0 && ok;
+  if (!ok)
   {
-    float theta = 2.0f * 3.1415926f * float(i) / 20.0f;
-    glVertex2f(4 * cosf(theta), 8 + 4 * sinf(theta));
+    printf("ERROR: Could not write level file: %s\n", path);
+    return false;
   }
-  glEnd();
+  printf("DEBUG: Saved level %s: %d guards, %d boarding passes, %d power-ups (%llu bytes)\n", path,
+         s.obstacles.size(), s.collectibles.size(), s.powerups.size(), (unsigned long long)header.fileSize);
+  return true;
+}
 
-  // Body
-  glColor3f(0.3f, 0.4f, 0.6f);
-  glBegin(GL_POLYGON);
-  glVertex2f(-8, 2);
-  glVertex2f(8, 2);
-  glVertex2f(9, -8);
-  glVertex2f(-9, -8);
-  glEnd();
+// Replaces the layout with the file's, from a fresh reset(); the current
+// state is kept if the file does not validate
+bool loadLevelFile(Simulation &s, const char *path)
+{
+  LevelFile level;
+  if (!mapLevelFile(path, level))
+    return false;
+  const LevelFileHeader &header = *level.header;
+
+  s.reset();
+  s.friendObj.x = header.friendX;
+  s.friendObj.y = header.friendY;
+  s.friendObj.width = header.friendWidth;
+  s.friendObj.height = header.friendHeight;
+  s.friendObj.active = header.friendActive != 0;
+  int *bezier[4] = {s.bezierP0, s.bezierP1, s.bezierP2, s.bezierP3};
+  for (int i = 0; i < 4; i++)
+  {
+    bezier[i][0] = header.bezier[i][0];
+    bezier[i][1] = header.bezier[i][1];
+  }
+  s.buildPlanePath();
 
-  glColor3f(0.2f, 0.2f, 0.3f);
-  glBegin(GL_QUADS);
-  glVertex2f(-9, -8);
-  glVertex2f(9, -8);
-  glVertex2f(8, -15);
-  glVertex2f(-8, -15);
-  glEnd();
+  EntityStore *stores[LEVEL_STORE_COUNT] = {&s.obstacles, &s.collectibles, &s.powerups};
+  SpatialGrid *grids[LEVEL_STORE_COUNT] = {&s.obstacleGrid, &s.collectibleGrid, &s.powerupGrid};
+  for (int st = 0; st < LEVEL_STORE_COUNT; st++)
+  {
+    EntityStore &store = *stores[st];
+    int count = (int)header.stores[st].count;
+    store.assign(count, level.column(st, LEVEL_COLUMN_X), level.column(st, LEVEL_COLUMN_Y),
+                 level.column(st, LEVEL_COLUMN_WIDTH), level.column(st, LEVEL_COLUMN_HEIGHT),
+                 (const int *)level.column(st, LEVEL_COLUMN_TYPE), level.column(st, LEVEL_COLUMN_ROTATION));
+    grids[st]->insertAll(count, store.x.data(), store.y.data(), store.w.data(), store.h.data());
+  }
+  unmapLevelFile(level);
 
-  glColor3f(0.4f, 0.4f, 0.4f);
-  glBegin(GL_QUADS);
-  glVertex2f(-12, 0);
-  glVertex2f(-8, 0);
-  glVertex2f(-8, -6);
-  glVertex2f(-12, -6);
-  glEnd();
+  if (s.verbose)
+    printf("DEBUG: Loaded level %s: %d guards, %d boarding passes, %d power-ups\n", path,
+           s.obstacles.size(), s.collectibles.size(), s.powerups.size());
+  return true;
+}
 
-  glColor3f(0.2f, 0.2f, 0.2f);
-  glLineWidth(2);
-  glBegin(GL_LINES);
-  glVertex2f(-10, 0);
-  glVertex2f(-6, 2);
-  glVertex2f(-10, -3);
-  glVertex2f(-6, -1);
-  glEnd();
+// One line per value group; %.9g round-trips every float, so two exports
+// differ exactly where the levels do. textPath "-" writes to stdout.
+bool exportLevelText(const char *path, const char *textPath)
+{
+  LevelFile level;
+  if (!mapLevelFile(path, level))
+    return false;
+  FILE *out = strcmp(textPath, "-") == 0 ? stdout : fopen(textPath, "w");
+  if (!out)
+  {
+    printf("ERROR: Could not write %s\n", textPath);
+    unmapLevelFile(level);
+    return false;
+  }
 
-  glColor3f(0.92f, 0.84f, 0.70f);
-  glBegin(GL_TRIANGLES);
-  glVertex2f(8, 1);
-  glVertex2f(12, 4);
-  glVertex2f(8, -2);
-  glEnd();
+  const LevelFileHeader &h = *level.header;
+  fprintf(out, "airport-rush-level %u\n", h.version);
+  fprintf(out, "friend %.9g %.9g %.9g %.9g %d\n", h.friendX, h.friendY, h.friendWidth, h.friendHeight, h.friendActive);
+  fprintf(out, "bezier %d %d %d %d %d %d %d %d\n", h.bezier[0][0], h.bezier[0][1], h.bezier[1][0],
+          h.bezier[1][1], h.bezier[2][0], h.bezier[2][1], h.bezier[3][0], h.bezier[3][1]);
+  for (int st = 0; st < LEVEL_STORE_COUNT; st++)
+  {
+    uint32_t count = h.stores[st].count;
+    fprintf(out, "%s %u  # x y width height type rotation\n", levelStoreNames[st], count);
+    const float *x = level.column(st, LEVEL_COLUMN_X), *y = level.column(st, LEVEL_COLUMN_Y);
+    const float *w = level.column(st, LEVEL_COLUMN_WIDTH), *hgt = level.column(st, LEVEL_COLUMN_HEIGHT);
+    const int *type = (const int *)level.column(st, LEVEL_COLUMN_TYPE);
+    const float *rotation = level.column(st, LEVEL_COLUMN_ROTATION);
+    for (uint32_t i = 0; i < count; i++)
+    {
+      fprintf(out, "%.9g %.9g %.9g %.9g %d %.9g\n", x[i], y[i], w[i], hgt[i], type[i], rotation[i]);
+    }
+  }
+  bool ok = !ferror(out);
+  if (out != stdout)
+    ok = fclose(out) == 0 && ok;
+  unmapLevelFile(level);
+  return ok;
+}
 
-  // Eyes
-  glColor3f(0.0f, 0.0f, 0.0f);
-  glPointSize(2);
-  glBegin(GL_POINTS);
-  glVertex2f(-2, 9);
-  glVertex2f(2, 9);
-  glEnd();
+// --- HEADLESS RUNNER ---
+// ./airport_rush --headless [ticks] [itemsPerType] [seed]
+// Drives the simulation with a scripted random walk and no window, then reports
+// ticks/sec and a state checksum (identical seeds must give identical checksums).
 
-  glPopMatrix();
+// Small LCG so layouts are the same on every platform (rand() is not)
+unsigned int nextRandom(unsigned int &state)
+{
+  state = state * 1664525u + 1013904223u;
+  return state >> 8;
 }
 
-void drawManagerBadge(float x, float y, float scale)
+// Brute-force check: every kernel built into this binary must agree with
+// checkCollision() on random boxes, including ones that exactly touch.
+bool verifyAabbKernels(unsigned int seed, int boxCount)
 {
-  glPushMatrix();
-  glTranslatef(x, y, 0);
-  glScalef(scale, scale, 1);
+  struct Kernel { const char *name; AabbBatchFn fn; };
+  std::vector<Kernel> kernels = {{"scalar", aabbBatchScalar}};
+#if AABB_KERNEL_X86
+  kernels.push_back({"sse2", aabbBatchSSE2});
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+    kernels.push_back({"avx2", aabbBatchAVX2});
+#elif AABB_KERNEL_NEON
+  kernels.push_back({"neon", aabbBatchNEON});
+#endif
+
+  unsigned int rng = seed;
+  std::vector<float> minX(boxCount), minY(boxCount), maxX(boxCount), maxY(boxCount);
+  std::vector<float> width(boxCount), height(boxCount);
+  for (int i = 0; i < boxCount; i++)
+  {
+    // Integer coordinates on a small range make touching edges common
+    width[i] = 1 + nextRandom(rng) % 24;
+    height[i] = 1 + nextRandom(rng) % 24;
+    minX[i] = (float)(nextRandom(rng) % 200) - width[i] / 2;
+    minY[i] = (float)(nextRandom(rng) % 200) - height[i] / 2;
+    maxX[i] = minX[i] + width[i];
+    maxY[i] = minY[i] + height[i];
+  }
 
-  glColor3f(ROMANIA_YELLOW_R, ROMANIA_YELLOW_G, ROMANIA_YELLOW_B);
-  glBegin(GL_POLYGON);
-  for (int i = 0; i < 6; i++)
+  std::vector<int> expected, actual(boxCount);
+  for (int query = 0; query < 256; query++)
+  {
+    float x = (float)(nextRandom(rng) % 200) - PLAYER_SIZE / 2;
+    float y = (float)(nextRandom(rng) % 200) - PLAYER_SIZE / 2;
+    expected.clear();
+    for (int i = 0; i < boxCount; i++)
+    {
+      if (checkCollision(x, y, PLAYER_SIZE, PLAYER_SIZE, minX[i], minY[i], width[i], height[i]))
+        expected.push_back(i);
+    }
+
+    for (const auto &kernel : kernels)
+    {
+      // Odd start offsets and lengths exercise the unaligned loads and the scalar tails
+      int start = query % 7;
+      int count = boxCount - start - query % 5;
+      int n = kernel.fn(&minX[start], &minY[start], &maxX[start], &maxY[start], count,
+                        x, y, x + PLAYER_SIZE, y + PLAYER_SIZE, actual.data());
+      int e = 0;
+      bool match = true;
+      for (int i : expected)
+      {
+        if (i >= start && i < start + count)
+        {
+          match = match && e < n && actual[e] + start == i;
+          e++;
+        }
+      }
+      if (!match || e != n)
+      {
+        printf("ERROR: AABB kernel %s disagrees with checkCollision() on query %d\n", kernel.name, query);
+        return false;
+      }
+    }
+  }
+
+  printf("HEADLESS: AABB kernels");
+  for (const auto &kernel : kernels)
+    printf(" %s", kernel.name);
+  printf(" match brute force on %d boxes x 256 queries (using %s)\n", boxCount, aabbKernelName);
+  return true;
+}
+
+// A closed Catmull-Rom taxi loop through n random points in the 1000x600 window
+void buildRandomPath(FlightPath &path, int n, unsigned int &rng)
+{
+  std::vector<float> points(2 * n);
+  for (int i = 0; i < n; i++)
+  {
+    points[2 * i] = 50.0f + nextRandom(rng) % 900;
+    points[2 * i + 1] = 50.0f + nextRandom(rng) % 500;
+  }
+  path.build(SPLINE_CATMULL_ROM, points.data(), n, true);
+}
+
+// Runs every path kernel in the binary against the scalar one for a few
+// hundred ticks, wrapping and stopping, with follower counts that leave tails
+bool verifyPathKernels(unsigned int seed, int followers)
+{
+  struct Kernel { const char *name; PathAdvanceFn fn; };
+  std::vector<Kernel> kernels;
+#if AABB_KERNEL_X86
+  kernels.push_back({"sse2", advancePathSSE2});
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+    kernels.push_back({"avx2", advancePathAVX2});
+#elif AABB_KERNEL_NEON
+  kernels.push_back({"neon", advancePathNEON});
+#endif
+
+  unsigned int rng = seed;
+  FlightPath path;
+  buildRandomPath(path, 8, rng);
+  std::vector<float> start(followers), speed(followers);
+  for (int i = 0; i < followers; i++)
+  {
+    start[i] = (nextRandom(rng) % 10000) / 10000.0f * path.length;
+    speed[i] = 20.0f + nextRandom(rng) % 200;
+  }
+
+  for (const auto &kernel : kernels)
+  {
+    for (int wrap = 0; wrap < 2; wrap++)
+    {
+      std::vector<float> d0(start), x0(followers), y0(followers);
+      std::vector<float> d1(start), x1(followers), y1(followers);
+      for (int tick = 0; tick < 300; tick++)
+      {
+        advancePathScalar(path, d0.data(), speed.data(), followers, 1.0f / 60, wrap != 0, x0.data(), y0.data());
+        kernel.fn(path, d1.data(), speed.data(), followers, 1.0f / 60, wrap != 0, x1.data(), y1.data());
+      }
+      for (int i = 0; i < followers; i++)
+      {
+        if (fabsf(d0[i] - d1[i]) > 1e-3f || fabsf(x0[i] - x1[i]) > 1e-3f || fabsf(y0[i] - y1[i]) > 1e-3f)
+        {
+          printf("ERROR: Path kernel %s disagrees with the scalar one on follower %d\n", kernel.name, i);
+          return false;
+        }
+      }
+    }
+  }
+
+  printf("HEADLESS: path kernels scalar");
+  for (const auto &kernel : kernels)
+    printf(" %s", kernel.name);
+  printf(" match on %d followers (using %s)\n", followers, pathKernelName);
+  return true;
+}
+
+void buildRandomLayout(Simulation &s, int itemsPerType, unsigned int &rng, float dt)
+{
+  SimInputs inputs;
+  const DrawingMode modes[4] = {OBSTACLE, COLLECTIBLE, POWERUP1, POWERUP2};
+  for (int i = 0; i < itemsPerType; i++)
+  {
+    for (int m = 0; m < 4; m++)
+    {
+      float x = 50.0f + (nextRandom(rng) % 900);
+      float y = 30.0f + (nextRandom(rng) % 450);
+      inputs.placements.push_back({modes[m], x, y});
+    }
+  }
+  s.step(inputs, dt);
+}
+
+int runHeadless(int ticks, int itemsPerType, unsigned int seed, float tickRate)
+{
+  if (!verifyAabbKernels(seed, 1000))
+    return 1;
+  if (!verifyPathKernels(seed, 1003))
+    return 1;
+
+  Simulation s;
+  s.verbose = false;
+  unsigned int rng = seed;
+  int wins = 0, losses = 0;
+
+  float dt = 1.0f / tickRate;
+  buildRandomLayout(s, itemsPerType, rng, dt);
+  printf("HEADLESS: %d ticks at %.0f Hz, %d guards, %d boarding passes, %d power-ups, seed %u\n",
+         ticks, tickRate, s.obstacles.size(), s.collectibles.size(), s.powerups.size(), seed);
+
+  // Inputs take the same path as in the window: timestamped commands
+  // (on the simulated clock) drained by each tick through held keys
+  InputQueue queue;
+  HeldKeys keys;
+  SimInputs inputs;
+  queue.pushRestart(0);
+  unsigned int heldMoves = moveBit(MOVE_UP);
+  queue.pushMove(INPUT_MOVE_PRESS, MOVE_UP, KEY_SOURCE_LETTER, 0);
+
+  double start = nowSeconds();
+  for (int i = 0; i < ticks; i++)
+  {
+    double tickEnd = (i + 1) * (double)dt;
+
+    // Hold a direction (or a diagonal, or nothing) for a while, like a player would
+    if (nextRandom(rng) % 20 == 0)
+    {
+      unsigned int r = nextRandom(rng);
+      const unsigned int vertical[3] = {0, moveBit(MOVE_UP), moveBit(MOVE_DOWN)};
+      const unsigned int horizontal[3] = {0, moveBit(MOVE_LEFT), moveBit(MOVE_RIGHT)};
+      unsigned int moves = vertical[r % 3] | horizontal[(r / 3) % 3];
+      for (int m = 0; m < MOVE_KEY_COUNT; m++)
+      {
+        if ((heldMoves & ~moves) & moveBit(m))
+          queue.pushMove(INPUT_MOVE_RELEASE, m, KEY_SOURCE_LETTER, tickEnd);
+        if ((moves & ~heldMoves) & moveBit(m))
+          queue.pushMove(INPUT_MOVE_PRESS, m, KEY_SOURCE_LETTER, tickEnd);
+      }
+      heldMoves = moves;
+    }
+
+    queue.drain(tickEnd, keys, inputs);
+    s.step(inputs, dt);
+    inputs.clear();
+
+    if (s.events & SIM_EVENT_WON)
+      wins++;
+    if (s.events & SIM_EVENT_LOST)
+      losses++;
+    if (s.events & SIM_EVENT_RESET)
+      buildRandomLayout(s, itemsPerType, rng, dt);
+    if (s.gameState != RUNNING)
+      queue.pushRestart(tickEnd);
+  }
+  double elapsed = nowSeconds() - start;
+
+  printf("HEADLESS: %.3f s, %.0f ticks/sec, %d wins, %d losses, checksum %08x\n",
+         elapsed, ticks / (elapsed > 0 ? elapsed : 1e-9), wins, losses, s.checksum());
+  return 0;
+}
+
+// Validates in-memory copies of a good level file with one bad value each
+// (INT32_MIN and other out-of-range plane path points, an overlong plane
+// path, NaN and infinite positions, a negative size); every copy must be
+// rejected and the untouched one accepted
+bool verifyLevelValidation(const char *path)
+{
+  LevelFile good;
+  if (!mapLevelFile(path, good))
+    return false;
+  std::vector<uint64_t> storage((good.mappingSize + 7) / 8);
+  memcpy(storage.data(), good.mapping, good.mappingSize);
+  unmapLevelFile(good);
+
+  LevelFileHeader &h = *(LevelFileHeader *)storage.data();
+  LevelFile copy = {&h, storage.data(), storage.size() * 8};
+  float *x = (float *)copy.column(LEVEL_OBSTACLES, LEVEL_COLUMN_X);
+  float *w = (float *)copy.column(LEVEL_OBSTACLES, LEVEL_COLUMN_WIDTH);
+  bool hasObstacle = h.stores[LEVEL_OBSTACLES].count > 0;
+  if (validateLevelValues(copy))
+  {
+    printf("LEVEL: validation rejects the unmodified file: %s\n", validateLevelValues(copy));
+    return false;
+  }
+
+  const int32_t badPoints[] = {INT32_MIN, INT32_MAX, (int32_t)LEVEL_COORD_LIMIT + 1, -(int32_t)LEVEL_COORD_LIMIT - 1};
+  int rejected = 0, crafted = 0;
+  for (int32_t bad : badPoints)
+  {
+    int32_t saved = h.bezier[0][0];
+    h.bezier[0][0] = bad;
+    rejected += validateLevelValues(copy) != NULL;
+    crafted++;
+    h.bezier[0][0] = saved;
+  }
+  int32_t savedPath[4][2];
+  memcpy(savedPath, h.bezier, sizeof(savedPath));
+  for (int i = 0; i < 4; i++)
+    h.bezier[i][0] = i % 2 ? (int32_t)LEVEL_COORD_LIMIT : -(int32_t)LEVEL_COORD_LIMIT;
+  rejected += validateLevelValues(copy) != NULL;
+  crafted++;
+  memcpy(h.bezier, savedPath, sizeof(savedPath));
+
+  float savedFriend = h.friendX;
+  h.friendX = NAN;
+  rejected += validateLevelValues(copy) != NULL;
+  crafted++;
+  h.friendX = savedFriend;
+
+  if (hasObstacle)
+  {
+    const float badValues[] = {NAN, INFINITY, -INFINITY, LEVEL_COORD_LIMIT * 2};
+    for (float bad : badValues)
+    {
+      float saved = x[0];
+      x[0] = bad;
+      rejected += validateLevelValues(copy) != NULL;
+      crafted++;
+      x[0] = saved;
+    }
+    float saved = w[0];
+    w[0] = -1;
+    rejected += validateLevelValues(copy) != NULL;
+    crafted++;
+    w[0] = saved;
+  }
+
+  printf("LEVEL: validation rejected %d of %d crafted files\n", rejected, crafted);
+  return rejected == crafted;
+}
+
+// ./airport_rush --level-bench [entities] [path]
+// Writes a stress layout with the given number of entities spread over the
+// three stores, checks that validation rejects corrupted copies, then times
+// loading it back: mapping plus validation, the column copy into the stores,
+// and the spatial grid rebuild.
+int runLevelBenchmark(int entities, const char *path)
+{
+  Simulation s;
+  s.verbose = false;
+  s.reset();
+  unsigned int rng = 1;
+  // about one entity per 40x40 units, packed closer past the level coordinate limit
+  int side = std::max(1, std::min((int)LEVEL_COORD_LIMIT, (int)sqrtf((float)entities) * 40));
+  for (int i = 0; i < entities; i++)
+  {
+    float x = (float)(nextRandom(rng) % side), y = (float)(nextRandom(rng) % side);
+    switch (i % 3)
+    {
+    case 0:
+      s.obstacleGrid.insert(s.obstacles.add(x, y, 16, 24, 0).slot, x, y, 16, 24);
+      break;
+    case 1:
+      s.collectibleGrid.insert(s.collectibles.add(x, y, 16, 10, 0).slot, x, y, 16, 10);
+      break;
+    default:
+      s.powerupGrid.insert(s.powerups.add(x, y, 20, 20, 1 + (i / 3) % 2).slot, x, y, 20, 20);
+      break;
+    }
+  }
+  unsigned int expected = s.checksum();
+  if (!saveLevelFile(s, path) || !verifyLevelValidation(path))
+    return 1;
+
+  const int runs = 5;
+  std::vector<double> mapTimes, loadTimes;
+  for (int run = 0; run < runs; run++)
+  {
+    double start = nowSeconds();
+    LevelFile level;
+    if (!mapLevelFile(path, level))
+      return 1;
+    mapTimes.push_back(nowSeconds() - start);
+    unmapLevelFile(level);
+
+    Simulation loaded;
+    loaded.verbose = false;
+    start = nowSeconds();
+    if (!loadLevelFile(loaded, path))
+      return 1;
+    loadTimes.push_back(nowSeconds() - start);
+    if (loaded.checksum() != expected)
+    {
+      printf("LEVEL: checksum mismatch after load (%08x, expected %08x)\n", loaded.checksum(), expected);
+      return 1;
+    }
+  }
+  std::sort(mapTimes.begin(), mapTimes.end());
+  std::sort(loadTimes.begin(), loadTimes.end());
+  printf("LEVEL: %d entities, median of %d: map+validate %.3f ms, full load (columns + grids) %.1f ms\n",
+         entities, runs, mapTimes[runs / 2] * 1000.0, loadTimes[runs / 2] * 1000.0);
+  return 0;
+}
+
+// ./airport_rush --crowd-bench [agents] [ticks] [workers]
+// Runs the same game with a crowd on one thread and on the worker pool
+// (default: one worker per extra core), reports the update cost per tick and
+// checks both end in the same state.
+int runCrowdBenchmark(int agents, int ticks, int threads)
+{
+  CrowdWorkers pool;
+  pool.start(threads);
+
+  unsigned int checksums[2];
+  double tickMs[2];
+  for (int run = 0; run < 2; run++)
+  {
+    Simulation s;
+    s.verbose = false;
+    s.crowdSize = agents;
+    s.workers = run == 0 ? NULL : &pool;
+    s.reset();
+    unsigned int rng = 1;
+    buildRandomLayout(s, 20, rng, 1.0f / BASE_TICK_RATE);
+    SimInputs inputs;
+    inputs.restartPressed = true;
+    inputs.moves = moveBit(MOVE_UP);
+    s.step(inputs, 1.0f / BASE_TICK_RATE);
+    inputs.restartPressed = false;
+
+    std::vector<double> times;
+    for (int t = 0; t < ticks && s.gameState == RUNNING; t++)
+    {
+      double start = nowSeconds();
+      s.step(inputs, 1.0f / BASE_TICK_RATE);
+      times.push_back(nowSeconds() - start);
+    }
+    std::sort(times.begin(), times.end());
+    tickMs[run] = times.empty() ? 0 : times[times.size() / 2] * 1000.0;
+    checksums[run] = s.checksum();
+    printf("CROWD: %d agents, %d threads: median tick %.3f ms, p99 %.3f ms (%zu ticks)\n", agents,
+           run == 0 ? 1 : threads + 1, tickMs[run], times.empty() ? 0 : times[times.size() * 99 / 100] * 1000.0,
+           times.size());
+  }
+  pool.stop();
+
+  if (checksums[0] != checksums[1])
+  {
+    printf("CROWD: ERROR threaded update diverged (%08x vs %08x)\n", checksums[0], checksums[1]);
+    return 1;
+  }
+  printf("CROWD: same state on 1 and %d threads (%08x), %.1fx faster\n", threads + 1, checksums[0],
+         tickMs[1] > 0 ? tickMs[0] / tickMs[1] : 0.0);
+  return 0;
+}
+
+// ./airport_rush --path-bench [aircraft] [ticks]
+// Compares how evenly the plane moves when its bezier parameter advances
+// uniformly versus through the arc-length table, then times every path
+// kernel advancing a fleet of aircraft around one taxi loop.
+int runPathBenchmark(int aircraft, int ticks)
+{
+  Simulation s;
+  s.buildPlanePath();
+  const FlightPath &plane = s.planePath;
+  // Distance covered per tick, as the sum of short chords inside the tick so
+  // the turnaround on the curve isn't cut short
+  const int steps = 100; // one lap at bezierSpeed 0.01
+  const int substeps = 16;
+  float uniformMin = 1e30f, uniformMax = 0, tableMin = 1e30f, tableMax = 0;
+  for (int i = 0; i < steps; i++)
+  {
+    float uniformStep = 0, tableStep = 0;
+    float px, py, qx, qy;
+    plane.evaluate((float)i / steps, px, py);
+    plane.positionAt(plane.length * i / steps, qx, qy);
+    for (int k = 1; k <= substeps; k++)
+    {
+      float f = i + (float)k / substeps;
+      float x, y;
+      plane.evaluate(f / steps, x, y);
+      uniformStep += sqrtf((x - px) * (x - px) + (y - py) * (y - py));
+      px = x;
+      py = y;
+      plane.positionAt(plane.length * f / steps, x, y);
+      tableStep += sqrtf((x - qx) * (x - qx) + (y - qy) * (y - qy));
+      qx = x;
+      qy = y;
+    }
+    uniformMin = std::min(uniformMin, uniformStep);
+    uniformMax = std::max(uniformMax, uniformStep);
+    tableMin = std::min(tableMin, tableStep);
+    tableMax = std::max(tableMax, tableStep);
+  }
+  printf("PATH: plane curve %.1f units; distance per tick: uniform t %.2f..%.2f, arc-length table %.2f..%.2f\n",
+         plane.length, uniformMin, uniformMax, tableMin, tableMax);
+
+  unsigned int rng = 1;
+  FlightPath route;
+  buildRandomPath(route, 12, rng);
+  std::vector<float> start(aircraft), speed(aircraft), x(aircraft), y(aircraft);
+  for (int i = 0; i < aircraft; i++)
+  {
+    start[i] = (nextRandom(rng) % 10000) / 10000.0f * route.length;
+    speed[i] = 20.0f + nextRandom(rng) % 200;
+  }
+  printf("PATH: taxi loop of 12 points, %.0f units, %d table entries\n", route.length, route.sampleCount + 1);
+
+  struct Kernel { const char *name; PathAdvanceFn fn; };
+  std::vector<Kernel> kernels = {{"scalar", advancePathScalar}};
+#if AABB_KERNEL_X86
+  kernels.push_back({"sse2", advancePathSSE2});
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+    kernels.push_back({"avx2", advancePathAVX2});
+#elif AABB_KERNEL_NEON
+  kernels.push_back({"neon", advancePathNEON});
+#endif
+  for (const auto &kernel : kernels)
+  {
+    std::vector<float> distance(start);
+    double begin = nowSeconds();
+    for (int t = 0; t < ticks; t++)
+    {
+      kernel.fn(route, distance.data(), speed.data(), aircraft, 1.0f / 60, true, x.data(), y.data());
+    }
+    double elapsed = nowSeconds() - begin;
+    printf("PATH: %-6s %d aircraft x %d ticks: %.2f us/tick, %.2f ns/aircraft\n", kernel.name, aircraft, ticks,
+           elapsed * 1e6 / ticks, elapsed * 1e9 / ((double)ticks * aircraft));
+  }
+  return 0;
+}
+
+// --- INSTANCED ENTITY RENDERING ---
+// Placed guards, boarding passes and power-ups are drawn with one instanced
+// draw call per sprite. Each instance carries x, y, rotation (degrees) and
+// scale. A GLSL 1.20 vertex shader applies them, matching the old per-entity
+// translate/rotate/scale. The CLJ-MUC and VIP labels are instanced the same
+// way from glyph atlas quads. Only their anchor point is rotated/scaled, so
+// they stay upright like bitmap text. Without ARB_instanced_arrays +
+// ARB_draw_instanced (or if a shader fails), display() falls back to the
+// per-entity loops.
+
+struct SpriteInstance
+{
+  float x, y;
+  float rotation;
+  float scale;
+};
+
+const GLuint ATTRIB_POSITION = 0; // sprites: vertex, labels: anchor
+const GLuint ATTRIB_COLOR = 1;    // sprites: color, labels: glyph offset
+const GLuint ATTRIB_INSTANCE = 2;
+const GLuint ATTRIB_TEXCOORD = 3; // labels only
+
+struct LabelVertex
+{
+  float anchorX, anchorY;
+  float offsetX, offsetY;
+  float u, v;
+};
+
+enum LabelId
+{
+  LABEL_BOARDING_PASS,
+  LABEL_MANAGER_BADGE,
+  LABEL_COUNT
+};
+
+bool instancingAvailable = false;
+GLuint instanceProgram = 0;
+GLuint instanceVBO = 0;
+std::vector<SpriteInstance> instanceData;
+
+GLuint labelProgram = 0; // 0 when labels fall back to drawText() per entity
+GLuint labelVBO = 0;
+SpriteRange labelRanges[LABEL_COUNT];
+AtlasId labelAtlas[LABEL_COUNT] = {ATLAS_HELVETICA_10, ATLAS_HELVETICA_12};
+GLint labelColorUniform = -1;
+
+const char *instanceVertexShader =
+    "#version 120\n"
+    "attribute vec2 position;\n"
+    "attribute vec3 color;\n"
+    "attribute vec4 instance; // x, y, rotation, scale\n"
+    "varying vec3 vColor;\n"
+    "void main()\n"
+    "{\n"
+    "  float a = radians(instance.z);\n"
+    "  vec2 p = position * instance.w;\n"
+    "  p = vec2(p.x * cos(a) - p.y * sin(a), p.x * sin(a) + p.y * cos(a));\n"
+    "  gl_Position = gl_ModelViewProjectionMatrix * vec4(p + instance.xy, 0.0, 1.0);\n"
+    "  vColor = color;\n"
+    "}\n";
+
+const char *instanceFragmentShader =
+    "#version 120\n"
+    "varying vec3 vColor;\n"
+    "void main()\n"
+    "{\n"
+    "  gl_FragColor = vec4(vColor, 1.0);\n"
+    "}\n";
+
+const char *labelVertexShader =
+    "#version 120\n"
+    "attribute vec2 anchor;\n"
+    "attribute vec2 offset;\n"
+    "attribute vec4 instance; // x, y, rotation, scale\n"
+    "attribute vec2 texcoord;\n"
+    "varying vec2 vTexcoord;\n"
+    "void main()\n"
+    "{\n"
+    "  float a = radians(instance.z);\n"
+    "  vec2 p = anchor * instance.w;\n"
+    "  p = vec2(p.x * cos(a) - p.y * sin(a), p.x * sin(a) + p.y * cos(a));\n"
+    "  gl_Position = gl_ModelViewProjectionMatrix * vec4(instance.xy + p + offset, 0.0, 1.0);\n"
+    "  vTexcoord = texcoord;\n"
+    "}\n";
+
+const char *labelFragmentShader =
+    "#version 120\n"
+    "uniform sampler2D atlas;\n"
+    "uniform vec3 color;\n"
+    "varying vec2 vTexcoord;\n"
+    "void main()\n"
+    "{\n"
+    "  vec4 glyph = texture2D(atlas, vTexcoord);\n"
+    "  if (glyph.a < 0.5)\n"
+    "    discard;\n"
+    "  gl_FragColor = vec4(color * glyph.rgb, 1.0);\n"
+    "}\n";
+
+GLuint compileShader(GLenum type, const char *source)
+{
+  GLuint shader = glCreateShader(type);
+  glShaderSource(shader, 1, &source, NULL);
+  glCompileShader(shader);
+
+  GLint ok = 0;
+  glGetShaderiv(shader, GL_COMPILE_STATUS, &ok);
+  if (!ok)
+  {
+    char log[1024];
+    glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+    printf("ERROR: Shader compile failed: %s\n", log);
+    glDeleteShader(shader);
+    return 0;
+  }
+  return shader;
+}
+
+// Attribute i of attribNames is bound to location i; returns 0 on failure
+GLuint buildProgram(const char *vertexSource, const char *fragmentSource,
+                    const char **attribNames, int attribCount)
+{
+  GLuint vs = compileShader(GL_VERTEX_SHADER, vertexSource);
+  GLuint fs = compileShader(GL_FRAGMENT_SHADER, fragmentSource);
+  if (!vs || !fs)
   {
-    float theta = 2.0f * 3.1415926f * float(i) / 6.0f;
-    glVertex2f(10 * cosf(theta), 10 * sinf(theta));
+    glDeleteShader(vs);
+    glDeleteShader(fs);
+    return 0;
   }
-  glEnd();
 
-  glColor3f(ROMANIA_BLUE_R, ROMANIA_BLUE_G, ROMANIA_BLUE_B);
-  glBegin(GL_POLYGON);
-  for (int i = 0; i < 20; i++)
+  GLuint program = glCreateProgram();
+  glAttachShader(program, vs);
+  glAttachShader(program, fs);
+  for (int i = 0; i < attribCount; i++)
   {
-    float theta = 2.0f * 3.1415926f * float(i) / 20.0f;
-    glVertex2f(7 * cosf(theta), 7 * sinf(theta));
+    glBindAttribLocation(program, i, attribNames[i]);
   }
-  glEnd();
+  glLinkProgram(program);
+  glDeleteShader(vs);
+  glDeleteShader(fs);
 
-  glColor3f(1.0f, 1.0f, 1.0f);
-  glRasterPos2f(-6, -2);
-  char vipText[] = "VIP";
-  for (int i = 0; i < 3; i++)
+  GLint ok = 0;
+  glGetProgramiv(program, GL_LINK_STATUS, &ok);
+  if (!ok)
   {
-    glutBitmapCharacter(GLUT_BITMAP_HELVETICA_12, vipText[i]);
+    char log[1024];
+    glGetProgramInfoLog(program, sizeof(log), NULL, log);
+    printf("ERROR: Shader link failed: %s\n", log);
+    glDeleteProgram(program);
+    return 0;
   }
+  return program;
+}
 
-  glColor3f(0.0f, 0.0f, 0.0f);
-  glLineWidth(2);
-  glBegin(GL_LINE_LOOP);
-  for (int i = 0; i < 6; i++)
+// Label quads in the glyph atlas, positioned like the bitmap labels were
+void initLabelGeometry()
+{
+  if (!glyphAtlasReady)
+    return;
+
+  const char *attribs[] = {"anchor", "offset", "instance", "texcoord"};
+  labelProgram = buildProgram(labelVertexShader, labelFragmentShader, attribs, 4);
+  if (!labelProgram)
+    return;
+  glUseProgram(labelProgram);
+  glUniform1i(glGetUniformLocation(labelProgram, "atlas"), 0);
+  labelColorUniform = glGetUniformLocation(labelProgram, "color");
+  glUseProgram(0);
+
+  struct LabelSpec { const char *text; float anchorX, anchorY; };
+  const LabelSpec specs[LABEL_COUNT] = {{"CLJ-MUC", -8, 3}, {"VIP", -6, -2}};
+
+  std::vector<LabelVertex> vertices;
+  for (int id = 0; id < LABEL_COUNT; id++)
   {
-    float theta = 2.0f * 3.1415926f * float(i) / 6.0f;
-    glVertex2f(10 * cosf(theta), 10 * sinf(theta));
+    const TextLayout &layout = layoutText(labelAtlas[id], specs[id].text);
+    labelRanges[id].first = (int)vertices.size();
+    // Layout quads are GL_QUADS order, split into two triangles each
+    const int corners[6] = {0, 1, 2, 0, 2, 3};
+    for (size_t q = 0; q + 16 <= layout.vertices.size(); q += 16)
+    {
+      for (int corner : corners)
+      {
+        const float *v = &layout.vertices[q + corner * 4];
+        vertices.push_back({specs[id].anchorX, specs[id].anchorY, v[0], v[1], v[2], v[3]});
+      }
+    }
+    labelRanges[id].count = (int)vertices.size() - labelRanges[id].first;
   }
-  glEnd();
 
-  glPopMatrix();
+  glGenBuffers(1, &labelVBO);
+  glBindBuffer(GL_ARRAY_BUFFER, labelVBO);
+  glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(LabelVertex), vertices.data(), GL_STATIC_DRAW);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
-void drawFastTrackPass(float x, float y, float scale)
+void initInstancedRendering()
 {
-  glPushMatrix();
-  glTranslatef(x, y, 0);
-  glScalef(scale, scale, 1);
-
-  float stripWidth = 6.6f;
+  instancingAvailable = false;
+  if (getenv("AIRPORT_RUSH_NO_INSTANCING"))
+  {
+    printf("INFO: Instanced rendering disabled by AIRPORT_RUSH_NO_INSTANCING\n");
+    return;
+  }
+  if (!spriteVBO || !hasGLExtension("GL_ARB_instanced_arrays") || !hasGLExtension("GL_ARB_draw_instanced"))
+  {
+    printf("INFO: Instanced rendering not supported - drawing entities one by one\n");
+    return;
+  }
 
-  glColor3f(ROMANIA_RED_R, ROMANIA_RED_G, ROMANIA_RED_B);
-  glBegin(GL_QUADS);
-  glVertex2f(-10, -6);
-  glVertex2f(-10 + stripWidth, -6);
-  glVertex2f(-10 + stripWidth, 6);
-  glVertex2f(-10, 6);
-  glEnd();
+  const char *attribs[] = {"position", "color", "instance"};
+  instanceProgram = buildProgram(instanceVertexShader, instanceFragmentShader, attribs, 3);
+  if (!instanceProgram)
+    return;
 
-  glColor3f(ROMANIA_YELLOW_R, ROMANIA_YELLOW_G, ROMANIA_YELLOW_B);
-  glBegin(GL_QUADS);
-  glVertex2f(-10 + stripWidth, -6);
-  glVertex2f(-10 + 2 * stripWidth, -6);
-  glVertex2f(-10 + 2 * stripWidth, 6);
-  glVertex2f(-10 + stripWidth, 6);
-  glEnd();
+  glGenBuffers(1, &instanceVBO);
+  initLabelGeometry();
+  instancingAvailable = true;
+  printf("DEBUG: Instanced rendering enabled (labels %s)\n", labelProgram ? "instanced" : "per entity");
+}
 
-  glColor3f(ROMANIA_BLUE_R, ROMANIA_BLUE_G, ROMANIA_BLUE_B);
-  glBegin(GL_QUADS);
-  glVertex2f(-10 + 2 * stripWidth, -6);
-  glVertex2f(10, -6);
-  glVertex2f(10, 6);
-  glVertex2f(-10 + 2 * stripWidth, 6);
-  glEnd();
+void bindInstanceRange(int firstInstance)
+{
+  glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+  glVertexAttribPointer(ATTRIB_INSTANCE, 4, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance),
+                        (const void *)(firstInstance * sizeof(SpriteInstance)));
+}
 
-  glColor3f(1.0f, 1.0f, 1.0f);
-  glBegin(GL_TRIANGLES);
-  glVertex2f(-6, 0);
-  glVertex2f(-2, 3);
-  glVertex2f(-2, -3);
+// Draws instanceData[firstInstance, firstInstance + count) of one sprite.
+// The instance buffer must already hold this frame's instanceData.
+void drawSpriteInstanced(SpriteId id, int firstInstance, int count)
+{
+  if (count == 0)
+    return;
 
-  glVertex2f(0, 0);
-  glVertex2f(4, 3);
-  glVertex2f(4, -3);
+  bindInstanceRange(firstInstance);
+  glDrawArraysInstancedARB(GL_TRIANGLES, spriteRange(id).first, spriteRange(id).count, count);
+}
 
-  glVertex2f(6, 0);
-  glVertex2f(10, 3);
-  glVertex2f(10, -3);
-  glEnd();
+void drawLabelInstanced(LabelId id, int firstInstance, int count, float r, float g, float b)
+{
+  if (count == 0)
+    return;
 
-  glPopMatrix();
+  glBindTexture(GL_TEXTURE_2D, glyphAtlases[labelAtlas[id]].texture);
+  glUniform3f(labelColorUniform, r, g, b);
+  bindInstanceRange(firstInstance);
+  glDrawArraysInstancedARB(GL_TRIANGLES, labelRanges[id].first, labelRanges[id].count, count);
 }
 
-void drawStressIndicator(float x, float y, bool filled)
+// Dense indices (in store order) of the active entities the view can show,
+// found through the store's grid instead of a walk over every entity. The
+// rest count as culled.
+std::vector<int> cullHits; // scratch slots from the grid
+
+void collectVisible(const EntityStore &store, const SpatialGrid &grid, const ViewRect &view,
+                    std::vector<int> &visible)
 {
-  glPushMatrix();
-  glTranslatef(x, y, 0);
+  visible.clear();
+  cullHits.clear();
+  grid.queryRegion(view.left - ENTITY_CULL_MARGIN, view.bottom - ENTITY_CULL_MARGIN,
+                   view.right - view.left + 2 * ENTITY_CULL_MARGIN, view.top - view.bottom + 2 * ENTITY_CULL_MARGIN,
+                   cullHits);
+  for (int slot : cullHits)
+  {
+    int i = store.indexOfSlot(slot);
+    if (store.isActive(i))
+      visible.push_back(i);
+  }
+  std::sort(visible.begin(), visible.end());
+  profiler.countEntities((int)visible.size(), store.activeCount() - (int)visible.size());
+}
 
-  glColor3f(0.4f, 0.3f, 0.2f);
-  glBegin(GL_QUADS);
-  glVertex2f(-10, -7);
-  glVertex2f(10, -7);
-  glVertex2f(10, 7);
-  glVertex2f(-10, 7);
-  glEnd();
+std::vector<int> visibleObstacles, visibleCollectibles, visiblePowerups;
 
-  if (filled)
+void drawPlacedEntitiesInstanced(const Simulation &s)
+{
+  const EntityStore &obstacles = s.obstacles;
+  const EntityStore &collectibles = s.collectibles;
+  const EntityStore &powerups = s.powerups;
+
+  // Group instances per sprite: guards, boarding passes, badges, fast tracks
+  instanceData.clear();
+  int guardStart = 0;
+  for (int i : visibleObstacles)
   {
-    glColor3f(ROMANIA_RED_R, ROMANIA_RED_G, ROMANIA_RED_B);
+    instanceData.push_back({obstacles.x[i], obstacles.y[i], 0, 1});
   }
-  else
+  int passStart = (int)instanceData.size();
+  for (int i : visibleCollectibles)
   {
-    glColor3f(0.3f, 0.3f, 0.3f);
+    instanceData.push_back({collectibles.x[i], collectibles.y[i], collectibles.rotation[i], 1});
   }
-  glBegin(GL_QUADS);
-  glVertex2f(-8, -5);
-  glVertex2f(8, -5);
-  glVertex2f(8, 5);
-  glVertex2f(-8, 5);
-  glEnd();
-
-  glColor3f(0.2f, 0.2f, 0.2f);
-  glLineWidth(3);
-  glBegin(GL_LINE_STRIP);
-  glVertex2f(-5, 7);
-  glVertex2f(-5, 10);
-  glVertex2f(5, 10);
-  glVertex2f(5, 7);
-  glEnd();
+  int badgeStart = (int)instanceData.size();
+  for (int i : visiblePowerups)
+  {
+    if (powerups.type[i] == 1)
+      instanceData.push_back({powerups.x[i], powerups.y[i], 0, powerups.animScale[i]});
+  }
+  int fastTrackStart = (int)instanceData.size();
+  for (int i : visiblePowerups)
+  {
+    if (powerups.type[i] != 1)
+      instanceData.push_back({powerups.x[i], powerups.y[i], 0, powerups.animScale[i]});
+  }
+  int end = (int)instanceData.size();
+  if (end == 0)
+    return;
 
-  glPopMatrix();
-}
+  glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+  glBufferData(GL_ARRAY_BUFFER, end * sizeof(SpriteInstance), instanceData.data(), GL_STREAM_DRAW);
+
+  glUseProgram(instanceProgram);
+  glBindBuffer(GL_ARRAY_BUFFER, spriteVBO);
+  glEnableVertexAttribArray(ATTRIB_POSITION);
+  glEnableVertexAttribArray(ATTRIB_COLOR);
+  glEnableVertexAttribArray(ATTRIB_INSTANCE);
+  glVertexAttribPointer(ATTRIB_POSITION, 2, GL_FLOAT, GL_FALSE, sizeof(SpriteVertex),
+                        (const void *)offsetof(SpriteVertex, x));
+  glVertexAttribPointer(ATTRIB_COLOR, 3, GL_FLOAT, GL_FALSE, sizeof(SpriteVertex),
+                        (const void *)offsetof(SpriteVertex, r));
+  glVertexAttribDivisorARB(ATTRIB_INSTANCE, 1);
+
+  drawSpriteInstanced(SPRITE_GUARD, guardStart, passStart - guardStart);
+  drawSpriteInstanced(SPRITE_BOARDING_PASS, passStart, badgeStart - passStart);
+  drawSpriteInstanced(SPRITE_MANAGER_BADGE, badgeStart, fastTrackStart - badgeStart);
+  drawSpriteInstanced(SPRITE_FAST_TRACK, fastTrackStart, end - fastTrackStart);
+
+  // Labels are unreadable at low zoom and are skipped entirely
+  if (labelProgram && !lowDetailSprites)
+  {
+    glUseProgram(labelProgram);
+    glBindBuffer(GL_ARRAY_BUFFER, labelVBO);
+    glEnableVertexAttribArray(ATTRIB_TEXCOORD);
+    glVertexAttribPointer(ATTRIB_POSITION, 2, GL_FLOAT, GL_FALSE, sizeof(LabelVertex),
+                          (const void *)offsetof(LabelVertex, anchorX));
+    glVertexAttribPointer(ATTRIB_COLOR, 2, GL_FLOAT, GL_FALSE, sizeof(LabelVertex),
+                          (const void *)offsetof(LabelVertex, offsetX));
+    glVertexAttribPointer(ATTRIB_TEXCOORD, 2, GL_FLOAT, GL_FALSE, sizeof(LabelVertex),
+                          (const void *)offsetof(LabelVertex, u));
+
+    drawLabelInstanced(LABEL_BOARDING_PASS, passStart, badgeStart - passStart, 0.0f, 0.0f, 0.0f);
+    drawLabelInstanced(LABEL_MANAGER_BADGE, badgeStart, fastTrackStart - badgeStart, 1.0f, 1.0f, 1.0f);
+
+    glDisableVertexAttribArray(ATTRIB_TEXCOORD);
+    glBindTexture(GL_TEXTURE_2D, 0);
+  }
 
-// --- AUDIO FUNCTION IMPLEMENTATIONS ---
+  glVertexAttribDivisorARB(ATTRIB_INSTANCE, 0);
+  glDisableVertexAttribArray(ATTRIB_INSTANCE);
+  glDisableVertexAttribArray(ATTRIB_COLOR);
+  glDisableVertexAttribArray(ATTRIB_POSITION);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glUseProgram(0);
 
-void* playBackgroundMusic(void* arg) {
-    if (!backgroundMusicAvailable) {
-        printf("DEBUG: Background music not available - running silently\n");
-        backgroundMusicPlaying = true;
-        
-        // Wait for stop signal without playing anything
-        while (!shouldStopBackgroundMusic) {
-            usleep(100000); // Check every 100ms
-        }
-        
-        backgroundMusicPlaying = false;
-        return NULL;
+  if (!labelProgram && !lowDetailSprites)
+  {
+    for (int i = passStart; i < badgeStart; i++)
+    {
+      drawBoardingPassLabel(instanceData[i].x, instanceData[i].y, instanceData[i].rotation);
     }
-    
-    // Play Show Me Love - WizTheMc (background music, no loop)
-    system("afplay \"assets/sounds/Show Me Love - WizTheMc.mp3\" &");
-    backgroundMusicPlaying = true;
-    
-    // Wait for music to finish or stop signal
-    while (!shouldStopBackgroundMusic) {
-        usleep(100000); // Check every 100ms
+    for (int i = badgeStart; i < fastTrackStart; i++)
+    {
+      drawManagerBadgeLabel(instanceData[i].x, instanceData[i].y, instanceData[i].scale);
     }
-    
-    backgroundMusicPlaying = false;
-    return NULL;
+  }
 }
 
-void* playWinMusic(void* arg) {
-    winMusicPlaying = true;
-    
-    if (!winMusicAvailable) {
-        printf("DEBUG: Win music not available - running silently\n");
-        
-        // Wait for stop signal without playing anything
-        while (!shouldStopWinMusic) {
-            usleep(100000); // Check every 100ms
-        }
-        
-        winMusicPlaying = false;
-        return NULL;
+// Draws the crowd between the last two ticks, one instanced call for every
+// visible agent. An agent that jumped further than CROWD_RESPAWN_JUMP boarded
+// and respawned, so it is drawn where it is now instead of sliding across
+// the map.
+void drawCrowd(const Simulation &s, const ViewRect &view, float alpha)
+{
+  const Crowd &crowd = s.crowd;
+  const float CROWD_RESPAWN_JUMP = 20.0f;
+  instanceData.clear();
+  for (int i = 0; i < crowd.count; i++)
+  {
+    float x = crowd.x[i], y = crowd.y[i];
+    if (fabsf(x - crowd.prevX[i]) < CROWD_RESPAWN_JUMP && fabsf(y - crowd.prevY[i]) < CROWD_RESPAWN_JUMP)
+    {
+      x = lerp(crowd.prevX[i], x, alpha);
+      y = lerp(crowd.prevY[i], y, alpha);
     }
-    
-    // Play The Stranglers - Golden Brown (win music, infinite loop)
-    // Start the first song in background for immediate playback
-    system("afplay \"assets/sounds/The Stranglers - Golden Brown.mp3\" &");
-    
-    // Wait for the first song to finish (approximately 3 minutes)
-    // This allows takeoff sound to play in parallel during first playback
-    usleep(1800000); // 3 minutes in microseconds
-    
-    // Kill any remaining background processes to prevent conflicts
-    system("pkill -f 'The Stranglers - Golden Brown.mp3'");
-    
-    // Small delay to ensure cleanup
-    usleep(100000); // 0.1 second delay
-    
-    // Keep playing in loop until stop signal
-    while (!shouldStopWinMusic) {
-        // Play the song and wait for it to complete (blocking)
-        // This ensures proper looping without conflicts
-        system("afplay \"assets/sounds/The Stranglers - Golden Brown.mp3\"");
-        
-        // Small delay between loops to prevent rapid restarting
-        usleep(100000); // 0.1 second delay
+    if (pointInView(view, x, y, CROWD_RADIUS))
+      instanceData.push_back({x, y, atan2f(crowd.vy[i], crowd.vx[i]) * 180.0f / 3.1415926f, 1});
+  }
+  int visible = (int)instanceData.size();
+  profiler.countEntities(visible, crowd.count - visible);
+  if (visible == 0)
+    return;
+
+  if (!instancingAvailable)
+  {
+    for (const SpriteInstance &agent : instanceData)
+    {
+      glPushMatrix();
+      glTranslatef(agent.x, agent.y, 0);
+      glRotatef(agent.rotation, 0, 0, 1);
+      drawSprite(SPRITE_TRAVELER);
+      glPopMatrix();
     }
-    
-    winMusicPlaying = false;
-    return NULL;
+    return;
+  }
+
+  glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+  glBufferData(GL_ARRAY_BUFFER, visible * sizeof(SpriteInstance), instanceData.data(), GL_STREAM_DRAW);
+
+  glUseProgram(instanceProgram);
+  glBindBuffer(GL_ARRAY_BUFFER, spriteVBO);
+  glEnableVertexAttribArray(ATTRIB_POSITION);
+  glEnableVertexAttribArray(ATTRIB_COLOR);
+  glEnableVertexAttribArray(ATTRIB_INSTANCE);
+  glVertexAttribPointer(ATTRIB_POSITION, 2, GL_FLOAT, GL_FALSE, sizeof(SpriteVertex),
+                        (const void *)offsetof(SpriteVertex, x));
+  glVertexAttribPointer(ATTRIB_COLOR, 3, GL_FLOAT, GL_FALSE, sizeof(SpriteVertex),
+                        (const void *)offsetof(SpriteVertex, r));
+  glVertexAttribDivisorARB(ATTRIB_INSTANCE, 1);
+
+  drawSpriteInstanced(SPRITE_TRAVELER, 0, visible);
+
+  glVertexAttribDivisorARB(ATTRIB_INSTANCE, 0);
+  glDisableVertexAttribArray(ATTRIB_INSTANCE);
+  glDisableVertexAttribArray(ATTRIB_COLOR);
+  glDisableVertexAttribArray(ATTRIB_POSITION);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glUseProgram(0);
 }
 
-void* playLoseMusic(void* arg) {
-    loseMusicPlaying = true;
-    
-    if (!loseMusicAvailable) {
-        printf("DEBUG: Lose music not available - running silently\n");
-        
-        // Wait for stop signal without playing anything
-        while (!shouldStopLoseMusic) {
-            usleep(100000); // Check every 100ms
-        }
-        
-        loseMusicPlaying = false;
-        return NULL;
+// Draws the guards, boarding passes and power-ups inside the view
+void drawPlacedEntities(const Simulation &s, const ViewRect &view)
+{
+  collectVisible(s.obstacles, s.obstacleGrid, view, visibleObstacles);
+  collectVisible(s.collectibles, s.collectibleGrid, view, visibleCollectibles);
+  collectVisible(s.powerups, s.powerupGrid, view, visiblePowerups);
+
+  if (instancingAvailable)
+  {
+    drawPlacedEntitiesInstanced(s);
+    return;
+  }
+
+  const EntityStore &obstacles = s.obstacles;
+  for (int i : visibleObstacles)
+  {
+    drawGuard(obstacles.x[i], obstacles.y[i]);
+  }
+
+  const EntityStore &collectibles = s.collectibles;
+  for (int i : visibleCollectibles)
+  {
+    drawBoardingPass(collectibles.x[i], collectibles.y[i], collectibles.rotation[i]);
+  }
+
+  const EntityStore &powerups = s.powerups;
+  for (int i : visiblePowerups)
+  {
+    if (powerups.type[i] == 1)
+    {
+      drawManagerBadge(powerups.x[i], powerups.y[i], powerups.animScale[i]);
     }
-    
-    // Play Brazilian Phonk Remix - SoundSorcerer (lose music, infinite loop)
-    // Keep playing in loop until stop signal
-    while (!shouldStopLoseMusic) {
-        system("afplay \"assets/sounds/Brazilian Phonk Remix - SoundSorcerer.mp3\"");
-        usleep(100000); // Small delay between loops
+    else
+    {
+      drawFastTrackPass(powerups.x[i], powerups.y[i], powerups.animScale[i]);
     }
-    
-    loseMusicPlaying = false;
-    return NULL;
+  }
 }
 
-void* playTakeoffSound(void* arg) {
-    takeoffSoundPlaying = true;
-    
-    if (!takeoffSoundAvailable) {
-        printf("DEBUG: Takeoff sound not available - running silently\n");
-        
-        // Wait a short time to simulate sound duration
-        usleep(2000000); // 2 seconds
-        
-        takeoffSoundPlaying = false;
-        return NULL;
-    }
-    
-    // Play IndiGo-TakeOff-AirBus-320.mp3 (takeoff sound, play once)
-    // Play the takeoff sound once and wait for it to complete
-    system("afplay \"assets/sounds/IndiGo-TakeOff-AirBus-320.mp3\"");
-    
-    // Sound finished playing
-    takeoffSoundPlaying = false;
-    return NULL;
-}
+// --- FIXED TIMESTEP ---
+// The simulation ticks at a fixed rate against the real clock, independent of
+// how often frames are drawn. Real frame time goes into an accumulator and
+// whole ticks are taken out of it. A long stall is clamped to MAX_FRAME_SECONDS
+// so a slow frame can't snowball into ever more ticks (spiral of death). The
+// remainder, as a fraction of a tick, interpolates the rendered positions.
 
-void startBackgroundMusic() {
-    if (!backgroundMusicPlaying) {
-        shouldStopBackgroundMusic = false;
-        pthread_create(&backgroundMusicThread, NULL, playBackgroundMusic, NULL);
-    }
-}
+const double MAX_FRAME_SECONDS = 0.25;
 
-void startWinMusic() {
-    if (!winMusicPlaying) {
-        shouldStopWinMusic = false;
-        pthread_create(&winMusicThread, NULL, playWinMusic, NULL);
-    }
-}
+struct FixedTimestep
+{
+  float tickRate = BASE_TICK_RATE; // ticks per second, --tick-rate
+  double accumulator = 0;
+  double lastTime = -1;
+  float alpha = 0; // accumulator / tick, in [0, 1)
+  long clampedFrames = 0;
+
+  float tickSeconds() const;
+  int advance(double now);
+  double tickEndTime(int index, int ticks) const;
+};
 
-void startLoseMusic() {
-    if (!loseMusicPlaying) {
-        shouldStopLoseMusic = false;
-        pthread_create(&loseMusicThread, NULL, playLoseMusic, NULL);
-    }
-}
+FixedTimestep fixedStep;
 
-void startTakeoffSound() {
-    if (!takeoffSoundPlaying) {
-        shouldStopTakeoffSound = false;
-        pthread_create(&takeoffSoundThread, NULL, playTakeoffSound, NULL);
-    }
+float lerp(float a, float b, float t)
+{
+  return a + (b - a) * t;
 }
 
-void stopBackgroundMusic() {
-    if (backgroundMusicPlaying) {
-        shouldStopBackgroundMusic = true;
-        system("pkill -f 'Show Me Love - WizTheMc.mp3'");
-        pthread_join(backgroundMusicThread, NULL);
-    }
-}
+// --- FRAME PACING ---
+// The window is double-buffered by default. display() swaps and immediately
+// posts the next redisplay, so frames are paced by the swap interval (vsync)
+// rather than by the 16 ms simulation timer. Every presented frame is timed;
+// min/avg/p99 over the last FRAME_HISTORY frames and the number of missed
+// vblanks are reported every FRAME_REPORT_INTERVAL frames and on exit.
+// --benchmark [seconds] turns vsync off, runs the current scene uncapped and
+// exits with the true frames per second.
 
-void stopWinMusic() {
-    if (winMusicPlaying) {
-        shouldStopWinMusic = true;
-        system("pkill -f 'The Stranglers - Golden Brown.mp3'");
-        pthread_join(winMusicThread, NULL);
-    }
-}
+const int FRAME_HISTORY = 600;
+const int FRAME_REPORT_INTERVAL = 600;
 
-void stopLoseMusic() {
-    if (loseMusicPlaying) {
-        shouldStopLoseMusic = true;
-        system("pkill -f 'Brazilian Phonk Remix - SoundSorcerer.mp3'");
-        pthread_join(loseMusicThread, NULL);
-    }
-}
+struct FramePacing
+{
+  bool doubleBuffered = true;
+  int swapInterval = 1;
+  bool swapIntervalApplied = false;
+  float refreshHz = 60.0f;
+  double benchmarkSeconds = 0; // > 0: uncapped run that exits after this long
+
+  double startTime = 0;
+  double lastPresent = 0;
+  std::vector<float> frameMs; // ring of the last FRAME_HISTORY frame times
+  int nextSample = 0;
+  long frames = 0;
+  long missedVblanks = 0;
+  const char *exitLabel = "FRAMES"; // the final report, printed once by reportFramePacingAtExit()
+
+  void start();
+  void recordPresent();
+  void report(const char *label) const;
+};
 
-void stopTakeoffSound() {
-    if (takeoffSoundPlaying) {
-        shouldStopTakeoffSound = true;
-        system("pkill -f 'IndiGo-TakeOff-AirBus-320.mp3'");
-        pthread_join(takeoffSoundThread, NULL);
-    }
-}
+FramePacing framePacing;
 
-void cleanupAudio() {
-    stopBackgroundMusic();
-    stopWinMusic();
-    stopLoseMusic();
-    stopTakeoffSound();
+#ifndef __APPLE__
+bool hasGLXExtension(const char *name)
+{
+  Display *display = glXGetCurrentDisplay();
+  if (!display)
+    return false;
+  return extensionListHas(glXQueryExtensionsString(display, DefaultScreen(display)), name);
 }
+#endif
 
-bool checkAudioAssets() {
-    printf("DEBUG: Checking audio assets availability...\n");
-    
-    // Check if assets directory exists
-    FILE* testFile = fopen("assets/sounds/Show Me Love - WizTheMc.mp3", "rb");
-    if (testFile) {
-        fclose(testFile);
-        backgroundMusicAvailable = true;
-        printf("DEBUG: Background music available\n");
-    } else {
-        backgroundMusicAvailable = false;
-        printf("WARNING: Background music not available - will run silently\n");
-    }
-    
-    testFile = fopen("assets/sounds/The Stranglers - Golden Brown.mp3", "rb");
-    if (testFile) {
-        fclose(testFile);
-        winMusicAvailable = true;
-        printf("DEBUG: Win music available\n");
-    } else {
-        winMusicAvailable = false;
-        printf("WARNING: Win music not available - will run silently\n");
-    }
-    
-    testFile = fopen("assets/sounds/Brazilian Phonk Remix - SoundSorcerer.mp3", "rb");
-    if (testFile) {
-        fclose(testFile);
-        loseMusicAvailable = true;
-        printf("DEBUG: Lose music available\n");
-    } else {
-        loseMusicAvailable = false;
-        printf("WARNING: Lose music not available - will run silently\n");
-    }
-    
-    testFile = fopen("assets/sounds/IndiGo-TakeOff-AirBus-320.mp3", "rb");
-    if (testFile) {
-        fclose(testFile);
-        takeoffSoundAvailable = true;
-        printf("DEBUG: Takeoff sound available\n");
-    } else {
-        takeoffSoundAvailable = false;
-        printf("WARNING: Takeoff sound not available - will run silently\n");
-    }
-    
-    audioAssetsAvailable = backgroundMusicAvailable || winMusicAvailable || loseMusicAvailable || takeoffSoundAvailable;
-    
-    if (!audioAssetsAvailable) {
-        printf("INFO: No audio assets found - game will run in silent mode\n");
-    } else {
-        printf("INFO: Some audio assets available - partial audio mode\n");
-    }
-    
-    return audioAssetsAvailable;
+float FixedTimestep::tickSeconds() const
+{
+  return 1.0f / tickRate;
 }
 
-void drawMapBackground() {
-  if (mapTexture == 0) {
-    printf("DEBUG: mapTexture is 0, using fallback background\n");
-    glColor3f(0.55f, 0.55f, 0.58f);
-    glDisable(GL_TEXTURE_2D);
-    glBegin(GL_QUADS);
-    glVertex2f(0, GAME_AREA_BOTTOM);
-    glVertex2f(WINDOW_WIDTH, GAME_AREA_BOTTOM);
-    glVertex2f(WINDOW_WIDTH, GAME_AREA_TOP);
-    glVertex2f(0, GAME_AREA_TOP);
-    glEnd();
-    return;
+int FixedTimestep::advance(double now)
+{
+  if (lastTime < 0)
+    lastTime = now;
+  double frame = now - lastTime;
+  lastTime = now;
+  if (frame > MAX_FRAME_SECONDS)
+  {
+    frame = MAX_FRAME_SECONDS;
+    clampedFrames++;
   }
 
-  glColor3f(1.0f, 1.0f, 1.0f);
-  glEnable(GL_TEXTURE_2D);
-  glBindTexture(GL_TEXTURE_2D, mapTexture);
-  
-  glBegin(GL_QUADS);
-  glTexCoord2f(0.0f, 1.0f); glVertex2f(0, GAME_AREA_BOTTOM);
-  glTexCoord2f(1.0f, 1.0f); glVertex2f(WINDOW_WIDTH, GAME_AREA_BOTTOM);
-  glTexCoord2f(1.0f, 0.0f); glVertex2f(WINDOW_WIDTH, GAME_AREA_TOP);
-  glTexCoord2f(0.0f, 0.0f); glVertex2f(0, GAME_AREA_TOP);
-  glEnd();
-  
-  glDisable(GL_TEXTURE_2D);
+  accumulator += frame;
+  double tick = 1.0 / tickRate;
+  int ticks = (int)(accumulator / tick);
+  accumulator -= ticks * tick;
+  alpha = (float)(accumulator / tick);
+  return ticks;
 }
 
-bool checkCollision(float x1, float y1, float w1, float h1,
-                    float x2, float y2, float w2, float h2)
+// Real time that tick index (of the ticks the last advance() returned) stands
+// for; the last one ends where the accumulator's remainder begins
+double FixedTimestep::tickEndTime(int index, int ticks) const
 {
-  return (x1 < x2 + w2 && x1 + w1 > x2 && y1 < y2 + h2 && y1 + h1 > y2);
+  return lastTime - accumulator - (ticks - 1 - index) / (double)tickRate;
 }
 
-bool wouldCollideWithObstacle(float newX, float newY)
+// Returns false when the platform gives no control over the swap interval
+bool setSwapInterval(int interval)
 {
-  // If invincible (VIP badge), can pass through guards
-  if (invincible) {
-    return false;
-  }
-  
-  // Check if the new position would collide with any active obstacle
-  for (const auto &obstacle : obstacles)
+#ifdef __APPLE__
+  GLint value = interval;
+  return CGLSetParameter(CGLGetCurrentContext(), kCGLCPSwapInterval, &value) == kCGLNoError;
+#else
+  typedef void (*SwapIntervalEXT)(Display *, GLXDrawable, int);
+  typedef int (*SwapIntervalMESA)(unsigned int);
+  typedef int (*SwapIntervalSGI)(int);
+
+  if (hasGLXExtension("GLX_EXT_swap_control"))
   {
-    if (obstacle.active && checkCollision(newX - PLAYER_SIZE / 2, newY - PLAYER_SIZE / 2,
-                                         PLAYER_SIZE, PLAYER_SIZE,
-                                         obstacle.x - obstacle.width / 2, obstacle.y - obstacle.height / 2,
-                                         obstacle.width, obstacle.height))
+    SwapIntervalEXT fn = (SwapIntervalEXT)glXGetProcAddressARB((const GLubyte *)"glXSwapIntervalEXT");
+    if (fn && glXGetCurrentDisplay())
     {
+      fn(glXGetCurrentDisplay(), glXGetCurrentDrawable(), interval);
       return true;
     }
   }
-  return false;
-}
-
-void handleCollisions()
-{
-  static int debugCounter = 0;
-  if (debugCounter % 60 == 0) {
-    printf("DEBUG: Player at (%.1f, %.1f), Friend at (%.1f, %.1f), Collectibles: %zu, Lives: %d, Score: %d\n", 
-           playerX, playerY, friendObj.x, friendObj.y, collectibles.size(), lives, score);
+  if (hasGLXExtension("GLX_MESA_swap_control"))
+  {
+    SwapIntervalMESA fn = (SwapIntervalMESA)glXGetProcAddressARB((const GLubyte *)"glXSwapIntervalMESA");
+    if (fn)
+      return fn((unsigned int)interval) == 0;
   }
-  debugCounter++;
-
-  for (auto &obstacle : obstacles)
+  // SGI_swap_control cannot turn vsync off
+  if (interval > 0 && hasGLXExtension("GLX_SGI_swap_control"))
   {
-    if (obstacle.active && checkCollision(playerX - PLAYER_SIZE / 2, playerY - PLAYER_SIZE / 2,
-                                          PLAYER_SIZE, PLAYER_SIZE,
-                                          obstacle.x - obstacle.width / 2, obstacle.y - obstacle.height / 2,
-                                          obstacle.width, obstacle.height))
-    {
-      if (!invincible)
-      {
-        lives--;
-        printf("DEBUG: Hit guard! Lives: %d\n", lives);
-        // No need to push back since movement is now prevented
-      }
-    }
+    SwapIntervalSGI fn = (SwapIntervalSGI)glXGetProcAddressARB((const GLubyte *)"glXSwapIntervalSGI");
+    if (fn)
+      return fn(interval) == 0;
   }
+  return false;
+#endif
+}
 
-  for (auto it = collectibles.begin(); it != collectibles.end();)
+void FramePacing::start()
+{
+  if (benchmarkSeconds > 0)
+    swapInterval = 0;
+  if (doubleBuffered)
   {
-    if (it->active && checkCollision(playerX - PLAYER_SIZE / 2, playerY - PLAYER_SIZE / 2,
-                                     PLAYER_SIZE, PLAYER_SIZE,
-                                     it->x - it->width / 2, it->y - it->height / 2,
-                                     it->width, it->height))
-    {
-      printf("DEBUG: Collected item at (%.1f, %.1f)\n", it->x, it->y);
-      score += 5;
-      it = collectibles.erase(it);
-    }
-    else
-    {
-      ++it;
-    }
+    swapIntervalApplied = setSwapInterval(swapInterval);
+    printf("DEBUG: Double-buffered, swap interval %d %s\n", swapInterval,
+           swapIntervalApplied ? "applied" : "not supported - driver default");
   }
-
-  if (friendObj.active && !friendCollected &&
-      checkCollision(playerX - PLAYER_SIZE / 2, playerY - PLAYER_SIZE / 2,
-                     PLAYER_SIZE, PLAYER_SIZE,
-                     friendObj.x - friendObj.width / 2, friendObj.y - friendObj.height / 2,
-                     friendObj.width, friendObj.height))
+  else
   {
-    printf("DEBUG: Collected friend at (%.1f, %.1f)\n", friendObj.x, friendObj.y);
-    friendCollected = true;
-    friendObj.active = false;
-    score += 20;
+    printf("DEBUG: Single-buffered presentation (glFlush)\n");
   }
+  if (benchmarkSeconds > 0)
+    printf("DEBUG: Benchmark mode - uncapped for %.1f s\n", benchmarkSeconds);
+
+  frameMs.assign(FRAME_HISTORY, 0.0f);
+  nextSample = 0;
+  frames = 0;
+  missedVblanks = 0;
+  startTime = nowSeconds();
+  lastPresent = startTime;
+}
+
+void FramePacing::recordPresent()
+{
+  double now = nowSeconds();
+  double dt = now - lastPresent;
+  lastPresent = now;
+
+  frameMs[nextSample] = (float)(dt * 1000.0);
+  nextSample = (nextSample + 1) % FRAME_HISTORY;
+  frames++;
 
-  for (auto it = powerups.begin(); it != powerups.end();)
+  // A frame that took more refresh periods than the swap interval asked for
+  // missed that many vblanks
+  if (doubleBuffered && swapInterval > 0)
   {
-    if (it->active && checkCollision(playerX - PLAYER_SIZE / 2, playerY - PLAYER_SIZE / 2,
-                                     PLAYER_SIZE, PLAYER_SIZE,
-                                     it->x - 10, it->y - 10, 20, 20))
-    {
-      printf("DEBUG: Collected powerup at (%.1f, %.1f)\n", it->x, it->y);
-      if (it->type == 1)
-      {
-        invincible = true;
-        invincibleTimer = 5.0f;
-        printf("DEBUG: Got VIP badge - invincible for 5 seconds!\n");
-      }
-      else if (it->type == 2)
-      {
-        speedBoost = true;
-        speedBoostTimer = 5.0f;
-        currentSpeed = PLAYER_SPEED * 2.0f;
-        printf("DEBUG: Got fast track - speed boost for 5 seconds!\n");
-      }
-      it = powerups.erase(it);
-    }
-    else
-    {
-      ++it;
-    }
+    long periods = lround(dt * refreshHz);
+    if (periods > swapInterval)
+      missedVblanks += periods - swapInterval;
   }
 
-  if (friendCollected && checkCollision(playerX - PLAYER_SIZE / 2, playerY - PLAYER_SIZE / 2,
-                                        PLAYER_SIZE, PLAYER_SIZE,
-                                        planeX - 30, planeY - 6, 60, 12))
+  if (benchmarkSeconds > 0 && now - startTime >= benchmarkSeconds)
   {
-    printf("DEBUG: Reached plane at (%.1f, %.1f)\n", planeX, planeY);
-    gameState = WIN;
-    // Stop background music and start both win sounds simultaneously
-    stopBackgroundMusic();
-    startWinMusic();        // The Stranglers - Golden Brown (loops continuously)
-    startTakeoffSound();    // IndiGo-TakeOff-AirBus-320 (plays once at the same time)
+    exitLabel = "BENCHMARK";
+    exit(0);
   }
+  if (frames % FRAME_REPORT_INTERVAL == 0)
+    report("FRAMES");
 }
 
-void init()
+void FramePacing::report(const char *label) const
 {
-  printf("DEBUG: Attempting to load texture: cluj-napoca_airport_map.bmp\n");
-  mapTexture = loadBMPTexture("./assets/images/cluj-napoca_airport_map.bmp");
-  printf("DEBUG: Texture loaded with ID: %d\n", mapTexture);
-  
-  // Check audio assets availability
-  checkAudioAssets();
+  int n = (int)std::min<long>(frames, FRAME_HISTORY);
+  if (n == 0)
+    return;
 
-  playerTexture = createColorTexture(0.8f, 0.6f, 0.4f);
-  planeTexture = createColorTexture(0.9f, 0.9f, 0.9f);
-  guardTexture = createColorTexture(0.2f, 0.2f, 0.8f);
-  boardingPassTexture = createColorTexture(1.0f, 1.0f, 0.9f);
-  friendTexture = createColorTexture(0.8f, 0.6f, 0.4f);
-  badgeTexture = createColorTexture(1.0f, 0.8f, 0.0f);
-  fastTrackTexture = createColorTexture(0.0f, 0.8f, 0.0f);
-  luggageTexture = createColorTexture(0.6f, 0.4f, 0.2f);
-  panelTexture = createColorTexture(0.3f, 0.3f, 0.3f);
+  std::vector<float> sorted(frameMs.begin(), frameMs.begin() + n);
+  std::sort(sorted.begin(), sorted.end());
+  double sum = 0;
+  for (float ms : sorted)
+    sum += ms;
+  float p99 = sorted[(n - 1) * 99 / 100];
+  double elapsed = lastPresent - startTime;
+
+  printf("%s: %ld frames, %.1f fps, frame time min %.2f / avg %.2f / p99 %.2f ms (last %d), missed vblanks %ld, clamped stalls %ld\n",
+         label, frames, elapsed > 0 ? frames / elapsed : 0.0, sorted[0], sum / n, p99, n, missedVblanks,
+         fixedStep.clampedFrames);
+}
 
-  glEnable(GL_TEXTURE_2D);
-  glClearColor(0.15f, 0.15f, 0.2f, 1.0f);
+void reportFramePacingAtExit()
+{
+  framePacing.report(framePacing.exitLabel);
+}
 
-  cameraOffsetX = 0;
-  cameraOffsetY = 0;
-  
-  playerX = 500;
-  playerY = 50;
-  playerAngle = 0;
-  gameState = SETUP;
-  score = 0;
-  lives = 5;
-  gameTime = 60;
-  gameTimer = 0;
-  friendCollected = false;
+// --- FRAME PROFILER ---
 
-  planeX = 500;
-  planeY = 450;
-  
-  friendObj = {487, 400, 30, 35, true, 0, 0};
-  
-  cameraOffsetX = 0;
-  cameraOffsetY = 250;
+const char *profilePhaseNames[PHASE_COUNT] = {
+    "simulation", "collisions", "map", "entities", "crowd", "actors", "panels", "banners", "overlay", "present"};
+const float profilePhaseColors[PHASE_COUNT][3] = {
+    {0.2f, 0.6f, 1.0f}, {1.0f, 0.3f, 0.3f}, {0.5f, 0.5f, 0.5f}, {1.0f, 0.8f, 0.0f}, {1.0f, 0.6f, 0.7f},
+    {0.0f, 0.8f, 0.4f}, {0.8f, 0.4f, 1.0f}, {1.0f, 0.5f, 0.0f}, {0.6f, 0.9f, 0.9f}, {0.9f, 0.9f, 0.9f}};
 
-  obstacles.clear();
-  collectibles.clear();
-  powerups.clear();
+ProfileScope::ProfileScope(ProfilePhase phase)
+    : phase(phase), start(0), childSeconds(0), parent(nullptr)
+{
+  if (!profiler.enabled)
+  {
+    this->phase = PHASE_COUNT;
+    return;
+  }
+  parent = profiler.innermost;
+  profiler.innermost = this;
+  start = nowSeconds();
 }
 
-void display()
+ProfileScope::~ProfileScope()
 {
-  glClear(GL_COLOR_BUFFER_BIT);
+  if (phase == PHASE_COUNT)
+    return;
+  double elapsed = nowSeconds() - start;
+  profiler.current[phase] += elapsed - childSeconds;
+  if (parent)
+    parent->childSeconds += elapsed;
+  profiler.innermost = parent;
+}
 
-  glPushMatrix();
-  glTranslatef(cameraOffsetX, cameraOffsetY, 0);
-  drawMapBackground();
+void FrameProfiler::countEntities(int drawn, int culled)
+{
+  drawnEntities += drawn;
+  culledEntities += culled;
+}
 
-  for (const auto &obstacle : obstacles)
+void FrameProfiler::commitFrame()
+{
+  if (!enabled)
+    return;
+  unsigned int index = committed.load(std::memory_order_relaxed);
+  ProfileFrame &frame = ring[index & (PROFILE_RING_FRAMES - 1)];
+  for (int p = 0; p < PHASE_COUNT; p++)
   {
-    if (obstacle.active)
-    {
-      drawGuard(obstacle.x, obstacle.y);
-    }
+    frame.ms[p] = (float)(current[p] * 1000.0);
+    current[p] = 0;
   }
+  frame.drawnEntities = drawnEntities;
+  frame.culledEntities = culledEntities;
+  drawnEntities = culledEntities = 0;
+  committed.store(index + 1, std::memory_order_release);
+}
+
+// Copies up to count of the most recent frames into out, oldest first
+int FrameProfiler::latest(int count, ProfileFrame *out) const
+{
+  unsigned int end = committed.load(std::memory_order_acquire);
+  unsigned int available = std::min<unsigned int>(end, PROFILE_RING_FRAMES);
+  unsigned int n = std::min<unsigned int>((unsigned int)count, available);
+  for (unsigned int i = 0; i < n; i++)
+  {
+    out[i] = ring[(end - n + i) & (PROFILE_RING_FRAMES - 1)];
+  }
+  return (int)n;
+}
+
+bool FrameProfiler::writeCsv(const char *path) const
+{
+  std::vector<ProfileFrame> frames(PROFILE_RING_FRAMES);
+  int n = latest(PROFILE_RING_FRAMES, frames.data());
+  if (n == 0)
+    return false;
 
-  for (const auto &collectible : collectibles)
+  FILE *file = fopen(path, "w");
+  if (!file)
+    return false;
+  unsigned int first = committed.load(std::memory_order_acquire) - n;
+  fprintf(file, "frame");
+  for (int p = 0; p < PHASE_COUNT; p++)
+    fprintf(file, ",%s_ms", profilePhaseNames[p]);
+  fprintf(file, ",total_ms,drawn_entities,culled_entities\n");
+  for (int i = 0; i < n; i++)
   {
-    if (collectible.active)
+    float total = 0;
+    fprintf(file, "%u", first + i);
+    for (int p = 0; p < PHASE_COUNT; p++)
     {
-      drawBoardingPass(collectible.x, collectible.y, collectible.rotation);
+      fprintf(file, ",%.4f", frames[i].ms[p]);
+      total += frames[i].ms[p];
     }
+    fprintf(file, ",%.4f,%d,%d\n", total, frames[i].drawnEntities, frames[i].culledEntities);
   }
+  fclose(file);
+  return true;
+}
+
+void writeProfileCsvAtExit()
+{
+  const char *path = getenv("AIRPORT_RUSH_PROFILE_CSV");
+  if (!path)
+    path = "airport_rush_profile.csv";
+  if (profiler.writeCsv(path))
+    printf("DEBUG: Frame profile written to %s\n", path);
+}
+
+// Stacked per-phase bars for the last PROFILE_GRAPH_FRAMES frames, one pixel
+// column per frame, with a 60 fps budget line and per-phase averages.
+void drawProfilerOverlay()
+{
+  ProfileScope scope(PHASE_OVERLAY);
+  static ProfileFrame frames[PROFILE_GRAPH_FRAMES];
+  int n = profiler.latest(PROFILE_GRAPH_FRAMES, frames);
+
+  const float pixelsPerMs = 4.0f;
+  const float graphHeight = 200.0f;
+  float left = WINDOW_WIDTH - PROFILE_GRAPH_FRAMES - 10;
+  float bottom = GAME_AREA_BOTTOM + 10;
+
+  glColor3f(0.05f, 0.05f, 0.08f);
+  glBegin(GL_QUADS);
+  glVertex2f(left - 110, bottom);
+  glVertex2f(left + PROFILE_GRAPH_FRAMES, bottom);
+  glVertex2f(left + PROFILE_GRAPH_FRAMES, bottom + graphHeight);
+  glVertex2f(left - 110, bottom + graphHeight);
+  glEnd();
 
-  for (const auto &powerup : powerups)
+  double average[PHASE_COUNT] = {};
+  glBegin(GL_LINES);
+  for (int i = 0; i < n; i++)
   {
-    if (powerup.active)
+    float x = left + (PROFILE_GRAPH_FRAMES - n) + i + 0.5f;
+    float y = bottom;
+    for (int p = 0; p < PHASE_COUNT; p++)
     {
-      if (powerup.type == 1)
-      {
-        drawManagerBadge(powerup.x, powerup.y, powerup.animScale);
-      }
-      else
-      {
-        drawFastTrackPass(powerup.x, powerup.y, powerup.animScale);
-      }
+      float top = std::min(y + frames[i].ms[p] * pixelsPerMs, bottom + graphHeight);
+      glColor3fv(profilePhaseColors[p]);
+      glVertex2f(x, y);
+      glVertex2f(x, top);
+      y = top;
+      average[p] += frames[i].ms[p];
     }
   }
+  glColor3f(1.0f, 1.0f, 1.0f);
+  glVertex2f(left, bottom + 16.7f * pixelsPerMs);
+  glVertex2f(left + PROFILE_GRAPH_FRAMES, bottom + 16.7f * pixelsPerMs);
+  glEnd();
 
-  if (friendObj.active && !friendCollected)
+  char text[64];
+  for (int p = 0; p < PHASE_COUNT; p++)
+  {
+    glColor3fv(profilePhaseColors[p]);
+    sprintf(text, "%s %.2f", profilePhaseNames[p], n ? average[p] / n : 0.0);
+    drawText(ATLAS_HELVETICA_10, left - 105, bottom + graphHeight - 14 - p * 14, text);
+  }
+  glColor3f(1.0f, 1.0f, 1.0f);
+  drawText(ATLAS_HELVETICA_10, left + 2, bottom + 16.7f * pixelsPerMs + 3, "16.7 ms");
+  if (n > 0)
   {
-    drawFriend(friendObj.x, friendObj.y);
+    sprintf(text, "drawn %d", frames[n - 1].drawnEntities);
+    drawText(ATLAS_HELVETICA_10, left - 105, bottom + 18, text);
+    sprintf(text, "culled %d", frames[n - 1].culledEntities);
+    drawText(ATLAS_HELVETICA_10, left - 105, bottom + 4, text);
   }
+}
 
-  drawPlane(planeX, planeY);
-  
-  glPopMatrix();
-  drawPlayer(WINDOW_WIDTH / 2, WINDOW_HEIGHT / 2, playerAngle);
+// --- PANEL LAYER ---
+// The top and bottom panels only change when the score, lives, time, friend
+// or power-up state does, so they are rendered into a window-sized texture
+// and composited as one alpha-tested quad. The texture is redrawn only when
+// the PanelKey taken from the simulation differs from the cached one.
+
+struct PanelKey
+{
+  int score, lives, gameTime;
+  bool friendCollected, invincible, speedBoost;
+  GameState gameState;
+  bool audioAssets, allAudio;
+
+  bool operator==(const PanelKey &o) const;
+};
+
+GLuint panelLayerFBO = 0;
+GLuint panelLayerTexture = 0;
+bool panelLayerValid = false;
+PanelKey panelLayerKey;
 
+bool PanelKey::operator==(const PanelKey &o) const
+{
+  return score == o.score && lives == o.lives && gameTime == o.gameTime &&
+         friendCollected == o.friendCollected && invincible == o.invincible &&
+         speedBoost == o.speedBoost && gameState == o.gameState &&
+         audioAssets == o.audioAssets && allAudio == o.allAudio;
+}
+
+PanelKey panelKeyFor(const Simulation &s)
+{
+  PanelKey key;
+  key.score = s.score;
+  key.lives = s.lives;
+  key.gameTime = s.gameTime;
+  key.friendCollected = s.friendCollected;
+  key.invincible = s.invincible;
+  key.speedBoost = s.speedBoost;
+  key.gameState = s.gameState;
+  key.audioAssets = audioAssetsAvailable;
+  key.allAudio = backgroundMusicAvailable && winMusicAvailable && loseMusicAvailable && takeoffSoundAvailable;
+  return key;
+}
+
+void drawPanels(const Simulation &s)
+{
   glColor3f(0.1f, 0.1f, 0.15f);
   glDisable(GL_TEXTURE_2D);
   glBegin(GL_QUADS);
@@ -1366,19 +6881,19 @@ void display()
 
   for (int i = 0; i < 5; i++)
   {
-    drawStressIndicator(50 + i * 40, WINDOW_HEIGHT - 50, i < lives);
+    drawStressIndicator(50 + i * 40, WINDOW_HEIGHT - 50, i < s.lives);
   }
 
   glColor3f(ROMANIA_YELLOW_R, ROMANIA_YELLOW_G, ROMANIA_YELLOW_B);
   char scoreText[50];
-  sprintf(scoreText, "SCORE: %d", score);
+  sprintf(scoreText, "SCORE: %d", s.score);
   print(250, WINDOW_HEIGHT - 60, scoreText);
 
   char timeText[50];
-  sprintf(timeText, "TIME: %d sec", gameTime);
+  sprintf(timeText, "TIME: %d sec", s.gameTime);
   print(450, WINDOW_HEIGHT - 60, timeText);
 
-  if (friendCollected)
+  if (s.friendCollected)
   {
     glColor3f(0.0f, 1.0f, 0.0f);
     print(650, WINDOW_HEIGHT - 60, (char *)"FRIEND: OK!");
@@ -1389,61 +6904,329 @@ void display()
     print(650, WINDOW_HEIGHT - 60, (char *)"FIND FRIEND!");
   }
 
-  if (gameState == SETUP)
+  if (s.gameState == SETUP)
   {
     glColor3f(ROMANIA_RED_R, ROMANIA_RED_G, ROMANIA_RED_B);
     print(350, WINDOW_HEIGHT - 30, (char *)"SETUP: Click objects, press R to start.");
   }
 
-  if (invincible)
+  if (s.invincible)
+  {
+    glColor3f(ROMANIA_YELLOW_R, ROMANIA_YELLOW_G, ROMANIA_YELLOW_B);
+    print(850, WINDOW_HEIGHT - 60, (char *)"VIP!");
+  }
+  if (s.speedBoost)
+  {
+    glColor3f(ROMANIA_BLUE_R, ROMANIA_BLUE_G, ROMANIA_BLUE_B);
+    print(850, WINDOW_HEIGHT - 30, (char *)"FAST!");
+  }
+  
+  // Audio status indicator
+  if (!audioAssetsAvailable)
+  {
+    glColor3f(0.5f, 0.5f, 0.5f);
+    print(50, WINDOW_HEIGHT - 30, (char *)"🔇 SILENT MODE");
+  }
+  else if (!backgroundMusicAvailable || !winMusicAvailable || !loseMusicAvailable || !takeoffSoundAvailable)
+  {
+    glColor3f(0.8f, 0.6f, 0.0f);
+    print(50, WINDOW_HEIGHT - 30, (char *)"🔊 PARTIAL AUDIO");
+  }
+
+  glBegin(GL_QUADS);
+  glColor3f(0.2f, 0.2f, 0.25f);
+  glVertex2f(0, 0);
+  glVertex2f(WINDOW_WIDTH, 0);
+  glColor3f(0.3f, 0.3f, 0.35f);
+  glVertex2f(WINDOW_WIDTH, BOTTOM_PANEL_HEIGHT);
+  glVertex2f(0, BOTTOM_PANEL_HEIGHT);
+  glEnd();
+
+  drawGuard(100, 50);
+  drawBoardingPass(250, 50, 0);
+  drawManagerBadge(400, 50, 1.0f);
+  drawFastTrackPass(550, 50, 1.0f);
+
+  glColor3f(ROMANIA_YELLOW_R, ROMANIA_YELLOW_G, ROMANIA_YELLOW_B);
+  print(70, 20, (char *)"Guard");
+  print(205, 20, (char *)"Boarding Pass");
+  print(365, 20, (char *)"VIP Badge");
+  print(515, 20, (char *)"Fast Track");
+
+  glColor3f(ROMANIA_BLUE_R, ROMANIA_BLUE_G, ROMANIA_BLUE_B);
+  print(700, 50, (char *)"Click Below to Select Item.");
+  print(700, 20, (char *)"Click on Map to Place.");
+}
+
+void initPanelLayer()
+{
+  if (!hasGLExtension("GL_EXT_framebuffer_object"))
+  {
+    printf("INFO: No framebuffer objects - panels are redrawn every frame\n");
+    return;
+  }
+
+  glGenTextures(1, &panelLayerTexture);
+  glBindTexture(GL_TEXTURE_2D, panelLayerTexture);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, WINDOW_WIDTH, WINDOW_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+  glGenFramebuffersEXT(1, &panelLayerFBO);
+  glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, panelLayerFBO);
+  glFramebufferTexture2DEXT(GL_FRAMEBUFFER_EXT, GL_COLOR_ATTACHMENT0_EXT, GL_TEXTURE_2D, panelLayerTexture, 0);
+  bool ok = glCheckFramebufferStatusEXT(GL_FRAMEBUFFER_EXT) == GL_FRAMEBUFFER_COMPLETE_EXT;
+  glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, 0);
+
+  if (!ok)
+  {
+    glDeleteFramebuffersEXT(1, &panelLayerFBO);
+    glDeleteTextures(1, &panelLayerTexture);
+    panelLayerFBO = 0;
+    panelLayerTexture = 0;
+  }
+  panelLayerValid = false;
+  printf("DEBUG: Panel layer %s\n", ok ? "cached in a framebuffer object" : "incomplete - redrawn every frame");
+}
+
+void drawPanelLayer(const Simulation &s)
+{
+  if (!panelLayerFBO)
+  {
+    drawPanels(s);
+    return;
+  }
+
+  PanelKey key = panelKeyFor(s);
+  if (!panelLayerValid || !(key == panelLayerKey))
+  {
+    glPushAttrib(GL_VIEWPORT_BIT | GL_COLOR_BUFFER_BIT | GL_ENABLE_BIT);
+    glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, panelLayerFBO);
+    glViewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    drawPanels(s);
+    glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, 0);
+    glPopAttrib();
+    panelLayerKey = key;
+    panelLayerValid = true;
+  }
+
+  glPushAttrib(GL_ENABLE_BIT | GL_TEXTURE_BIT | GL_COLOR_BUFFER_BIT | GL_CURRENT_BIT);
+  glEnable(GL_TEXTURE_2D);
+  glBindTexture(GL_TEXTURE_2D, panelLayerTexture);
+  glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
+  glEnable(GL_ALPHA_TEST);
+  glAlphaFunc(GL_GREATER, 0.5f);
+  glBegin(GL_QUADS);
+  glTexCoord2f(0.0f, 0.0f); glVertex2f(0, 0);
+  glTexCoord2f(1.0f, 0.0f); glVertex2f(WINDOW_WIDTH, 0);
+  glTexCoord2f(1.0f, 1.0f); glVertex2f(WINDOW_WIDTH, WINDOW_HEIGHT);
+  glTexCoord2f(0.0f, 1.0f); glVertex2f(0, WINDOW_HEIGHT);
+  glEnd();
+  glPopAttrib();
+}
+
+// --- ASSET LOADING ---
+
+// Maps and validates the file. Small maps are paged in here too; large ones
+// fault in tile by tile as the view reaches them.
+const size_t MAP_PREFAULT_LIMIT = 64 << 20;
+
+static bool loadMapImage(AssetJob &job)
+{
+  if (!mapBMPFile(job.path, job.image))
+    return false;
+  if ((size_t)job.image.rowStride * job.image.height <= MAP_PREFAULT_LIMIT)
+    prefaultBMPImage(job.image);
+  mapTiles.buildLevels(job.image);
+  return true;
+}
+
+static void uploadMapImage(AssetJob &job)
+{
+  mapTiles.attach();
+  printf("SUCCESS: Mapped %s for tiled drawing (Width: %d, Height: %d)\n",
+         job.path, job.image.width, job.image.height);
+}
+
+static bool loadSoundJob(AssetJob &job)
+{
+  return loadSoundAsset((SoundId)job.sound);
+}
+
+static void *assetWorker(void *arg)
+{
+  AssetLoader *loader = (AssetLoader *)arg;
+  for (;;)
+  {
+    int index = loader->nextJob.fetch_add(1);
+    if (index >= (int)loader->jobs.size())
+      return NULL;
+    AssetJob &job = loader->jobs[index];
+    double start = nowSeconds();
+    job.loaded = job.load(job);
+    job.loadSeconds = nowSeconds() - start;
+    pthread_mutex_lock(&loader->lock);
+    loader->loadedJobs.push_back(index);
+    pthread_mutex_unlock(&loader->lock);
+  }
+}
+
+void AssetLoader::add(const AssetJob &job)
+{
+  jobs.push_back(job);
+  remaining++;
+  if (job.sound >= 0)
+    soundsRemaining++;
+}
+
+void AssetLoader::start()
+{
+  startTime = nowSeconds();
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  int wanted = (int)std::min<long>(std::max(cpus, 1L), ASSET_MAX_WORKERS);
+  wanted = std::min(wanted, (int)jobs.size());
+  for (workerCount = 0; workerCount < wanted; workerCount++)
+  {
+    if (pthread_create(&workers[workerCount], NULL, assetWorker, this) != 0)
+      break;
+  }
+  if (workerCount == 0)
+    assetWorker(this); // no threads available: load everything here
+  printf("DEBUG: Loading %d assets on %d worker threads\n", (int)jobs.size(), workerCount);
+}
+
+// GL thread, once per frame: uploads whatever the workers finished
+void AssetLoader::pumpUploads()
+{
+  if (remaining == 0)
+    return;
+  std::vector<int> ready;
+  pthread_mutex_lock(&lock);
+  ready.swap(loadedJobs);
+  pthread_mutex_unlock(&lock);
+
+  for (int index : ready)
+  {
+    AssetJob &job = jobs[index];
+    if (job.loaded && job.upload)
+      job.upload(job);
+    remaining--;
+    if (job.sound >= 0)
+      setSoundAvailable((SoundId)job.sound, job.loaded);
+    if (job.sound >= 0 && --soundsRemaining == 0)
+    {
+      checkAudioAssets();
+      startAudio();
+    }
+  }
+
+  if (remaining == 0)
+  {
+    for (int i = 0; i < workerCount; i++)
+      pthread_join(workers[i], NULL);
+    double loadSeconds = 0;
+    for (const AssetJob &job : jobs)
+      loadSeconds += job.loadSeconds;
+    printf("STARTUP: %d assets ready %.1f ms after launch (%.1f ms of loading on %d workers)\n",
+           (int)jobs.size(), (nowSeconds() - launchTime) * 1000.0, loadSeconds * 1000.0, workerCount);
+  }
+}
+
+// Called after every present; reports the time to the first one
+void AssetLoader::frameShown()
+{
+  if (firstFrameTime != 0)
+    return;
+  firstFrameTime = nowSeconds();
+  printf("STARTUP: first frame %.1f ms after launch, %d of %d assets still loading\n",
+         (firstFrameTime - launchTime) * 1000.0, remaining, (int)jobs.size());
+}
+
+void init()
+{
+  // The map and the sounds load on worker threads; until the map texture is
+  // uploaded the first frames show the fallback background, and the mixer
+  // starts once every sound has been tried
+  assetLoader.add({"map", loadMapImage, uploadMapImage, -1, "./assets/images/cluj-napoca_airport_map.bmp", {}, false, 0});
+  for (int i = 0; i < SOUND_COUNT; i++)
+    assetLoader.add({"sound", loadSoundJob, NULL, i, soundPaths[i], {}, false, 0});
+  assetLoader.start();
+
+  playerTexture = createColorTexture(0.8f, 0.6f, 0.4f);
+  planeTexture = createColorTexture(0.9f, 0.9f, 0.9f);
+  guardTexture = createColorTexture(0.2f, 0.2f, 0.8f);
+  boardingPassTexture = createColorTexture(1.0f, 1.0f, 0.9f);
+  friendTexture = createColorTexture(0.8f, 0.6f, 0.4f);
+  badgeTexture = createColorTexture(1.0f, 0.8f, 0.0f);
+  fastTrackTexture = createColorTexture(0.0f, 0.8f, 0.0f);
+  luggageTexture = createColorTexture(0.6f, 0.4f, 0.2f);
+  panelTexture = createColorTexture(0.3f, 0.3f, 0.3f);
+
+  initGlyphAtlases();
+  initSpriteGeometry();
+  initInstancedRendering();
+  initPanelLayer();
+
+  glEnable(GL_TEXTURE_2D);
+  glClearColor(0.15f, 0.15f, 0.2f, 1.0f);
+
+  sim.reset();
+}
+
+// Audio and UI reactions to the events raised by one sim.step()
+void handleSimEvents(unsigned int events)
+{
+  if (events & SIM_EVENT_STARTED)
   {
-    glColor3f(ROMANIA_YELLOW_R, ROMANIA_YELLOW_G, ROMANIA_YELLOW_B);
-    print(850, WINDOW_HEIGHT - 60, (char *)"VIP!");
+    // Start background music when game begins
+    startBackgroundMusic();
   }
-  if (speedBoost)
+  if (events & SIM_EVENT_RESET)
   {
-    glColor3f(ROMANIA_BLUE_R, ROMANIA_BLUE_G, ROMANIA_BLUE_B);
-    print(850, WINDOW_HEIGHT - 30, (char *)"FAST!");
+    // Stop any playing music
+    cleanupAudio();
+    drawingMode = NONE;
   }
-  
-  // Audio status indicator
-  if (!audioAssetsAvailable)
+  if (events & SIM_EVENT_WON)
   {
-    glColor3f(0.5f, 0.5f, 0.5f);
-    print(50, WINDOW_HEIGHT - 30, (char *)"🔇 SILENT MODE");
+    // Stop background music and start both win sounds simultaneously
+    stopBackgroundMusic();
+    startWinMusic();        // The Stranglers - Golden Brown (loops continuously)
+    startTakeoffSound();    // IndiGo-TakeOff-AirBus-320 (plays once at the same time)
   }
-  else if (!backgroundMusicAvailable || !winMusicAvailable || !loseMusicAvailable || !takeoffSoundAvailable)
+  if (events & SIM_EVENT_LOST)
   {
-    glColor3f(0.8f, 0.6f, 0.0f);
-    print(50, WINDOW_HEIGHT - 30, (char *)"🔊 PARTIAL AUDIO");
+    // Stop background music and start lose music when game is lost
+    stopBackgroundMusic();
+    startLoseMusic();
   }
+}
 
-  glBegin(GL_QUADS);
-  glColor3f(0.2f, 0.2f, 0.25f);
-  glVertex2f(0, 0);
-  glVertex2f(WINDOW_WIDTH, 0);
-  glColor3f(0.3f, 0.3f, 0.35f);
-  glVertex2f(WINDOW_WIDTH, BOTTOM_PANEL_HEIGHT);
-  glVertex2f(0, BOTTOM_PANEL_HEIGHT);
-  glEnd();
-
-  drawGuard(100, 50);
-  drawBoardingPass(250, 50, 0);
-  drawManagerBadge(400, 50, 1.0f);
-  drawFastTrackPass(550, 50, 1.0f);
-
-  glColor3f(ROMANIA_YELLOW_R, ROMANIA_YELLOW_G, ROMANIA_YELLOW_B);
-  print(70, 20, (char *)"Guard");
-  print(205, 20, (char *)"Boarding Pass");
-  print(365, 20, (char *)"VIP Badge");
-  print(515, 20, (char *)"Fast Track");
-
-  glColor3f(ROMANIA_BLUE_R, ROMANIA_BLUE_G, ROMANIA_BLUE_B);
-  print(700, 50, (char *)"Click Below to Select Item.");
-  print(700, 20, (char *)"Click on Map to Place.");
+// Runs as many fixed ticks as the real time since the last frame covers.
+// Each tick takes the queued inputs that arrived before its end time.
+void advanceSimulation()
+{
+  ProfileScope scope(PHASE_SIMULATION);
+  int ticks = fixedStep.advance(nowSeconds());
+  SimInputs inputs;
+  for (int i = 0; i < ticks; i++)
+  {
+    inputQueue.drain(fixedStep.tickEndTime(i, ticks), heldKeys, inputs);
+    sim.step(inputs, fixedStep.tickSeconds());
+    inputs.clear();
+    handleSimEvents(sim.events);
+  }
+}
 
+// Win and lose banners over the game area
+void drawBanners(const Simulation &s)
+{
   // FIXED: WIN SCREEN with green-to-black gradient banner
-  if (gameState == WIN)
+  if (s.gameState == WIN)
   {
     float bannerLeft = 200;
     float bannerRight = 800;
@@ -1474,13 +7257,13 @@ void display()
     glColor3f(1.0f, 1.0f, 1.0f);
     print(360, 320, (char *)"BOARDING COMPLETE!");
     char winText[100];
-    sprintf(winText, "Final Score: %d", score);
+    sprintf(winText, "Final Score: %d", s.score);
     print(430, 280, winText);
     print(270, 240, (char *)"You both caught your flight to Munich (MUC)!");
     print(400, 200, (char *)"Press R to play again!");
   }
   // FIXED: LOSE SCREEN with red-to-black gradient banner
-  else if (gameState == LOSE)
+  else if (s.gameState == LOSE)
   {
     float bannerLeft = 200;
     float bannerRight = 800;
@@ -1511,301 +7294,340 @@ void display()
     glColor3f(1.0f, 1.0f, 1.0f);
     print(410, 320, (char *)"FLIGHT MISSED!");
     char loseText[100];
-    sprintf(loseText, "Final Score: %d", score);
+    sprintf(loseText, "Final Score: %d", s.score);
     print(436, 280, loseText);
     print(277, 240, (char *)"Better luck with booking your next flight... x_x");
     print(400, 200, (char *)"Press R to play again!");
   }
-
-  glFlush();
 }
 
-void timer(int value)
+void display()
 {
-  if (gameState == RUNNING)
+  assetLoader.pumpUploads();
+  advanceSimulation();
+  float alpha = fixedStep.alpha;
+
+  glClear(GL_COLOR_BUFFER_BIT);
+
+  float cameraX = lerp(sim.prevCameraOffsetX, sim.cameraOffsetX, alpha);
+  float cameraY = lerp(sim.prevCameraOffsetY, sim.cameraOffsetY, alpha);
+  ViewRect view = worldView(cameraX, cameraY);
+  lowDetailSprites = viewZoom < LOW_DETAIL_ZOOM;
+  glPushMatrix();
+  applyViewZoom();
+  glTranslatef(cameraX, cameraY, 0);
   {
-    gameTimer += 1.0f / 60.0f;
-    if (gameTimer >= 1.0f)
+    ProfileScope scope(PHASE_MAP);
+    drawMapBackground(view);
+  }
+  {
+    ProfileScope scope(PHASE_ENTITIES);
+    drawPlacedEntities(sim, view);
+  }
+  {
+    ProfileScope scope(PHASE_CROWD);
+    drawCrowd(sim, view, alpha);
+  }
+  {
+    ProfileScope scope(PHASE_ACTORS);
+    if (sim.friendObj.active && !sim.friendCollected)
     {
-      gameTimer = 0;
-      gameTime--;
-      if (gameTime <= 0)
-      {
-        gameState = LOSE;
-        // Stop background music and start lose music when game is lost
-        stopBackgroundMusic();
-        startLoseMusic();
-      }
+      bool visible = pointInView(view, sim.friendObj.x, sim.friendObj.y, ENTITY_CULL_MARGIN);
+      if (visible)
+        drawFriend(sim.friendObj.x, sim.friendObj.y);
+      profiler.countEntities(visible, !visible);
     }
 
-    if (invincible)
-    {
-      invincibleTimer -= 1.0f / 60.0f;
-      if (invincibleTimer <= 0)
-      {
-        invincible = false;
-      }
-    }
+    float planeX = lerp(sim.prevPlaneX, sim.planeX, alpha);
+    float planeY = lerp(sim.prevPlaneY, sim.planeY, alpha);
+    bool planeVisible = pointInView(view, planeX, planeY, ENTITY_CULL_MARGIN);
+    if (planeVisible)
+      drawPlane(planeX, planeY);
+    profiler.countEntities(planeVisible, !planeVisible);
+
+    glPopMatrix();
+    glPushMatrix();
+    applyViewZoom();
+    drawPlayer(WINDOW_WIDTH / 2, WINDOW_HEIGHT / 2, sim.playerAngle);
+    glPopMatrix();
+  }
+  lowDetailSprites = false;
 
-    if (speedBoost)
-    {
-      speedBoostTimer -= 1.0f / 60.0f;
-      if (speedBoostTimer <= 0)
-      {
-        speedBoost = false;
-        currentSpeed = PLAYER_SPEED;
-      }
-    }
+  glDisable(GL_TEXTURE_2D);
+  {
+    ProfileScope scope(PHASE_PANELS);
+    drawPanelLayer(sim);
+  }
 
-    bezierT += bezierSpeed;
-    if (bezierT > 1.0f)
-      bezierT = 0.0f;
+  {
+    ProfileScope scope(PHASE_BANNERS);
+    drawBanners(sim);
+  }
+
+  if (profiler.overlayVisible)
+  {
+    drawProfilerOverlay();
+  }
 
-    int *planePos = bezier(bezierT, bezierP0, bezierP1, bezierP2, bezierP3);
-    planeX = planePos[0];
-    planeY = planePos[1];
+  {
+    ProfileScope scope(PHASE_PRESENT);
+    if (framePacing.doubleBuffered)
+      glutSwapBuffers();
+    else
+      glFlush();
+  }
+  framePacing.recordPresent();
+  assetLoader.frameShown();
+  profiler.commitFrame();
+  if (framePacing.doubleBuffered)
+    glutPostRedisplay();
+}
 
-    collectibleRotation += 2.0f;
-    if (collectibleRotation >= 360.0f)
-      collectibleRotation = 0.0f;
+// Single-buffered windows have no vsync to pace them, so redraw on a timer
+void timer(int value)
+{
+  glutPostRedisplay();
+  glutTimerFunc(16, timer, 0);
+}
 
-    conveyorOffset += 1.0f;
-    if (conveyorOffset >= WINDOW_WIDTH + 50)
-      conveyorOffset = 0;
+// --- INPUT QUEUE ---
 
-    for (auto &collectible : collectibles)
-    {
-      collectible.rotation = collectibleRotation;
-    }
+void InputQueue::push(const InputCommand &command)
+{
+  commands.push_back(command);
+  received++;
+}
 
-    for (auto &powerup : powerups)
-    {
-      powerup.animScale = 0.8f + 0.4f * sin(glutGet(GLUT_ELAPSED_TIME) * 0.01f);
-    }
+void InputQueue::pushMove(InputCommandType type, int moveKey, int source, double time)
+{
+  InputCommand command = {};
+  command.type = type;
+  command.time = time;
+  command.moveKey = moveKey;
+  command.source = source;
+  push(command);
+}
 
-    handleCollisions();
+void InputQueue::pushRestart(double time)
+{
+  InputCommand command = {};
+  command.type = INPUT_RESTART;
+  command.time = time;
+  push(command);
+}
 
-    if (lives <= 0)
-    {
-      gameState = LOSE;
-      // Stop background music and start lose music when game is lost
-      stopBackgroundMusic();
-      startLoseMusic();
-    }
-  }
+void InputQueue::pushPlacement(const Placement &placement, double time)
+{
+  InputCommand command = {};
+  command.type = INPUT_PLACE;
+  command.time = time;
+  command.placement = placement;
+  push(command);
+}
 
-  glutPostRedisplay();
-  glutTimerFunc(16, timer, 0);
+void InputQueue::pushLevelLoad(const char *path, double time)
+{
+  InputCommand command = {};
+  command.type = INPUT_LOAD_LEVEL;
+  command.time = time;
+  command.path = path;
+  push(command);
 }
 
-void keyboard(unsigned char key, int x, int y)
+// Moves every command that arrived by tickEnd into out (which the caller has
+// cleared) and samples the held keys after applying the key commands
+void InputQueue::drain(double tickEnd, HeldKeys &keys, SimInputs &out)
 {
-  if (gameState == SETUP)
+  size_t n = 0;
+  for (; n < commands.size() && commands[n].time <= tickEnd; n++)
   {
-    if (key == 'r' || key == 'R')
+    const InputCommand &command = commands[n];
+    switch (command.type)
     {
-      gameState = RUNNING;
-      // Start background music when game begins
-      startBackgroundMusic();
+    case INPUT_MOVE_PRESS:
+      keys.press(command.moveKey, command.source);
+      break;
+    case INPUT_MOVE_RELEASE:
+      keys.release(command.moveKey, command.source);
+      break;
+    case INPUT_RESTART:
+      if (out.restartPressed)
+        coalesced++;
+      out.restartPressed = true;
+      break;
+    case INPUT_PLACE:
+    {
+      const Placement &p = command.placement;
+      bool repeat = false;
+      for (const auto &queued : out.placements)
+      {
+        if (queued.mode == p.mode && queued.x == p.x && queued.y == p.y)
+        {
+          repeat = true;
+          break;
+        }
+      }
+      if (repeat)
+        coalesced++;
+      else
+        out.placements.push_back(p);
+      break;
     }
-    return;
-  }
-
-  // Reset game when in WIN or LOSE state
-  if (gameState == WIN || gameState == LOSE)
-  {
-    if (key == 'r' || key == 'R')
-    {
-      // Stop any playing music
-      cleanupAudio();
-      
-      // Reset game state
-      gameState = SETUP;
-      score = 0;
-      lives = 5;
-      gameTime = 60;
-      gameTimer = 0;
-      friendCollected = false;
-      
-      // Reset player position
-      playerX = 500;
-      playerY = 50;
-      playerAngle = 0;
-      currentSpeed = PLAYER_SPEED;
-      
-      // Reset camera
-      cameraOffsetX = 0;
-      cameraOffsetY = 250;
-      
-      // Reset plane position
-      planeX = 500;
-      planeY = 450;
-      bezierT = 0.0f;
-      
-      // Reset friend object
-      friendObj = {487, 400, 30, 35, true, 0, 0};
-      
-      // Clear all game objects
-      obstacles.clear();
-      collectibles.clear();
-      powerups.clear();
-      
-      // Reset power-up states
-      invincible = false;
-      invincibleTimer = 0;
-      speedBoost = false;
-      speedBoostTimer = 0;
-      
-      // Reset drawing mode
-      drawingMode = NONE;
-      
-      printf("DEBUG: Game reset! Press R to start again.\n");
+    case INPUT_LOAD_LEVEL:
+      if (out.levelToLoad)
+        coalesced++;
+      out.levelToLoad = command.path;
+      break;
     }
-    return;
   }
+  commands.erase(commands.begin(), commands.begin() + n);
+  out.moves = keys.sample();
+}
 
-  if (gameState != RUNNING)
-    return;
+// --- HELD KEYS ---
+
+void HeldKeys::press(int moveKey, int source)
+{
+  down[moveKey][source] = true;
+  tapped |= moveBit(moveKey);
+}
+
+void HeldKeys::release(int moveKey, int source)
+{
+  down[moveKey][source] = false;
+}
 
-  float moveX = 0, moveY = 0;
+// Directions to apply this tick: everything held now plus anything pressed
+// and already released since the previous tick
+unsigned int HeldKeys::sample()
+{
+  unsigned int moves = tapped;
+  for (int m = 0; m < MOVE_KEY_COUNT; m++)
+  {
+    for (int src = 0; src < KEY_SOURCE_COUNT; src++)
+    {
+      if (down[m][src])
+        moves |= moveBit(m);
+    }
+  }
+  tapped = 0;
+  return moves;
+}
 
+// MoveKey for a WASD letter or arrow key, -1 for anything else
+int letterMoveKey(unsigned char key)
+{
   switch (key)
   {
   case 'w':
   case 'W':
-    moveY = currentSpeed;
-    playerAngle = 90;
-    break;
+    return MOVE_UP;
   case 's':
   case 'S':
-    moveY = -currentSpeed;
-    playerAngle = 270;
-    break;
+    return MOVE_DOWN;
   case 'a':
   case 'A':
-    moveX = -currentSpeed;
-    playerAngle = 180;
-    break;
+    return MOVE_LEFT;
   case 'd':
   case 'D':
-    moveX = currentSpeed;
-    playerAngle = 0;
-    break;
+    return MOVE_RIGHT;
   }
+  return -1;
+}
 
-  // Check if the new position would collide with obstacles
-  float newPlayerX = playerX + moveX;
-  float newPlayerY = playerY + moveY;
-  
-  // Only move if there's no collision with obstacles
-  if (!wouldCollideWithObstacle(newPlayerX, newPlayerY))
-  {
-    cameraOffsetX -= moveX;
-    cameraOffsetY -= moveY;
-    playerX = newPlayerX;
-    playerY = newPlayerY;
-  }
-  else if (!invincible)
+int arrowMoveKey(int key)
+{
+  switch (key)
   {
-    // Apply damage when movement is blocked (only if not invincible)
-    lives--;
-    printf("DEBUG: Hit guard! Lives: %d\n", lives);
-  }
-
-  float mapLeft = 50.0f;
-  float mapRight = 950.0f;
-  float mapTop = 480.0f;
-  float mapBottom = 30.0f;
-  
-  if (playerX < mapLeft) {
-    playerX = mapLeft;
-    cameraOffsetX += moveX;
-  }
-  if (playerX > mapRight) {
-    playerX = mapRight;
-    cameraOffsetX += moveX;
-  }
-  if (playerY < mapBottom) {
-    playerY = mapBottom;
-    cameraOffsetY += moveY;
-  }
-  if (playerY > mapTop) {
-    playerY = mapTop;
-    cameraOffsetY += moveY;
+  case GLUT_KEY_UP:
+    return MOVE_UP;
+  case GLUT_KEY_DOWN:
+    return MOVE_DOWN;
+  case GLUT_KEY_LEFT:
+    return MOVE_LEFT;
+  case GLUT_KEY_RIGHT:
+    return MOVE_RIGHT;
   }
+  return -1;
 }
 
-void specialKeys(int key, int x, int y)
+// Input callbacks only push commands to inputQueue; the simulation tick
+// they fall into applies them. Zoom and the profiler overlay are view state.
+void keyboard(unsigned char key, int x, int y)
 {
-  if (gameState != RUNNING)
+  int moveKey = letterMoveKey(key);
+  if (moveKey >= 0)
+  {
+    inputQueue.pushMove(INPUT_MOVE_PRESS, moveKey, KEY_SOURCE_LETTER, nowSeconds());
     return;
-
-  float moveX = 0, moveY = 0;
+  }
 
   switch (key)
   {
-  case GLUT_KEY_UP:
-    moveY = currentSpeed;
-    playerAngle = 90;
+  case 'r':
+  case 'R':
+    inputQueue.pushRestart(nowSeconds());
     break;
-  case GLUT_KEY_DOWN:
-    moveY = -currentSpeed;
-    playerAngle = 270;
+  case 'p':
+  case 'P':
+    profiler.overlayVisible = !profiler.overlayVisible;
     break;
-  case GLUT_KEY_LEFT:
-    moveX = -currentSpeed;
-    playerAngle = 180;
+  case '+':
+  case '=':
+    zoomBy(ZOOM_STEP);
     break;
-  case GLUT_KEY_RIGHT:
-    moveX = currentSpeed;
-    playerAngle = 0;
+  case '-':
+  case '_':
+    zoomBy(1.0f / ZOOM_STEP);
     break;
   }
+}
 
-  // Check if the new position would collide with obstacles
-  float newPlayerX = playerX + moveX;
-  float newPlayerY = playerY + moveY;
-  
-  // Only move if there's no collision with obstacles
-  if (!wouldCollideWithObstacle(newPlayerX, newPlayerY))
+void keyboardUp(unsigned char key, int x, int y)
+{
+  int moveKey = letterMoveKey(key);
+  if (moveKey >= 0)
+    inputQueue.pushMove(INPUT_MOVE_RELEASE, moveKey, KEY_SOURCE_LETTER, nowSeconds());
+}
+
+void specialKeys(int key, int x, int y)
+{
+  int moveKey = arrowMoveKey(key);
+  if (moveKey >= 0)
   {
-    cameraOffsetX -= moveX;
-    cameraOffsetY -= moveY;
-    playerX = newPlayerX;
-    playerY = newPlayerY;
+    inputQueue.pushMove(INPUT_MOVE_PRESS, moveKey, KEY_SOURCE_ARROW, nowSeconds());
+    return;
   }
-  else if (!invincible)
+
+  switch (key)
   {
-    // Apply damage when movement is blocked (only if not invincible)
-    lives--;
-    printf("DEBUG: Hit guard! Lives: %d\n", lives);
+  case GLUT_KEY_F5:
+    saveLevelFile(sim, levelPath);
+    break;
+  case GLUT_KEY_F9:
+    inputQueue.pushLevelLoad(levelPath, nowSeconds());
+    break;
   }
+}
 
-  float mapLeft = 50.0f;
-  float mapRight = 950.0f;
-  float mapTop = 480.0f;
-  float mapBottom = 30.0f;
-  
-  if (playerX < mapLeft) {
-    playerX = mapLeft;
-    cameraOffsetX += moveX;
-  }
-  if (playerX > mapRight) {
-    playerX = mapRight;
-    cameraOffsetX += moveX;
-  }
-  if (playerY < mapBottom) {
-    playerY = mapBottom;
-    cameraOffsetY += moveY;
-  }
-  if (playerY > mapTop) {
-    playerY = mapTop;
-    cameraOffsetY += moveY;
-  }
+void specialKeysUp(int key, int x, int y)
+{
+  int moveKey = arrowMoveKey(key);
+  if (moveKey >= 0)
+    inputQueue.pushMove(INPUT_MOVE_RELEASE, moveKey, KEY_SOURCE_ARROW, nowSeconds());
 }
 
+// GLUT reports wheel notches as buttons 3 (up) and 4 (down)
+const int WHEEL_UP_BUTTON = 3;
+const int WHEEL_DOWN_BUTTON = 4;
+
 void mouse(int button, int state, int x, int y)
 {
+  if (state == GLUT_DOWN && (button == WHEEL_UP_BUTTON || button == WHEEL_DOWN_BUTTON))
+  {
+    zoomBy(button == WHEEL_UP_BUTTON ? ZOOM_STEP : 1.0f / ZOOM_STEP);
+    return;
+  }
   if (button == GLUT_LEFT_BUTTON && state == GLUT_DOWN)
   {
     y = WINDOW_HEIGHT - y;
@@ -1833,66 +7655,105 @@ void mouse(int button, int state, int x, int y)
 
     if (y >= GAME_AREA_BOTTOM && y <= GAME_AREA_TOP && drawingMode != NONE)
     {
-      float mapX = x - cameraOffsetX;
-      float mapY = y - cameraOffsetY;
-
-      bool canPlace = true;
-
-      for (const auto &obstacle : obstacles)
-      {
-        if (obstacle.active && checkCollision(mapX - 10, mapY - 10, 20, 20,
-                                              obstacle.x - obstacle.width / 2, obstacle.y - obstacle.height / 2,
-                                              obstacle.width, obstacle.height))
-        {
-          canPlace = false;
-          break;
-        }
-      }
-
-      if (canPlace)
-      {
-        switch (drawingMode)
-        {
-        case OBSTACLE:
-          obstacles.push_back({mapX, mapY, 16, 24, true, 0, 0});
-          break;
-        case COLLECTIBLE:
-          collectibles.push_back({mapX, mapY, 16, 10, true, 0, 0});
-          break;
-        case POWERUP1:
-          powerups.push_back({mapX, mapY, true, 1.0f, 1});
-          break;
-        case POWERUP2:
-          powerups.push_back({mapX, mapY, true, 1.0f, 2});
-          break;
-        case NONE:
-          break;
-        }
-      }
+      float mapX, mapY;
+      screenToWorld(x, y, sim.cameraOffsetX, sim.cameraOffsetY, mapX, mapY);
+      inputQueue.pushPlacement({drawingMode, mapX, mapY}, nowSeconds());
     }
   }
 }
 
 int main(int argc, char **argv)
 {
+  if (argc > 1 && strcmp(argv[1], "--headless") == 0)
+  {
+    int ticks = argc > 2 ? atoi(argv[2]) : 100000;
+    int itemsPerType = argc > 3 ? atoi(argv[3]) : 50;
+    unsigned int seed = argc > 4 ? (unsigned int)strtoul(argv[4], NULL, 10) : 1;
+    float tickRate = argc > 5 ? (float)atof(argv[5]) : BASE_TICK_RATE;
+    return runHeadless(ticks, itemsPerType, seed, tickRate > 0 ? tickRate : BASE_TICK_RATE);
+  }
+  if (argc > 1 && strcmp(argv[1], "--audio-bench") == 0)
+  {
+    return runAudioBenchmark(argc > 2 ? argv[2] : "null", argc > 3 ? argv[3] : NULL);
+  }
+  if (argc > 1 && strcmp(argv[1], "--level-bench") == 0)
+  {
+    return runLevelBenchmark(argc > 2 ? atoi(argv[2]) : 1000000, argc > 3 ? argv[3] : "stress.level");
+  }
+  if (argc > 1 && strcmp(argv[1], "--crowd-bench") == 0)
+  {
+    int workers = argc > 4 ? atoi(argv[4]) : (int)sysconf(_SC_NPROCESSORS_ONLN) - 1;
+    return runCrowdBenchmark(std::max(1, argc > 2 ? atoi(argv[2]) : 10000), std::max(1, argc > 3 ? atoi(argv[3]) : 600),
+                             std::max(0, std::min(CROWD_MAX_WORKERS, workers)));
+  }
+  if (argc > 1 && strcmp(argv[1], "--path-bench") == 0)
+  {
+    return runPathBenchmark(std::max(1, argc > 2 ? atoi(argv[2]) : 500), std::max(1, argc > 3 ? atoi(argv[3]) : 20000));
+  }
+  if (argc > 3 && strcmp(argv[1], "--level-export") == 0)
+  {
+    return exportLevelText(argv[2], argv[3]) ? 0 : 1;
+  }
+  if (argc > 1 && strcmp(argv[1], "--bmp-bench") == 0)
+  {
+    return runBMPBenchmark(argc > 2 ? argv[2] : "./assets/images/cluj-napoca_airport_map.bmp",
+                           argc > 3 ? atoi(argv[3]) : 20);
+  }
+
+  int crowdSize = CROWD_DEFAULT_SIZE;
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "--single-buffer") == 0)
+      framePacing.doubleBuffered = false;
+    else if (strcmp(argv[i], "--swap-interval") == 0 && i + 1 < argc)
+      framePacing.swapInterval = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--tick-rate") == 0 && i + 1 < argc)
+      fixedStep.tickRate = std::max(1.0f, (float)atof(argv[++i]));
+    else if (strcmp(argv[i], "--refresh-hz") == 0 && i + 1 < argc)
+      framePacing.refreshHz = (float)atof(argv[++i]);
+    else if (strcmp(argv[i], "--level") == 0 && i + 1 < argc)
+    {
+      levelPath = argv[++i];
+      inputQueue.pushLevelLoad(levelPath, 0);
+    }
+    else if (strcmp(argv[i], "--crowd") == 0 && i + 1 < argc)
+      crowdSize = std::max(0, atoi(argv[++i]));
+    else if (strcmp(argv[i], "--benchmark") == 0)
+      framePacing.benchmarkSeconds = (i + 1 < argc && argv[i + 1][0] != '-') ? atof(argv[++i]) : 10.0;
+  }
+
+  assetLoader.launchTime = nowSeconds();
   glutInit(&argc, argv);
   glutInitWindowSize(WINDOW_WIDTH, WINDOW_HEIGHT);
-  glutInitDisplayMode(GLUT_SINGLE | GLUT_RGB);
+  glutInitDisplayMode((framePacing.doubleBuffered ? GLUT_DOUBLE : GLUT_SINGLE) | GLUT_RGB);
   glutCreateWindow("Airport Rush: Cluj-Napoca Last-Minute Boarding");
 
+  sim.crowdSize = crowdSize;
+  crowdWorkers.start((int)sysconf(_SC_NPROCESSORS_ONLN) - 1);
+  sim.workers = &crowdWorkers;
+  atexit(stopCrowdWorkers);
   init();
+  framePacing.start();
+  atexit(reportFramePacingAtExit);
+  profiler.enabled = true;
+  atexit(writeProfileCsvAtExit);
+  atexit(shutdownAudio);
 
   glutDisplayFunc(display);
+  glutIgnoreKeyRepeat(1);
   glutKeyboardFunc(keyboard);
+  glutKeyboardUpFunc(keyboardUp);
   glutSpecialFunc(specialKeys);
+  glutSpecialUpFunc(specialKeysUp);
   glutMouseFunc(mouse);
-  glutTimerFunc(16, timer, 0);
+  if (!framePacing.doubleBuffered)
+    glutTimerFunc(16, timer, 0);
 
   gluOrtho2D(0, WINDOW_WIDTH, 0, WINDOW_HEIGHT);
 
   glutMainLoop();
   
-  // Cleanup audio when program exits
-  cleanupAudio();
+  // Stop the mixer when program exits
+  shutdownAudio();
   return 0;
 }
\ No newline at end of file
@@ -1,8 +1,39 @@
 #include <stdio.h>
 #include <string.h>
-#include <glut.h>
+#include <time.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#ifdef __APPLE__
+#define GL_SILENCE_DEPRECATION
+#include <GLUT/glut.h>
+#include <OpenGL/glext.h>
+#else
+#define GL_GLEXT_PROTOTYPES
+#include <GL/glut.h>
+#endif
 
+// Text throughput benchmark: draws a screen full of HUD-like strings every
+// frame, either one glutBitmapCharacter call per character (the classic
+// print() below) or as cached textured-quad batches from a glyph atlas.
+// Press M to switch modes; stats are printed every 120 frames.
+// Build: g++ -std=c++17 -O2 -o print_bench Print_On_Screen.cpp -lglut -lGLU -lGL   (macOS: -framework GLUT -framework OpenGL)
 
+const int STRINGS_PER_FRAME = 400;
+const int CHANGING_STRINGS = 40; // strings whose text changes every frame, like a timer
+
+bool useAtlas = true;
+int frame = 0;
+double modeTime = 0;
+long modeStrings = 0, modeGlyphs = 0, modeFrames = 0;
+
+
+double nowSeconds()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
 
 
 //this is the method used to print text in OpenGL
@@ -27,30 +58,200 @@ void print(int x, int y, char* string)
 }
 
 
+//glyph atlas: every character of the font rendered once into a texture,
+//16 cells per row, with the raster origin at (PAD_X, BASELINE) inside each cell
+const int CELL_W = 32, CELL_H = 32, BASELINE = 8, PAD_X = 4;
+const int FIRST = 32, LAST = 255, COLUMNS = 16;
+const int ROWS = (LAST - FIRST + 1 + COLUMNS - 1) / COLUMNS;
+GLuint atlasTexture = 0;
+float advance[LAST + 1];
+
+//cached quads per string: x, y, u, v per vertex, relative to the raster position
+std::unordered_map<std::string, std::vector<float> > layouts;
+long layoutHits = 0, layoutMisses = 0;
+
+bool buildAtlas()
+{
+	int w = COLUMNS * CELL_W, h = ROWS * CELL_H;
+
+	glGenTextures(1, &atlasTexture);
+	glBindTexture(GL_TEXTURE_2D, atlasTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+	GLuint fbo;
+	glGenFramebuffersEXT(1, &fbo);
+	glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, fbo);
+	glFramebufferTexture2DEXT(GL_FRAMEBUFFER_EXT, GL_COLOR_ATTACHMENT0_EXT, GL_TEXTURE_2D, atlasTexture, 0);
+	bool ok = glCheckFramebufferStatusEXT(GL_FRAMEBUFFER_EXT) == GL_FRAMEBUFFER_COMPLETE_EXT;
+
+	glViewport(0, 0, w, h);
+	glMatrixMode(GL_PROJECTION);
+	glLoadIdentity();
+	gluOrtho2D(0, w, 0, h);
+	glClearColor(0, 0, 0, 0);
+	glClear(GL_COLOR_BUFFER_BIT);
+	glColor4f(1, 1, 1, 1);
+	for (int c = FIRST; c <= LAST; c++)
+	{
+		int cell = c - FIRST;
+		glRasterPos2i((cell % COLUMNS) * CELL_W + PAD_X, (cell / COLUMNS) * CELL_H + BASELINE);
+		glutBitmapCharacter(GLUT_BITMAP_TIMES_ROMAN_24, c);
+		advance[c] = (float)glutBitmapWidth(GLUT_BITMAP_TIMES_ROMAN_24, c);
+	}
+
+	glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, 0);
+	glDeleteFramebuffersEXT(1, &fbo);
+	glViewport(0, 0, 1000, 600);
+	glLoadIdentity();
+	gluOrtho2D(0.0, 1000, 0.0, 600);
+	glMatrixMode(GL_MODELVIEW);
+	glLoadIdentity();
+	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+	return ok;
+}
+
+const std::vector<float>& layout(const char* string)
+{
+	auto it = layouts.find(string);
+	if (it != layouts.end())
+	{
+		layoutHits++;
+		return it->second;
+	}
+	layoutMisses++;
+	if (layouts.size() > 512)
+		layouts.clear();
+
+	std::vector<float>& quads = layouts[string];
+	float texW = (float)(COLUMNS * CELL_W), texH = (float)(ROWS * CELL_H);
+	float pen = 0;
+	for (const unsigned char* p = (const unsigned char*)string; *p; p++)
+	{
+		if (*p < FIRST)
+			continue;
+		int cell = *p - FIRST;
+		float u0 = (cell % COLUMNS) * CELL_W / texW, v0 = (cell / COLUMNS) * CELL_H / texH;
+		float u1 = u0 + CELL_W / texW, v1 = v0 + CELL_H / texH;
+		float x0 = pen - PAD_X, y0 = (float)-BASELINE, x1 = x0 + CELL_W, y1 = y0 + CELL_H;
+		float quad[16] = {x0, y0, u0, v0, x1, y0, u1, v0, x1, y1, u1, v1, x0, y1, u0, v1};
+		quads.insert(quads.end(), quad, quad + 16);
+		pen += advance[*p];
+	}
+	return quads;
+}
+
+//same job as print(), as one textured quad batch
+void printAtlas(int x, int y, char* string)
+{
+	const std::vector<float>& quads = layout(string);
+	if (quads.empty())
+		return;
+
+	glPushMatrix();
+	glTranslatef(x, y, 0);
+	glVertexPointer(2, GL_FLOAT, 4 * sizeof(float), &quads[0]);
+	glTexCoordPointer(2, GL_FLOAT, 4 * sizeof(float), &quads[2]);
+	glDrawArrays(GL_QUADS, 0, (GLsizei)(quads.size() / 4));
+	glPopMatrix();
+}
+
+
 
 void Display() {
 	glClear(GL_COLOR_BUFFER_BIT);
 
-	glColor3f(1, 0, 0);
-	char* p0s[20];
-	sprintf((char*)p0s, "Score: %d", 50);
-	print(500, 300, (char*)p0s);
-	
-	
+	if (useAtlas)
+	{
+		glEnable(GL_TEXTURE_2D);
+		glBindTexture(GL_TEXTURE_2D, atlasTexture);
+		glEnable(GL_ALPHA_TEST);
+		glAlphaFunc(GL_GREATER, 0.5f);
+		glEnableClientState(GL_VERTEX_ARRAY);
+		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+	}
+
+	double start = nowSeconds();
+	long glyphs = 0;
+	char text[32];
+	for (int i = 0; i < STRINGS_PER_FRAME; i++)
+	{
+		glColor3f((i % 3) / 2.0f, 1, 0);
+		//a few strings change every frame, the rest stay the same like most HUD labels
+		sprintf(text, "Score: %d", i < CHANGING_STRINGS ? frame + i : i);
+		int x = (i % 8) * 125;
+		int y = 10 + (i / 8) * 12 % 580;
+		if (useAtlas)
+			printAtlas(x, y, text);
+		else
+			print(x, y, text);
+		glyphs += (long)strlen(text);
+	}
+	glFinish();
+	double elapsed = nowSeconds() - start;
+
+	if (useAtlas)
+	{
+		glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+		glDisableClientState(GL_VERTEX_ARRAY);
+		glDisable(GL_ALPHA_TEST);
+		glDisable(GL_TEXTURE_2D);
+	}
+
+	modeTime += elapsed;
+	modeStrings += STRINGS_PER_FRAME;
+	modeGlyphs += glyphs;
+	modeFrames++;
+	if (modeFrames == 120)
+	{
+		printf("%s: %.3f ms/frame, %.0f strings/sec, %.0f glyphs/sec",
+			useAtlas ? "atlas" : "glutBitmapCharacter", modeTime * 1000 / modeFrames,
+			modeStrings / modeTime, modeGlyphs / modeTime);
+		if (useAtlas)
+			printf(", layout cache %ld hits / %ld misses", layoutHits, layoutMisses);
+		printf("\n");
+		modeTime = 0;
+		modeStrings = modeGlyphs = modeFrames = 0;
+	}
+
+	frame++;
 	glFlush();
+	glutPostRedisplay();
+}
+
+void Keyboard(unsigned char key, int x, int y)
+{
+	if (key == 'm' || key == 'M')
+	{
+		useAtlas = !useAtlas;
+		modeTime = 0;
+		modeStrings = modeGlyphs = modeFrames = 0;
+	}
 }
 
 
-void main(int argc, char** argr) {
+int main(int argc, char** argr) {
 	glutInit(&argc, argr);
 
 	glutInitWindowSize(1000, 600);
-	
-	glutCreateWindow("OpenGL - 2D Template");
-	glutDisplayFunc(Display);
 	glutInitDisplayMode(GLUT_SINGLE | GLUT_RGB);
+
+	glutCreateWindow("OpenGL - Text Throughput Benchmark");
+	glutDisplayFunc(Display);
+	glutKeyboardFunc(Keyboard);
 	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+	glMatrixMode(GL_PROJECTION);
+	glLoadIdentity();
 	gluOrtho2D(0.0, 1000, 0.0, 600);
+	glMatrixMode(GL_MODELVIEW);
+
+	if (!buildAtlas())
+	{
+		printf("Framebuffer objects unavailable, benchmarking glutBitmapCharacter only\n");
+		useAtlas = false;
+	}
 
 	glutMainLoop();
+	return 0;
 }
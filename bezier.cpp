@@ -1,21 +1,59 @@
 #include <math.h>
 #include <stdio.h>
-#include <windows.h>
 #include <string.h>
-#include <glut.h>
+#include <time.h>
+#include <vector>
+#ifdef __APPLE__
+#define GL_SILENCE_DEPRECATION
+#include <GLUT/glut.h>
+#else
+#define GL_GLEXT_PROTOTYPES
+#include <GL/glut.h>
+#endif
 
-int p0[2];
-int p1[2];
-int p2[2];
-int p3[2];
-int tar=4;
+// Bezier curve editor: drag a control point with the left button, right-click
+// to add a point at the cursor, X or Backspace removes the last one. The curve
+// has one control point per entry in points (degree points - 1). It is
+// tessellated by adaptive subdivision into a vertex buffer that is only
+// rebuilt when a control point moves; the time each rebuild took is shown on
+// screen and summarised on the console when a drag ends.
+// Build: g++ -O2 -o bezier bezier.cpp -lglut -lGLU -lGL   (macOS: -framework GLUT -framework OpenGL)
+
+struct Point
+{
+	float x, y;
+};
+
+std::vector<Point> points;
+int tar=-1; //index of the point being dragged, -1 for none
+
+//a piece of curve is drawn as its chord once no control point is further than
+//FLATNESS pixels from it
+const float FLATNESS = 0.25f;
+const int MAX_DEPTH = 16;
+const int MAX_LABELS = 8;
+
+GLuint curveBuffer = 0;
+std::vector<float> curveVertices; //x, y per vertex
+bool curveDirty = true;
+double lastRebuildTime = 0;
+int dragEvents = 0;
+double dragTime = 0, dragMaxTime = 0;
+
+
+double nowSeconds()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
 
 
 //this is the method used to print text in OpenGL
 //there are three parameters,
 //the first two are the coordinates where the text is display,
 //the third coordinate is the string containing the text to display
-void print(int x, int y, char *string)
+void print(int x, int y, const char *string)
 {
 	int len, i;
 
@@ -26,61 +64,142 @@ void print(int x, int y, char *string)
 	len = (int) strlen(string);
 
 	//loop to display character by character
-	for (i = 0; i < len; i++) 
+	for (i = 0; i < len; i++)
 	{
 		glutBitmapCharacter(GLUT_BITMAP_TIMES_ROMAN_24,string[i]);
 	}
 }
 
-int* bezier(float t, int* p0,int* p1,int* p2,int* p3)
+//splits the control polygon c at t=0.5 with de Casteljau's algorithm
+void split(const std::vector<Point>& c, std::vector<Point>& left, std::vector<Point>& right)
+{
+	int n = (int)c.size();
+	std::vector<Point> work(c);
+	left.resize(n);
+	right.resize(n);
+	for (int level = 0; level < n; level++)
+	{
+		left[level] = work[0];
+		right[n - 1 - level] = work[n - 1 - level];
+		for (int i = 0; i < n - 1 - level; i++)
+		{
+			work[i].x = (work[i].x + work[i + 1].x) * 0.5f;
+			work[i].y = (work[i].y + work[i + 1].y) * 0.5f;
+		}
+	}
+}
+
+//the curve stays inside its control polygon, so if every inner control point
+//is within FLATNESS of the chord the chord is close enough to the curve.
+//The distance is to the chord segment, not its line, so a control point
+//beyond an endpoint (a curve that doubles back) is not taken for flat.
+bool flat(const std::vector<Point>& c)
+{
+	Point a = c.front(), b = c.back();
+	float dx = b.x - a.x, dy = b.y - a.y;
+	float lengthSquared = dx * dx + dy * dy;
+	for (size_t i = 1; i + 1 < c.size(); i++)
+	{
+		float px = c[i].x - a.x, py = c[i].y - a.y;
+		float t = lengthSquared > 1e-12f ? (px * dx + py * dy) / lengthSquared : 0.0f;
+		t = t < 0 ? 0 : (t > 1 ? 1 : t);
+		float ex = px - t * dx, ey = py - t * dy;
+		if (ex * ex + ey * ey > FLATNESS * FLATNESS)
+			return false;
+	}
+	return true;
+}
+
+//appends the end of every flat piece, so the caller adds the first point
+void tessellate(const std::vector<Point>& c, int depth, std::vector<float>& out)
 {
-	int res[2];
-	res[0]=pow((1-t),3)*p0[0]+3*t*pow((1-t),2)*p1[0]+3*pow(t,2)*(1-t)*p2[0]+pow(t,3)*p3[0];
-	res[1]=pow((1-t),3)*p0[1]+3*t*pow((1-t),2)*p1[1]+3*pow(t,2)*(1-t)*p2[1]+pow(t,3)*p3[1];
-	return res;
+	if (depth == MAX_DEPTH || flat(c))
+	{
+		out.push_back(c.back().x);
+		out.push_back(c.back().y);
+		return;
+	}
+	std::vector<Point> left, right;
+	split(c, left, right);
+	tessellate(left, depth + 1, out);
+	tessellate(right, depth + 1, out);
+}
+
+void rebuildCurve()
+{
+	double start = nowSeconds();
+	curveVertices.clear();
+	curveVertices.push_back(points[0].x);
+	curveVertices.push_back(points[0].y);
+	tessellate(points, 0, curveVertices);
+
+	if (curveBuffer == 0)
+		glGenBuffers(1, &curveBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, curveBuffer);
+	glBufferData(GL_ARRAY_BUFFER, curveVertices.size() * sizeof(float), &curveVertices[0], GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	lastRebuildTime = nowSeconds() - start;
+	curveDirty = false;
+
+	if (tar >= 0)
+	{
+		dragEvents++;
+		dragTime += lastRebuildTime;
+		if (lastRebuildTime > dragMaxTime)
+			dragMaxTime = lastRebuildTime;
+	}
+}
+
+//first four points keep the original red, green, blue, white
+void pointColor(int i)
+{
+	static const float colors[4][3] = {{1,0,0}, {0,1,0}, {0,0,1}, {1,1,1}};
+	glColor3fv(colors[i % 4]);
 }
 
 void Display() {
 	glClear(GL_COLOR_BUFFER_BIT);
 
+	if (curveDirty)
+		rebuildCurve();
+
+	glColor3f(1,1,1);
 	print(750,500,"Bezier Control Points");
-	glColor3f(1,0,0);
-	char* p0s [20];
-	sprintf((char *)p0s,"P0={%d,%d}",p0[0],p0[1]);
-	print(785,450,(char *)p0s);
-	glColor3f(0,1,0);
-	char* p1s [20];
-	sprintf((char *)p1s,"P1={%d,%d}",p1[0],p1[1]);
-	print(785,400,(char *)p1s);
-	glColor3f(0,0,1);
-	char* p2s [20];
-	sprintf((char *)p2s,"P2={%d,%d}",p2[0],p2[1]);
-	print(785,350,(char *)p2s);
+	char text[64];
+	int labels = (int)points.size() < MAX_LABELS ? (int)points.size() : MAX_LABELS;
+	for (int i = 0; i < labels; i++)
+	{
+		pointColor(i);
+		sprintf(text,"P%d={%d,%d}",i,(int)points[i].x,(int)points[i].y);
+		print(785,450-i*35,text);
+	}
 	glColor3f(1,1,1);
-	char* p3s [20];
-	sprintf((char *)p3s,"P3={%d,%d}",p3[0],p3[1]);
-	print(785,300,(char *)p3s);
+	if ((int)points.size() > labels)
+	{
+		sprintf(text,"... %d more",(int)points.size()-labels);
+		print(785,450-labels*35,text);
+	}
+	sprintf(text,"%d vertices",(int)curveVertices.size()/2);
+	print(750,100,text);
+	sprintf(text,"rebuild %.1f us",lastRebuildTime*1e6);
+	print(750,70,text);
 
-	glPointSize(1);
 	glColor3f(1,1,0);
+	glBindBuffer(GL_ARRAY_BUFFER, curveBuffer);
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glVertexPointer(2, GL_FLOAT, 0, 0);
+	glDrawArrays(GL_LINE_STRIP, 0, (GLsizei)(curveVertices.size() / 2));
+	glDisableClientState(GL_VERTEX_ARRAY);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glPointSize(9);
 	glBegin(GL_POINTS);
-	for(float t=0;t<1;t+=0.001)
+	for (size_t i = 0; i < points.size(); i++)
 	{
-		int* p =bezier(t,p0,p1,p2,p3);
-		glVertex3f(p[0],p[1],0);
+		pointColor((int)i);
+		glVertex3f(points[i].x,points[i].y,0);
 	}
 	glEnd();
-	glPointSize(9);
-	glBegin(GL_POINTS);
-	glColor3f(1,0,0);
-	glVertex3f(p0[0],p0[1],0);
-	glColor3f(0,1,0);
-	glVertex3f(p1[0],p1[1],0);
-	glColor3f(0,0,1);
-	glVertex3f(p2[0],p2[1],0);
-	glColor3f(1,1,1);
-	glVertex3f(p3[0],p3[1],0);
-	glEnd();
 
 	glFlush();
 }
@@ -96,26 +215,13 @@ void mo(int x, int y)
 		y=0;
 	if(y>600)
 		y=600;
-	if(tar==0)
-	{	
-		p0[0]=x;
-		p0[1]=y;
-	}
-	else if(tar==1)
-	{	
-		p1[0]=x;
-		p1[1]=y;
-	}
-	else if(tar==2)
-	{	
-		p2[0]=x;
-		p2[1]=y;
-	}
-	if(tar==3)
-	{	
-		p3[0]=x;
-		p3[1]=y;
-	}
+	if(tar<0)
+		return;
+	if(points[tar].x==x && points[tar].y==y)
+		return;
+	points[tar].x=x;
+	points[tar].y=y;
+	curveDirty=true;
 	glutPostRedisplay();
 }
 
@@ -124,53 +230,62 @@ void mou(int b,int s,int x, int y)
 	y=600-y;
 	if(b==GLUT_LEFT_BUTTON && s==GLUT_DOWN)
 	{
-		if(p0[0]<x+9&&p0[0]>x-9&&p0[1]<y+9&&p0[1]>y-9)
-		{
-			tar=0;
-		}
-		else if(p1[0]<x+9&&p1[0]>x-9&&p1[1]<y+9&&p1[1]>y-9)
+		for (size_t i = 0; i < points.size(); i++)
 		{
-			tar=1;
-		}
-		else if(p2[0]<x+9&&p2[0]>x-9&&p2[1]<y+9&&p2[1]>y-9)
-		{
-			tar=2;
-		}
-		else if(p3[0]<x+9&&p3[0]>x-9&&p3[1]<y+9&&p3[1]>y-9)
-		{
-			tar=3;
+			if(points[i].x<x+9&&points[i].x>x-9&&points[i].y<y+9&&points[i].y>y-9)
+			{
+				tar=(int)i;
+				dragEvents=0;
+				dragTime=dragMaxTime=0;
+				break;
+			}
 		}
 	}
-	if(b==GLUT_LEFT_BUTTON && s==GLUT_UP)
-		tar=4;
+	if(b==GLUT_LEFT_BUTTON && s==GLUT_UP && tar>=0)
+	{
+		if(dragEvents>0)
+			printf("drag P%d: %d rebuilds, %.1f us avg, %.1f us max, %d vertices for %d points\n",
+				tar,dragEvents,dragTime*1e6/dragEvents,dragMaxTime*1e6,(int)curveVertices.size()/2,(int)points.size());
+		tar=-1;
+	}
+	if(b==GLUT_RIGHT_BUTTON && s==GLUT_DOWN && x>=0 && x<=700)
+	{
+		Point p = {(float)x, (float)y};
+		points.push_back(p);
+		curveDirty=true;
+		glutPostRedisplay();
+	}
 }
 
-void main(int argc, char** argr) {
+void Keyboard(unsigned char key, int x, int y)
+{
+	if((key=='x' || key=='X' || key==8) && points.size()>2 && tar<0)
+	{
+		points.pop_back();
+		curveDirty=true;
+		glutPostRedisplay();
+	}
+}
+
+int main(int argc, char** argr) {
 	glutInit(&argc, argr);
 
 	glutInitWindowSize(1000, 600);
 //	glutInitWindowPosition(150, 150);
+	glutInitDisplayMode(GLUT_SINGLE | GLUT_RGB);
 
-	p0[0]=100;
-	p0[1]=100;
-
-	p1[0]=100;
-	p1[1]=500;
-	
-	p2[0]=500;
-	p2[1]=500;
-	
-	p3[0]=500;
-	p3[1]=100;
+	Point initial[4] = {{100,100}, {100,500}, {500,500}, {500,100}};
+	points.assign(initial, initial + 4);
 
 	glutCreateWindow("OpenGL - 2D Template");
 	glutDisplayFunc(Display);
 	glutMotionFunc(mo);
 	glutMouseFunc(mou);
-	
-	glutInitDisplayMode(GLUT_SINGLE | GLUT_RGB);
+	glutKeyboardFunc(Keyboard);
+
 	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
 	gluOrtho2D(0.0, 1000, 0.0, 600);
 
 	glutMainLoop();
+	return 0;
 }